@@ -39,131 +39,458 @@
 
 /*L2 Switch Owns Mac Table*/
 
-typedef struct mac_table_entry_{
+void
+init_mac_table(mac_table_t **mac_table){
 
-    mac_add_t mac;
-    char oif_name[IF_NAME_SIZE];
-    glthread_t mac_entry_glue;
-} mac_table_entry_t;
-GLTHREAD_TO_STRUCT(mac_entry_glue_to_mac_entry, mac_table_entry_t, mac_entry_glue);
+    *mac_table = calloc(1, sizeof(mac_table_t));
+    (*mac_table)->entries = calloc(MAC_TABLE_INIT_SIZE, sizeof(mac_table_entry_t));
+    (*mac_table)->size = MAC_TABLE_INIT_SIZE;
+    (*mac_table)->aging_time = MAC_TABLE_DEF_AGING_TIME;
+    pthread_mutex_init(&(*mac_table)->lock, NULL);
+}
 
+/*Home slot of (mac, vlan_id), MAC and VLAN are mixed as one 64 bit key*/
+static inline unsigned int
+mac_table_hash(mac_table_t *mac_table, char *mac, unsigned int vlan_id){
 
-typedef struct mac_table_{
+    uint64_t key = vlan_id;
 
-    glthread_t mac_entries;
-} mac_table_t;
+    memcpy((char *)&key + 2, mac, sizeof(mac_add_t));
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return (unsigned int)key & (mac_table->size - 1);
+}
 
-void
-init_mac_table(mac_table_t **mac_table){
+static inline bool_t
+mac_table_entry_match(mac_table_entry_t *mac_table_entry, char *mac,
+                      unsigned int vlan_id){
 
-    *mac_table = calloc(1, sizeof(mac_table_t));
-    init_glthread(&((*mac_table)->mac_entries));
+    return mac_table_entry->vlan_id == vlan_id &&
+           memcmp(mac_table_entry->mac.mac, mac, sizeof(mac_add_t)) == 0;
+}
+
+/* Slot holding (mac, vlan_id), else the free slot ending its probe
+ * sequence*/
+static mac_table_entry_t *
+mac_table_probe(mac_table_t *mac_table, char *mac, unsigned int vlan_id){
+
+    unsigned int slot = mac_table_hash(mac_table, mac, vlan_id);
+    mac_table_entry_t *mac_table_entry;
+
+    while(1){
+        mac_table_entry = &mac_table->entries[slot];
+        if(!mac_table_entry->oif ||
+            mac_table_entry_match(mac_table_entry, mac, vlan_id))
+            return mac_table_entry;
+        slot = (slot + 1) & (mac_table->size - 1);
+    }
 }
 
 mac_table_entry_t *
-mac_table_lookup(mac_table_t *mac_table, char *mac){
+mac_table_lookup(mac_table_t *mac_table, char *mac, unsigned int vlan_id){
 
-    glthread_t *curr;
+    mac_table_entry_t *mac_table_entry =
+        mac_table_probe(mac_table, mac, vlan_id);
+
+    return mac_table_entry->oif ? mac_table_entry : NULL;
+}
+
+/*Double the no of slots, rehash all the entries*/
+static bool_t
+mac_table_grow(mac_table_t *mac_table){
+
+    unsigned int i, old_size = mac_table->size;
+    mac_table_entry_t *old_entries = mac_table->entries;
+    mac_table_entry_t *new_entries = calloc(old_size * 2, sizeof(mac_table_entry_t));
+
+    if(!new_entries)
+        return FALSE;
+
+    mac_table->entries = new_entries;
+    mac_table->size = old_size * 2;
+
+    for(i = 0; i < old_size; i++){
+        if(!old_entries[i].oif) continue;
+        *mac_table_probe(mac_table, old_entries[i].mac.mac,
+                old_entries[i].vlan_id) = old_entries[i];
+    }
+    free(old_entries);
+    return TRUE;
+}
+
+bool_t
+mac_table_learn(mac_table_t *mac_table, char *mac, unsigned int vlan_id,
+                interface_t *oif){
+
+    mac_table_entry_t *mac_table_entry =
+        mac_table_probe(mac_table, mac, vlan_id);
+
+    if(mac_table_entry->oif){
+        mac_table_entry->oif = oif;
+        mac_table_entry->last_seen = mac_table->now;
+        return TRUE;
+    }
+
+    if((mac_table->n_entries + 1) * 100 >
+            mac_table->size * MAC_TABLE_MAX_LOAD_PCT){
+        if(!mac_table_grow(mac_table))
+            return FALSE;
+        mac_table_entry = mac_table_probe(mac_table, mac, vlan_id);
+    }
+
+    memcpy(mac_table_entry->mac.mac, mac, sizeof(mac_add_t));
+    mac_table_entry->vlan_id = vlan_id;
+    mac_table_entry->last_seen = mac_table->now;
+    mac_table_entry->oif = oif;
+    mac_table->n_entries++;
+    mac_table->n_learned++;
+    return TRUE;
+}
+
+/* Free the slot, and move back the entries after it which would no
+ * longer be found past the free slot, so that no probe sequence is
+ * broken*/
+static void
+mac_table_delete_slot(mac_table_t *mac_table, unsigned int hole){
+
+    unsigned int slot = hole, home;
+    unsigned int mask = mac_table->size - 1;
     mac_table_entry_t *mac_table_entry;
 
-    ITERATE_GLTHREAD_BEGIN(&mac_table->mac_entries, curr){
+    while(1){
+        slot = (slot + 1) & mask;
+        mac_table_entry = &mac_table->entries[slot];
+        if(!mac_table_entry->oif)
+            break;
+        home = mac_table_hash(mac_table, mac_table_entry->mac.mac,
+                mac_table_entry->vlan_id);
+        /*Entry stays if its home lies cyclically in (hole, slot]*/
+        if(((slot - home) & mask) < ((slot - hole) & mask))
+            continue;
+        mac_table->entries[hole] = *mac_table_entry;
+        hole = slot;
+    }
 
-        mac_table_entry = mac_entry_glue_to_mac_entry(curr);
-        if(strncmp(mac_table_entry->mac.mac, mac, sizeof(mac_add_t)) == 0){
-            return mac_table_entry;
-        }
-    } ITERATE_GLTHREAD_END(&mac_table->mac_entries, curr);
-    return NULL;
+    memset(&mac_table->entries[hole], 0, sizeof(mac_table_entry_t));
+    mac_table->n_entries--;
 }
 
 void
-clear_mac_table(mac_table_t *mac_table){
+delete_mac_table_entry(mac_table_t *mac_table, char *mac,
+                       unsigned int vlan_id){
+
+    mac_table_entry_t *mac_table_entry =
+        mac_table_probe(mac_table, mac, vlan_id);
 
-    glthread_t *curr;
+    if(mac_table_entry->oif)
+        mac_table_delete_slot(mac_table,
+                mac_table_entry - mac_table->entries);
+}
+
+/* Remove the MACs learned on 'oif', or on all interfaces but 'oif'. A
+ * slot is visited again after a deletion, an entry may have moved back
+ * into it*/
+static void
+mac_table_flush(mac_table_t *mac_table, interface_t *oif, bool_t keep_oif){
+
+    unsigned int slot = 0;
     mac_table_entry_t *mac_table_entry;
 
-    ITERATE_GLTHREAD_BEGIN(&mac_table->mac_entries, curr){
-        
-        mac_table_entry = mac_entry_glue_to_mac_entry(curr);
-        remove_glthread(curr);
-        free(mac_table_entry);
-    } ITERATE_GLTHREAD_END(&mac_table->mac_entries, curr);
+    pthread_mutex_lock(&mac_table->lock);
+
+    while(slot < mac_table->size){
+
+        mac_table_entry = &mac_table->entries[slot];
+
+        if(mac_table_entry->oif &&
+            (mac_table_entry->oif == oif) != keep_oif){
+            mac_table_delete_slot(mac_table, slot);
+            continue;
+        }
+        slot++;
+    }
+
+    pthread_mutex_unlock(&mac_table->lock);
+}
+
+void
+mac_table_flush_intf(mac_table_t *mac_table, interface_t *oif){
+
+    mac_table_flush(mac_table, oif, FALSE);
+}
+
+void
+mac_table_flush_other_intfs(mac_table_t *mac_table, interface_t *oif){
+
+    mac_table_flush(mac_table, oif, TRUE);
 }
 
 void
-delete_mac_table_entry(mac_table_t *mac_table, char *mac){
+mac_table_age_out(mac_table_t *mac_table){
 
+    unsigned int slot, n_sweep_ticks, n_slots, n_visited = 0;
     mac_table_entry_t *mac_table_entry;
-    mac_table_entry = mac_table_lookup(mac_table, mac);
-    if(!mac_table_entry)
+
+    pthread_mutex_lock(&mac_table->lock);
+
+    mac_table->now += NW_TIMER_TICK_SEC;
+
+    if(!mac_table->aging_time || !mac_table->n_entries){
+        pthread_mutex_unlock(&mac_table->lock);
         return;
-    remove_glthread(&mac_table_entry->mac_entry_glue);
-    free(mac_table_entry);
+    }
+
+    n_sweep_ticks = mac_table->aging_time / 2 / NW_TIMER_TICK_SEC;
+    if(!n_sweep_ticks)
+        n_sweep_ticks = 1;
+    n_slots = (mac_table->size + n_sweep_ticks - 1) / n_sweep_ticks;
+    slot = mac_table->sweep_slot & (mac_table->size - 1);
+
+    while(n_visited < n_slots){
+
+        mac_table_entry = &mac_table->entries[slot];
+
+        if(mac_table_entry->oif &&
+            mac_table->now - mac_table_entry->last_seen >= mac_table->aging_time){
+            /*Visit the slot again, an entry may have moved back into it*/
+            mac_table_delete_slot(mac_table, slot);
+            mac_table->n_aged++;
+            continue;
+        }
+        slot = (slot + 1) & (mac_table->size - 1);
+        n_visited++;
+    }
+
+    mac_table->sweep_slot = slot;
+    pthread_mutex_unlock(&mac_table->lock);
 }
 
-#define IS_MAC_TABLE_ENTRY_EQUAL(mac_entry_1, mac_entry_2)   \
-    (strncmp(mac_entry_1->mac.mac, mac_entry_2->mac.mac, sizeof(mac_add_t)) == 0 && \
-            strncmp(mac_entry_1->oif_name, mac_entry_2->oif_name, IF_NAME_SIZE) == 0)
+static void
+mac_table_aging_timer_cb(void *arg, int arg_size){
 
+    mac_table_age_out(*(mac_table_t **)arg);
+}
 
-bool_t
-mac_table_entry_add(mac_table_t *mac_table, mac_table_entry_t *mac_table_entry){
+void
+mac_table_start_aging(mac_table_t *mac_table){
 
-    mac_table_entry_t *mac_table_entry_old = mac_table_lookup(mac_table,
-            mac_table_entry->mac.mac);
+    if(mac_table->aging_timer)
+        return;
 
-    if(mac_table_entry_old &&
-            IS_MAC_TABLE_ENTRY_EQUAL(mac_table_entry_old, mac_table_entry)){
+    mac_table->aging_timer = register_app_event(nw_get_timer(),
+            mac_table_aging_timer_cb, &mac_table, sizeof(mac_table_t *),
+            NW_TIMER_TICK_SEC, 1);
+}
 
-        return FALSE;
-    }
+bool_t
+mac_table_set_aging_time(mac_table_t *mac_table, unsigned int aging_time){
 
-    if(mac_table_entry_old){
-        delete_mac_table_entry(mac_table, mac_table_entry_old->mac.mac);
+    if(aging_time > MAC_TABLE_MAX_AGING_TIME){
+        printf("Error : MAC aging time must be in range [0-%u] sec\n",
+                MAC_TABLE_MAX_AGING_TIME);
+        return FALSE;
     }
 
-    init_glthread(&mac_table_entry->mac_entry_glue);
-    glthread_add_next(&mac_table->mac_entries, &mac_table_entry->mac_entry_glue);
+    pthread_mutex_lock(&mac_table->lock);
+    mac_table->aging_time = aging_time;
+    pthread_mutex_unlock(&mac_table->lock);
     return TRUE;
 }
 
+void
+clear_mac_table(mac_table_t *mac_table){
+
+    pthread_mutex_lock(&mac_table->lock);
+    memset(mac_table->entries, 0, mac_table->size * sizeof(mac_table_entry_t));
+    mac_table->n_entries = 0;
+    pthread_mutex_unlock(&mac_table->lock);
+}
+
 void
 dump_mac_table(mac_table_t *mac_table){
 
-    glthread_t *curr;
+    unsigned int i;
     mac_table_entry_t *mac_table_entry;
 
-    ITERATE_GLTHREAD_BEGIN(&mac_table->mac_entries, curr){
+    pthread_mutex_lock(&mac_table->lock);
+
+    for(i = 0; i < mac_table->size; i++){
 
-        mac_table_entry = mac_entry_glue_to_mac_entry(curr);
-        printf("\tMAC : %u:%u:%u:%u:%u:%u   | Intf : %s\n", 
+        mac_table_entry = &mac_table->entries[i];
+        if(!mac_table_entry->oif) continue;
+        printf("\tMAC : %u:%u:%u:%u:%u:%u   | VLAN : %-4u | Intf : %s\n", 
             mac_table_entry->mac.mac[0], 
             mac_table_entry->mac.mac[1],
             mac_table_entry->mac.mac[2],
             mac_table_entry->mac.mac[3], 
             mac_table_entry->mac.mac[4],
             mac_table_entry->mac.mac[5],
-            mac_table_entry->oif_name);
-    } ITERATE_GLTHREAD_END(&mac_table->mac_entries, curr);
+            mac_table_entry->vlan_id,
+            mac_table_entry->oif->if_name);
+    }
+
+    printf("Entries : %u, Learned : %llu, Aged : %llu, Aging time : %u sec\n",
+            mac_table->n_entries, mac_table->n_learned, mac_table->n_aged,
+            mac_table->aging_time);
+    pthread_mutex_unlock(&mac_table->lock);
 }
 
-static void
-l2_switch_perform_mac_learning(node_t *node, char *src_mac, char *if_name){
+/*L2 switch floods frames of the vlan out of the interface*/
+static inline bool_t
+l2_flood_list_member(interface_t *intf, unsigned int vlan_id, bool_t *untag){
+
+    if(IS_INTF_L3_MODE(intf) ||
+        stp_port_state(intf) != STP_PORT_FORWARDING)
+        return FALSE;
+
+    switch(IF_L2_MODE(intf)){
+        case ACCESS:
+            *untag = vlan_id != 0;
+            return IF_ACCESS_VLAN(intf) == vlan_id;
+        case TRUNK:
+            *untag = FALSE;
+            return vlan_id && IF_IS_VLAN_SET(intf, vlan_id);
+        default:
+            return FALSE;
+    }
+}
+
+/*Returns NULL if no interface of the node floods frames of the vlan*/
+static l2_flood_list_t *
+l2_flood_list_build(node_t *node, unsigned int vlan_id){
+
+    unsigned int i, n_intf = 0, n_untag = 0, n_as_is = 0;
+    bool_t untag;
+    interface_t *intf;
+    l2_flood_list_t *flood_list;
+
+    for(i = 0; i < node->n_intf; i++){
+        if(!l2_flood_list_member(node->intf[i], vlan_id, &untag)) continue;
+        n_intf++;
+        if(untag) n_untag++;
+    }
+
+    if(!n_intf)
+        return NULL;
+
+    flood_list = calloc(1, sizeof(l2_flood_list_t) +
+                        n_intf * sizeof(interface_t *));
+    flood_list->n_intf = n_intf;
+    flood_list->n_untag = n_untag;
+
+    for(i = 0; i < node->n_intf; i++){
+        intf = node->intf[i];
+        if(!l2_flood_list_member(intf, vlan_id, &untag)) continue;
+        if(untag)
+            flood_list->intf[n_intf - n_untag--] = intf;
+        else
+            flood_list->intf[n_as_is++] = intf;
+    }
+    return flood_list;
+}
+
+static l2_flood_table_t *
+l2_flood_table_get(node_t *node){
+
+    l2_flood_table_t *flood_table = NODE_FLOOD_TABLE(node);
+
+    if(flood_table)
+        return flood_table;
+
+    flood_table = calloc(1, sizeof(l2_flood_table_t));
+    pthread_rwlock_init(&flood_table->lock, NULL);
+    __atomic_store_n(&NODE_FLOOD_TABLE(node), flood_table, __ATOMIC_RELEASE);
+    return flood_table;
+}
+
+void
+l2_switch_rebuild_flood_list(node_t *node, unsigned int vlan_id){
+
+    l2_flood_list_t *flood_list, *old_flood_list;
+    l2_flood_table_t *flood_table;
+
+    if(vlan_id > VLAN_ID_MAX)
+        return;
+
+    if(!NODE_FLOOD_TABLE(node)){
+        flood_list = l2_flood_list_build(node, vlan_id);
+        if(!flood_list)
+            return;
+        free(flood_list);
+    }
+
+    flood_table = l2_flood_table_get(node);
+
+    /* Interface state is read under the lock, so that the last of two
+     * concurrent rebuilds (CLI and spanning tree) sees the latest*/
+    pthread_rwlock_wrlock(&flood_table->lock);
+    flood_list = l2_flood_list_build(node, vlan_id);
+    old_flood_list = flood_table->lists[vlan_id];
+    flood_table->lists[vlan_id] = flood_list;
+    pthread_rwlock_unlock(&flood_table->lock);
+
+    free(old_flood_list);
+}
 
-    bool_t rc;
-    mac_table_entry_t *mac_table_entry = calloc(1, sizeof(mac_table_entry_t));
-    memcpy(mac_table_entry->mac.mac, src_mac, sizeof(mac_add_t));
-    strncpy(mac_table_entry->oif_name, if_name, IF_NAME_SIZE);
-    mac_table_entry->oif_name[IF_NAME_SIZE - 1] = '\0';
-    rc = mac_table_entry_add(NODE_MAC_TABLE(node), mac_table_entry);
-    if(rc == FALSE){
-        free(mac_table_entry);
+void
+l2_switch_rebuild_flood_lists(node_t *node){
+
+    unsigned int i, vlan_id;
+    interface_t *intf;
+    l2_flood_table_t *flood_table = NODE_FLOOD_TABLE(node);
+    uint64_t vlans[VLAN_BITMAP_WORDS];
+
+    /*Vlans of the L2 interfaces of the node, and vlans listed so far*/
+    memset(vlans, 0, sizeof(vlans));
+    for(i = 0; i < node->n_intf; i++){
+
+        intf = node->intf[i];
+        if(IS_INTF_L3_MODE(intf)) continue;
+
+        if(IF_L2_MODE(intf) == ACCESS)
+            vlans[IF_ACCESS_VLAN(intf) >> 6] |= VLAN_BIT(IF_ACCESS_VLAN(intf));
+        else if(IF_L2_MODE(intf) == TRUNK){
+            for(vlan_id = 0; vlan_id < VLAN_BITMAP_WORDS; vlan_id++)
+                vlans[vlan_id] |= intf->intf_nw_props.vlan_bitmap[vlan_id];
+        }
+    }
+
+    for(vlan_id = 0; vlan_id <= VLAN_ID_MAX; vlan_id++){
+        if((vlans[vlan_id >> 6] & VLAN_BIT(vlan_id)) ||
+            (flood_table && flood_table->lists[vlan_id]))
+            l2_switch_rebuild_flood_list(node, vlan_id);
     }
 }
 
+/* Send the tagged frame out of 'oif' untagged, the frame is untagged
+ * in place unless the buffer is shared*/
+static bool_t
+l2_switch_send_pkt_untagged(pkt_buffer_t *pkt_buf, interface_t *oif){
+
+    unsigned int new_pkt_size = 0;
+    ethernet_hdr_t *ethernet_hdr;
+    pkt_buffer_t *pkt_buf_wr = pkt_buffer_unshare(pkt_buf);
+
+    if(!pkt_buf_wr)
+        return FALSE;
+
+    ethernet_hdr = untag_pkt_with_vlan_id(
+                        (ethernet_hdr_t *)pkt_buf_wr->data,
+                        pkt_buf_wr->len,
+                        &new_pkt_size);
+    send_pkt_out((char *)ethernet_hdr, new_pkt_size, oif);
+    if(pkt_buf_wr != pkt_buf)
+        pkt_buffer_free(pkt_buf_wr);
+    return TRUE;
+}
+
+/* Frames flooded out of several interfaces share the same buffer,
+ * the buffer is modified only after pkt_buffer_unshare()*/
 static bool_t
-l2_switch_send_pkt_out(char *pkt, unsigned int pkt_size,
-                        interface_t *oif){
+l2_switch_send_pkt_out(pkt_buffer_t *pkt_buf, interface_t *oif){
 
     /*L2 switch must not even try to send the pkt out of interface 
       operating in L3 mode*/
@@ -175,6 +502,8 @@ l2_switch_send_pkt_out(char *pkt, unsigned int pkt_size,
         return FALSE;
     }
     
+    char *pkt = pkt_buf->data;
+    unsigned int pkt_size = pkt_buf->len;
     ethernet_hdr_t *ethernet_hdr = (ethernet_hdr_t *)pkt;
 
     vlan_8021q_hdr_t *vlan_8021q_hdr =
@@ -207,12 +536,7 @@ l2_switch_send_pkt_out(char *pkt, unsigned int pkt_size,
                 if(vlan_8021q_hdr && 
                         (intf_vlan_id == GET_802_1Q_VLAN_ID(vlan_8021q_hdr))){
 
-                    unsigned int new_pkt_size = 0;
-                    ethernet_hdr = untag_pkt_with_vlan_id(ethernet_hdr,
-                                                          pkt_size,
-                                                          &new_pkt_size);
-                    send_pkt_out((char *)ethernet_hdr, new_pkt_size, oif);
-                    return TRUE;
+                    return l2_switch_send_pkt_untagged(pkt_buf, oif);
                 }
 
                 /*case 4 : if oif is vlan unaware but pkt is vlan tagged, 
@@ -248,74 +572,507 @@ l2_switch_send_pkt_out(char *pkt, unsigned int pkt_size,
     }
 }
 
+/* Flood the frame out of the interfaces of the flood list of its vlan.
+ * All the egress interfaces share the one buffer of the frame : the
+ * flood holds a reference of its own while interfaces which send the
+ * frame as is are served, and while interfaces which must untag the
+ * frame work on private copies. The reference is dropped before the
+ * last interface which untags, so that one untags in place*/
 static bool_t 
 l2_switch_flood_pkt_out(node_t *node, interface_t *exempted_intf,
-                        char *pkt, unsigned int pkt_size){
+                        pkt_buffer_t *pkt_buf){
+
+    int i, n_as_is, last_untag;
+    unsigned int vlan_id = 0;
+    interface_t *oif;
+    l2_flood_list_t *flood_list;
+    l2_flood_table_t *flood_table =
+        __atomic_load_n(&NODE_FLOOD_TABLE(node), __ATOMIC_ACQUIRE);
+    vlan_8021q_hdr_t *vlan_8021q_hdr =
+        is_pkt_vlan_tagged((ethernet_hdr_t *)pkt_buf->data);
+
+    if(!flood_table)
+        return FALSE;
+
+    if(vlan_8021q_hdr)
+        vlan_id = GET_802_1Q_VLAN_ID(vlan_8021q_hdr);
+
+    pthread_rwlock_rdlock(&flood_table->lock);
 
-    interface_t *oif = NULL;
+    flood_list = flood_table->lists[vlan_id];
+    if(!flood_list){
+        pthread_rwlock_unlock(&flood_table->lock);
+        return FALSE;
+    }
 
-    unsigned int i = 0;
+    pkt_buffer_get(pkt_buf);
 
-    char *pkt_copy = NULL;
-    char *temp_pkt = calloc(1, MAX_PACKET_BUFFER_SIZE);
+    n_as_is = flood_list->n_intf - flood_list->n_untag;
+    for(i = 0; i < n_as_is; i++){
+        oif = flood_list->intf[i];
+        if(oif == exempted_intf) continue;
+        send_pkt_out(pkt_buf->data, pkt_buf->len, oif);
+    }
 
-    pkt_copy = temp_pkt + MAX_PACKET_BUFFER_SIZE - pkt_size;
+    last_untag = flood_list->n_intf - 1;
+    if(last_untag >= n_as_is && flood_list->intf[last_untag] == exempted_intf)
+        last_untag--;
 
-    for( ; i < MAX_INTF_PER_NODE; i++){
-        
-        oif = node->intf[i];
-        if(!oif) break;
-        if(oif == exempted_intf || 
-            IS_INTF_L3_MODE(oif)) continue;
-        
-        memcpy(pkt_copy, pkt, pkt_size);
-        l2_switch_send_pkt_out(pkt_copy, pkt_size, oif);
+    for(i = n_as_is; i <= last_untag; i++){
+        oif = flood_list->intf[i];
+        if(oif == exempted_intf) continue;
+        if(i == last_untag)
+            pkt_buffer_free(pkt_buf);
+        l2_switch_send_pkt_untagged(pkt_buf, oif);
     }
-    free(temp_pkt);
+
+    pthread_rwlock_unlock(&flood_table->lock);
+
+    if(last_untag < n_as_is)
+        pkt_buffer_free(pkt_buf);
+    return TRUE;
 }
 
+/* oif : interface the dst MAC was learned on, NULL if the dst MAC is
+ * broadcast or not learned, the frame is flooded then*/
 static void
 l2_switch_forward_frame(node_t *node, interface_t *recv_intf, 
-                        ethernet_hdr_t *ethernet_hdr, 
-                        unsigned int pkt_size){
+                        pkt_buffer_t *pkt_buf, interface_t *oif){
 
-    /*If dst mac is broadcast mac, then flood the frame*/
-    if(IS_MAC_BROADCAST_ADDR(ethernet_hdr->dst_mac.mac)){
-        l2_switch_flood_pkt_out(node, recv_intf, (char *)ethernet_hdr, pkt_size);
+    if(!oif){
+        l2_switch_flood_pkt_out(node, recv_intf, pkt_buf);
         return;
     }
 
-    /*Check the mac table to forward the frame*/
-    mac_table_entry_t *mac_table_entry = 
-        mac_table_lookup(NODE_MAC_TABLE(node), ethernet_hdr->dst_mac.mac);
+    /* The dst is on the segment the frame came from. Sending it back
+     * would bounce it between two switches that each flushed the MAC
+     * on the other side after a topology change*/
+    if(oif == recv_intf)
+        return;
 
-    if(!mac_table_entry){
-        l2_switch_flood_pkt_out(node, recv_intf, (char *)ethernet_hdr, pkt_size);
+    /*Spanning tree blocked the interface after the MAC was learned*/
+    if(stp_port_state(oif) != STP_PORT_FORWARDING)
         return;
+
+    l2_switch_send_pkt_out(pkt_buf, oif);
+}
+
+/*ARP suppression*/
+
+static inline unsigned int
+arp_suppr_hash(arp_suppr_table_t *arp_suppr_table, uint32_t ip_addr,
+               unsigned int vlan_id){
+
+    uint64_t key = ((uint64_t)vlan_id << 32) | ip_addr;
+
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (unsigned int)key & (arp_suppr_table->size - 1);
+}
+
+/* Slot holding (ip_addr, vlan_id), else the free slot ending its probe
+ * sequence*/
+static arp_suppr_entry_t *
+arp_suppr_probe(arp_suppr_table_t *arp_suppr_table, uint32_t ip_addr,
+                unsigned int vlan_id){
+
+    unsigned int slot = arp_suppr_hash(arp_suppr_table, ip_addr, vlan_id);
+    arp_suppr_entry_t *arp_suppr_entry;
+
+    while(1){
+        arp_suppr_entry = &arp_suppr_table->entries[slot];
+        if(!arp_suppr_entry->ip_addr ||
+            (arp_suppr_entry->ip_addr == ip_addr &&
+             arp_suppr_entry->vlan_id == vlan_id))
+            return arp_suppr_entry;
+        slot = (slot + 1) & (arp_suppr_table->size - 1);
     }
+}
 
-    char *oif_name = mac_table_entry->oif_name;
-    interface_t *oif = get_node_if_by_name(node, oif_name);
+/*Double the no of slots, rehash all the entries*/
+static bool_t
+arp_suppr_table_grow(arp_suppr_table_t *arp_suppr_table){
 
-    if(!oif){
+    unsigned int i, old_size = arp_suppr_table->size;
+    arp_suppr_entry_t *old_entries = arp_suppr_table->entries;
+    arp_suppr_entry_t *new_entries = calloc(old_size * 2, sizeof(arp_suppr_entry_t));
+
+    if(!new_entries)
+        return FALSE;
+
+    arp_suppr_table->entries = new_entries;
+    arp_suppr_table->size = old_size * 2;
+
+    for(i = 0; i < old_size; i++){
+        if(!old_entries[i].ip_addr) continue;
+        *arp_suppr_probe(arp_suppr_table, old_entries[i].ip_addr,
+                old_entries[i].vlan_id) = old_entries[i];
+    }
+    free(old_entries);
+    return TRUE;
+}
+
+/* Free the slot, and move back the entries after it which would no
+ * longer be found past the free slot, as mac_table_delete_slot()*/
+static void
+arp_suppr_delete_slot(arp_suppr_table_t *arp_suppr_table, unsigned int hole){
+
+    unsigned int slot = hole, home;
+    unsigned int mask = arp_suppr_table->size - 1;
+    arp_suppr_entry_t *arp_suppr_entry;
+
+    while(1){
+        slot = (slot + 1) & mask;
+        arp_suppr_entry = &arp_suppr_table->entries[slot];
+        if(!arp_suppr_entry->ip_addr)
+            break;
+        home = arp_suppr_hash(arp_suppr_table, arp_suppr_entry->ip_addr,
+                arp_suppr_entry->vlan_id);
+        /*Entry stays if its home lies cyclically in (hole, slot]*/
+        if(((slot - home) & mask) < ((slot - hole) & mask))
+            continue;
+        arp_suppr_table->entries[hole] = *arp_suppr_entry;
+        hole = slot;
+    }
+
+    memset(&arp_suppr_table->entries[hole], 0, sizeof(arp_suppr_entry_t));
+    arp_suppr_table->n_entries--;
+    arp_suppr_table->n_removed++;
+}
+
+/* The last ARP reply from an IP wins. Returns FALSE if the binding is
+ * new and the cache is full*/
+static bool_t
+arp_suppr_learn(arp_suppr_table_t *arp_suppr_table, uint32_t ip_addr,
+                unsigned int vlan_id, char *mac){
+
+    arp_suppr_entry_t *arp_suppr_entry =
+        arp_suppr_probe(arp_suppr_table, ip_addr, vlan_id);
+
+    if(!arp_suppr_entry->ip_addr){
+
+        if(arp_suppr_table->n_entries == ARP_SUPPR_TABLE_MAX_ENTRIES)
+            return FALSE;
+
+        if((arp_suppr_table->n_entries + 1) * 100 >
+                arp_suppr_table->size * ARP_SUPPR_TABLE_MAX_LOAD_PCT){
+            if(!arp_suppr_table_grow(arp_suppr_table))
+                return FALSE;
+            arp_suppr_entry = arp_suppr_probe(arp_suppr_table, ip_addr, vlan_id);
+        }
+
+        arp_suppr_entry->ip_addr = ip_addr;
+        arp_suppr_entry->vlan_id = vlan_id;
+        arp_suppr_table->n_entries++;
+    }
+
+    memcpy(arp_suppr_entry->mac.mac, mac, sizeof(mac_add_t));
+    arp_suppr_entry->last_seen = arp_suppr_table->now;
+    return TRUE;
+}
+
+/* One tick of the aging timer : advance the clock of the table and
+ * sweep the next bucket of slots, the whole table is swept every
+ * ARP_SUPPR_AGING_TIME / 2*/
+static void
+arp_suppr_age_out(arp_suppr_table_t *arp_suppr_table){
+
+    unsigned int slot, n_slots, n_visited = 0;
+    unsigned int n_sweep_ticks = ARP_SUPPR_AGING_TIME / 2 / NW_TIMER_TICK_SEC;
+    arp_suppr_entry_t *arp_suppr_entry;
+
+    pthread_mutex_lock(&arp_suppr_table->lock);
+
+    arp_suppr_table->now += NW_TIMER_TICK_SEC;
+
+    if(!arp_suppr_table->n_entries){
+        pthread_mutex_unlock(&arp_suppr_table->lock);
         return;
     }
 
-    l2_switch_send_pkt_out((char *)ethernet_hdr, pkt_size, oif);
+    n_slots = (arp_suppr_table->size + n_sweep_ticks - 1) / n_sweep_ticks;
+    slot = arp_suppr_table->sweep_slot & (arp_suppr_table->size - 1);
+
+    while(n_visited < n_slots){
+
+        arp_suppr_entry = &arp_suppr_table->entries[slot];
+
+        if(arp_suppr_entry->ip_addr &&
+            arp_suppr_table->now - arp_suppr_entry->last_seen >= ARP_SUPPR_AGING_TIME){
+            /*Visit the slot again, an entry may have moved back into it*/
+            arp_suppr_delete_slot(arp_suppr_table, slot);
+            continue;
+        }
+        slot = (slot + 1) & (arp_suppr_table->size - 1);
+        n_visited++;
+    }
+
+    arp_suppr_table->sweep_slot = slot;
+    pthread_mutex_unlock(&arp_suppr_table->lock);
+}
+
+static void
+arp_suppr_aging_timer_cb(void *arg, int arg_size){
+
+    arp_suppr_age_out(*(arp_suppr_table_t **)arg);
+}
+
+void
+l2_switch_set_arp_suppression(node_t *node, bool_t enable){
+
+    arp_suppr_table_t *arp_suppr_table = NODE_ARP_SUPPR_TABLE(node);
+
+    if(!arp_suppr_table){
+
+        if(!enable)
+            return;
+
+        arp_suppr_table = calloc(1, sizeof(arp_suppr_table_t));
+        arp_suppr_table->entries = calloc(ARP_SUPPR_TABLE_INIT_SIZE,
+                                        sizeof(arp_suppr_entry_t));
+        arp_suppr_table->size = ARP_SUPPR_TABLE_INIT_SIZE;
+        pthread_mutex_init(&arp_suppr_table->lock, NULL);
+        __atomic_store_n(&NODE_ARP_SUPPR_TABLE(node), arp_suppr_table,
+                         __ATOMIC_RELEASE);
+        arp_suppr_table->aging_timer = register_app_event(nw_get_timer(),
+                arp_suppr_aging_timer_cb, &arp_suppr_table,
+                sizeof(arp_suppr_table_t *), NW_TIMER_TICK_SEC, 1);
+    }
+
+    pthread_mutex_lock(&arp_suppr_table->lock);
+    if(!enable){
+        memset(arp_suppr_table->entries, 0,
+                arp_suppr_table->size * sizeof(arp_suppr_entry_t));
+        arp_suppr_table->n_entries = 0;
+    }
+    __atomic_store_n(&arp_suppr_table->enabled, enable, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&arp_suppr_table->lock);
+}
+
+void
+dump_arp_suppr_table(node_t *node){
+
+    unsigned int i;
+    char ip_addr[16];
+    arp_suppr_entry_t *arp_suppr_entry;
+    arp_suppr_table_t *arp_suppr_table = NODE_ARP_SUPPR_TABLE(node);
+
+    if(!arp_suppr_table){
+        printf("ARP suppression not enabled\n");
+        return;
+    }
+
+    pthread_mutex_lock(&arp_suppr_table->lock);
+
+    for(i = 0; i < arp_suppr_table->size; i++){
+
+        arp_suppr_entry = &arp_suppr_table->entries[i];
+        if(!arp_suppr_entry->ip_addr) continue;
+        printf("\tIP : %-15s | VLAN : %-4u | MAC : %u:%u:%u:%u:%u:%u\n",
+            tcp_ip_covert_ip_n_to_p(arp_suppr_entry->ip_addr, ip_addr),
+            arp_suppr_entry->vlan_id,
+            arp_suppr_entry->mac.mac[0],
+            arp_suppr_entry->mac.mac[1],
+            arp_suppr_entry->mac.mac[2],
+            arp_suppr_entry->mac.mac[3],
+            arp_suppr_entry->mac.mac[4],
+            arp_suppr_entry->mac.mac[5]);
+    }
+
+    printf("ARP suppression : %s, Entries : %u, Aging time : %u sec\n",
+            arp_suppr_table->enabled ? "enabled" : "disabled",
+            arp_suppr_table->n_entries, ARP_SUPPR_AGING_TIME);
+    printf("Replies snooped : %llu, not snooped cache full : %llu, "
+            "Bindings removed : %llu\n", arp_suppr_table->n_snooped,
+            arp_suppr_table->n_full, arp_suppr_table->n_removed);
+    printf("Requests : suppressed %llu, flooded %llu\n",
+            __atomic_load_n(&arp_suppr_table->n_suppressed, __ATOMIC_RELAXED),
+            __atomic_load_n(&arp_suppr_table->n_flooded, __ATOMIC_RELAXED));
+    pthread_mutex_unlock(&arp_suppr_table->lock);
+}
+
+/* ARP reply of 'target_mac' to the ARP request, sent back out of the
+ * interface the request came in on, tagged as the request was*/
+static void
+l2_switch_send_arp_reply(interface_t *oif, ethernet_hdr_t *ethernet_hdr_req,
+                         char *target_mac, unsigned int vlan_id){
+
+    unsigned int pkt_size = ETH_HDR_SIZE_EXCL_PAYLOAD + sizeof(arp_hdr_t);
+    arp_hdr_t *arp_hdr_req = (arp_hdr_t *)GET_ETHERNET_HDR_PAYLOAD(ethernet_hdr_req);
+    ethernet_hdr_t *ethernet_hdr;
+    arp_hdr_t *arp_hdr;
+    pkt_buffer_t *pkt_buf = pkt_buffer_alloc(pkt_size + sizeof(vlan_8021q_hdr_t));
+
+    if(!pkt_buf)
+        return;
+
+    ethernet_hdr = (ethernet_hdr_t *)pkt_buffer_put(pkt_buf, pkt_size);
+    memset((char *)ethernet_hdr, 0, pkt_size);
+
+    memcpy(ethernet_hdr->dst_mac.mac, ethernet_hdr_req->src_mac.mac, sizeof(mac_add_t));
+    memcpy(ethernet_hdr->src_mac.mac, target_mac, sizeof(mac_add_t));
+    ethernet_hdr->type = ARP_MSG;
+
+    arp_hdr = (arp_hdr_t *)ethernet_hdr->payload;
+    arp_hdr->hw_type = 1;
+    arp_hdr->proto_type = 0x0800;
+    arp_hdr->hw_addr_len = sizeof(mac_add_t);
+    arp_hdr->proto_addr_len = 4;
+    arp_hdr->op_code = ARP_REPLY;
+    memcpy(arp_hdr->src_mac.mac, target_mac, sizeof(mac_add_t));
+    arp_hdr->src_ip = arp_hdr_req->dst_ip;
+    memcpy(arp_hdr->dst_mac.mac, arp_hdr_req->src_mac.mac, sizeof(mac_add_t));
+    arp_hdr->dst_ip = arp_hdr_req->src_ip;
+
+    SET_COMMON_ETH_FCS(ethernet_hdr, sizeof(arp_hdr_t), 0); /*Not used*/
+
+    if(vlan_id){
+        ethernet_hdr = tag_pkt_with_vlan_id(ethernet_hdr, pkt_size,
+                                            vlan_id, &pkt_size);
+        pkt_buffer_set_data(pkt_buf, (char *)ethernet_hdr, pkt_size);
+    }
+
+    l2_switch_send_pkt_out(pkt_buf, oif);
+    pkt_buffer_free(pkt_buf);
+}
+
+/* Snoop the ARP replies into the ARP suppression cache, and answer the
+ * ARP requests the cache can. Returns TRUE if the frame was an ARP
+ * request answered, which is not flooded then*/
+static bool_t
+l2_switch_arp_suppress(node_t *node, interface_t *recv_intf,
+                       pkt_buffer_t *pkt_buf, unsigned int vlan_id){
+
+    arp_suppr_table_t *arp_suppr_table =
+        __atomic_load_n(&NODE_ARP_SUPPR_TABLE(node), __ATOMIC_ACQUIRE);
+    ethernet_hdr_t *ethernet_hdr = (ethernet_hdr_t *)pkt_buf->data;
+    mac_table_t *mac_table = NODE_MAC_TABLE(node);
+    mac_table_entry_t *mac_table_entry;
+    arp_suppr_entry_t *arp_suppr_entry;
+    arp_hdr_t *arp_hdr;
+    unsigned short type;
+    mac_add_t target_mac;
+    bool_t hit = FALSE, mac_known = TRUE;
+
+    if(!arp_suppr_table ||
+        !__atomic_load_n(&arp_suppr_table->enabled, __ATOMIC_RELAXED))
+        return FALSE;
+
+    type = is_pkt_vlan_tagged(ethernet_hdr) ?
+        ((vlan_ethernet_hdr_t *)ethernet_hdr)->type : ethernet_hdr->type;
+
+    if(type != ARP_MSG || pkt_buf->len <
+        GET_ETH_HDR_SIZE_EXCL_PAYLOAD(ethernet_hdr) + sizeof(arp_hdr_t))
+        return FALSE;
+
+    arp_hdr = (arp_hdr_t *)GET_ETHERNET_HDR_PAYLOAD(ethernet_hdr);
+
+    if(arp_hdr->op_code == ARP_REPLY){
+        if(arp_hdr->src_ip){
+            pthread_mutex_lock(&arp_suppr_table->lock);
+            if(arp_suppr_table->enabled){
+                if(arp_suppr_learn(arp_suppr_table, arp_hdr->src_ip, vlan_id,
+                                arp_hdr->src_mac.mac))
+                    arp_suppr_table->n_snooped++;
+                else
+                    arp_suppr_table->n_full++;
+            }
+            pthread_mutex_unlock(&arp_suppr_table->lock);
+        }
+        return FALSE;
+    }
+
+    /*Gratuitous ARPs announce a binding to all, they are flooded*/
+    if(arp_hdr->op_code != ARP_BROAD_REQ || !arp_hdr->dst_ip ||
+        arp_hdr->dst_ip == arp_hdr->src_ip)
+        return FALSE;
+
+    pthread_mutex_lock(&arp_suppr_table->lock);
+    arp_suppr_entry = arp_suppr_probe(arp_suppr_table, arp_hdr->dst_ip, vlan_id);
+    if(arp_suppr_entry->ip_addr){
+        target_mac = arp_suppr_entry->mac;
+        hit = TRUE;
+    }
+    else
+        arp_suppr_entry = NULL;
+    pthread_mutex_unlock(&arp_suppr_table->lock);
+
+    /* The binding is trusted while the MAC table knows the MAC, and is
+     * removed once the MAC aged out or was flushed. A MAC learned on the
+     * interface the request came in on is answered by its host or by a
+     * switch closer to it*/
+    if(hit){
+        pthread_mutex_lock(&mac_table->lock);
+        mac_table_entry = mac_table_lookup(mac_table, target_mac.mac, vlan_id);
+        mac_known = mac_table_entry != NULL;
+        hit = mac_known && mac_table_entry->oif != recv_intf;
+        pthread_mutex_unlock(&mac_table->lock);
+    }
+
+    if(hit == FALSE && mac_known == FALSE && arp_suppr_entry){
+        pthread_mutex_lock(&arp_suppr_table->lock);
+        arp_suppr_entry = arp_suppr_probe(arp_suppr_table, arp_hdr->dst_ip, vlan_id);
+        /*Unless a reply refreshed the binding meanwhile*/
+        if(arp_suppr_entry->ip_addr &&
+            memcmp(arp_suppr_entry->mac.mac, target_mac.mac, sizeof(mac_add_t)) == 0)
+            arp_suppr_delete_slot(arp_suppr_table,
+                    arp_suppr_entry - arp_suppr_table->entries);
+        pthread_mutex_unlock(&arp_suppr_table->lock);
+    }
+
+    if(!hit){
+        __atomic_fetch_add(&arp_suppr_table->n_flooded, 1, __ATOMIC_RELAXED);
+        return FALSE;
+    }
+
+    __atomic_fetch_add(&arp_suppr_table->n_suppressed, 1, __ATOMIC_RELAXED);
+    l2_switch_send_arp_reply(recv_intf, ethernet_hdr, target_mac.mac,
+            is_pkt_vlan_tagged(ethernet_hdr) ? vlan_id : 0);
+    return TRUE;
 }
 
 void
 l2_switch_recv_frame(interface_t *interface, 
-                     char *pkt, unsigned int pkt_size){
+                     pkt_buffer_t *pkt_buf){
 
     node_t *node = interface->att_node;
 
-    ethernet_hdr_t *ethernet_hdr = (ethernet_hdr_t *)pkt;
+    ethernet_hdr_t *ethernet_hdr = (ethernet_hdr_t *)pkt_buf->data;
 
     char *dst_mac = (char *)ethernet_hdr->dst_mac.mac;
     char *src_mac = (char *)ethernet_hdr->src_mac.mac;
+    mac_table_t *mac_table = NODE_MAC_TABLE(node);
+    mac_table_entry_t *mac_table_entry;
+    interface_t *oif;
+    stp_port_state_t stp_state = stp_port_state(interface);
+
+    /*Blocked interface neither learns nor forwards*/
+    if(stp_state == STP_PORT_DISCARDING)
+        return;
+
+    /*MACs are learned per VLAN, untagged frames are in VLAN 0*/
+    unsigned int vlan_id = 0;
+    vlan_8021q_hdr_t *vlan_8021q_hdr = is_pkt_vlan_tagged(ethernet_hdr);
+
+    if(vlan_8021q_hdr)
+        vlan_id = GET_802_1Q_VLAN_ID(vlan_8021q_hdr);
+
+    /*Learn the src MAC and look up the dst MAC under one lock*/
+    pthread_mutex_lock(&mac_table->lock);
+    mac_table_learn(mac_table, src_mac, vlan_id, interface);
+    mac_table_entry = IS_MAC_BROADCAST_ADDR(dst_mac) ? NULL :
+        mac_table_lookup(mac_table, dst_mac, vlan_id);
+    oif = mac_table_entry ? mac_table_entry->oif : NULL;
+    pthread_mutex_unlock(&mac_table->lock);
+
+    /*Interface in learning state learns only*/
+    if(stp_state != STP_PORT_FORWARDING)
+        return;
+
+    if(l2_switch_arp_suppress(node, interface, pkt_buf, vlan_id))
+        return;
 
-    l2_switch_perform_mac_learning(node, src_mac, interface->if_name);
-    l2_switch_forward_frame(node, interface, ethernet_hdr, pkt_size);
+    l2_switch_forward_frame(node, interface, pkt_buf, oif);
 }
 
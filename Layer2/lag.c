@@ -0,0 +1,332 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  lag.c
+ *
+ *    Description:  This file implements link aggregation groups (LAGs) : logical interfaces
+ *    bundling several links to the same nbr, the flows sent out of a LAG are spread over
+ *    its members by the hash of their L2/L3/L4 hdrs, and moved off a member which goes down
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 02:41:09 PM
+ *       Revision:  1.0
+ *       Compiler:  gcc
+ *
+ *        This file is part of the NetworkGraph distribution (https://github.com/sachinites).
+ *        Copyright (c) 2017 Abhishek Sagar.
+ *        This program is free software: you can redistribute it and/or modify
+ *        it under the terms of the GNU General Public License as published by
+ *        the Free Software Foundation, version 3.
+ *
+ *        This program is distributed in the hope that it will be useful, but
+ *        WITHOUT ANY WARRANTY; without even the implied warranty of
+ *        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *        General Public License for more details.
+ *
+ *        You should have received a copy of the GNU General Public License
+ *        along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =====================================================================================
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <memory.h>
+#include "../graph.h"
+#include "layer2.h"
+#include "../Layer3/layer3.h"
+
+static char *
+lag_hash_mode_str(lag_hash_mode_t hash_mode){
+
+    switch(hash_mode){
+        case LAG_HASH_L2:
+            return "l2";
+        case LAG_HASH_L3:
+            return "l3";
+        default:
+            return "l4";
+    }
+}
+
+static inline uint32_t
+lag_hash_mix(uint32_t hash, uint32_t val){
+
+    hash = (hash ^ val) * 0x9E3779B1U;
+    return hash ^ (hash >> 16);
+}
+
+/*Final avalanche of murmur3, low bits of the hash index the slots*/
+static inline uint32_t
+lag_hash_final(uint32_t hash){
+
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6BU;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35U;
+    return hash ^ (hash >> 16);
+}
+
+/* Hash of the hdrs of the frame selected by the hash mode. Frames
+ * which are not IP, or too short for the hdrs, are hashed on the hdrs
+ * they have*/
+static uint32_t
+lag_hash_frame(lag_hash_mode_t hash_mode, char *pkt, unsigned int pkt_size){
+
+    ethernet_hdr_t *ethernet_hdr = (ethernet_hdr_t *)pkt;
+    char *payload = GET_ETHERNET_HDR_PAYLOAD(ethernet_hdr);
+    unsigned int payload_offset = payload - pkt;
+    unsigned short type;
+    uint32_t macs[3], ports, hash = 2166136261U;
+    ip_hdr_t *ip_hdr;
+
+    /*dst and src MAC*/
+    memcpy(macs, pkt, sizeof(macs));
+    hash = lag_hash_mix(hash, macs[0]);
+    hash = lag_hash_mix(hash, macs[1]);
+    hash = lag_hash_mix(hash, macs[2]);
+
+    type = is_pkt_vlan_tagged(ethernet_hdr) ?
+        ((vlan_ethernet_hdr_t *)ethernet_hdr)->type : ethernet_hdr->type;
+
+    if(hash_mode == LAG_HASH_L2 || type != ETH_IP ||
+        pkt_size < payload_offset + sizeof(ip_hdr_t))
+        return lag_hash_final(hash);
+
+    ip_hdr = (ip_hdr_t *)payload;
+    hash = lag_hash_mix(hash, ip_hdr->src_ip);
+    hash = lag_hash_mix(hash, ip_hdr->dst_ip);
+
+    if(hash_mode == LAG_HASH_L3 ||
+        pkt_size < payload_offset + IP_HDR_LEN_IN_BYTES(ip_hdr) + sizeof(ports))
+        return lag_hash_final(hash);
+
+    memcpy(&ports, INCREMENT_IPHDR(ip_hdr), sizeof(ports));
+    hash = lag_hash_mix(hash, (unsigned char)ip_hdr->protocol);
+    hash = lag_hash_mix(hash, ports);
+    return lag_hash_final(hash);
+}
+
+/* Called on the data path for every frame sent out of the LAG, the
+ * slots are read without the lock. Returns NULL if no member is up*/
+interface_t *
+lag_select_member(interface_t *interface, char *pkt, unsigned int pkt_size){
+
+    lag_t *lag = IF_LAG(interface);
+    lag_hash_mode_t hash_mode = __atomic_load_n(&lag->hash_mode, __ATOMIC_RELAXED);
+    uint32_t slot = lag_hash_frame(hash_mode, pkt, pkt_size) & (LAG_HASH_SLOTS - 1);
+    unsigned char member = __atomic_load_n(&lag->slots[slot], __ATOMIC_ACQUIRE);
+
+    if(member == LAG_SLOT_NONE){
+        __atomic_fetch_add(&lag->n_tx_drops, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    __atomic_fetch_add(&lag->n_tx[member], 1, __ATOMIC_RELAXED);
+    return lag->members[member];
+}
+
+/*Member and the LAG are up at both ends of the link*/
+static bool_t
+lag_member_oper(lag_t *lag, interface_t *member){
+
+    interface_t *nbr = get_nbr_interface(member);
+
+    return IF_IS_UP(lag->intf) &&
+           IF_IS_UP(member) &&
+           IF_IS_UP(nbr) &&
+           (!IF_LAG_PARENT(nbr) || IF_IS_UP(IF_LAG_PARENT(nbr)));
+}
+
+/* Recompute the members carrying the frames of the LAG after a change
+ * of state of the LAG, or of a member at either end of its link. The
+ * buckets of the members which went down are handed over to the others
+ * round robin, the flows of the other buckets stay where they are. A
+ * member coming up gets its share of all the buckets*/
+static void
+lag_update(lag_t *lag){
+
+    unsigned int i, n_active = 0, next = 0;
+    unsigned char slot, up[LAG_MAX_MEMBERS];
+    bool_t active[LAG_MAX_MEMBERS], member_up = FALSE;
+
+    pthread_mutex_lock(&lag->lock);
+
+    for(i = 0; i < lag->n_members; i++){
+        active[i] = lag_member_oper(lag, lag->members[i]);
+        if(active[i])
+            up[n_active++] = i;
+        if(active[i] && !lag->active[i])
+            member_up = TRUE;
+        if(!active[i] && lag->active[i])
+            lag->n_failovers++;
+    }
+
+    for(i = 0; i < LAG_HASH_SLOTS; i++){
+        slot = lag->slots[i];
+        if(!n_active)
+            slot = LAG_SLOT_NONE;
+        else if(member_up || slot == LAG_SLOT_NONE || !active[slot])
+            slot = up[next++ % n_active];
+        else
+            continue;
+        __atomic_store_n(&lag->slots[i], slot, __ATOMIC_RELEASE);
+    }
+
+    memcpy(lag->active, active, lag->n_members * sizeof(bool_t));
+    __atomic_store_n(&lag->n_active, n_active, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&lag->lock);
+
+    /*Spanning tree sees the LAG as a single port, up while a member is*/
+    stp_intf_state_changed(lag->intf);
+}
+
+void
+lag_member_state_changed(interface_t *interface){
+
+    lag_update(IF_LAG(IF_LAG_PARENT(interface)));
+}
+
+/*Members of the LAG are up or down for the nbrs too*/
+void
+lag_admin_state_changed(interface_t *interface){
+
+    unsigned int i;
+    interface_t *nbr;
+    lag_t *lag = IF_LAG(interface);
+
+    lag_update(lag);
+
+    for(i = 0; i < lag->n_members; i++){
+        nbr = get_nbr_interface(lag->members[i]);
+        if(IF_LAG_PARENT(nbr))
+            lag_member_state_changed(nbr);
+        else
+            stp_intf_state_changed(nbr);
+    }
+}
+
+interface_t *
+node_create_lag(node_t *node, char *lag_name){
+
+    interface_t *interface = node_create_logical_interface(node, lag_name);
+    lag_t *lag;
+
+    if(!interface)
+        return NULL;
+
+    lag = calloc(1, sizeof(lag_t));
+    lag->intf = interface;
+    lag->hash_mode = LAG_HASH_L3;
+    memset(lag->slots, LAG_SLOT_NONE, sizeof(lag->slots));
+    pthread_mutex_init(&lag->lock, NULL);
+    IF_LAG(interface) = lag;
+    return interface;
+}
+
+bool_t
+lag_add_member(interface_t *lag_intf, interface_t *interface){
+
+    lag_t *lag = IF_LAG(lag_intf);
+
+    if(!lag){
+        printf("Error : Interface %s is not a LAG\n", lag_intf->if_name);
+        return FALSE;
+    }
+
+    if(interface->att_node != lag_intf->att_node || !interface->link){
+        printf("Error : Interface %s has no link of node %s\n",
+                interface->if_name, lag_intf->att_node->node_name);
+        return FALSE;
+    }
+
+    if(IF_LAG_PARENT(interface)){
+        printf("Error : Interface %s is a member of %s already\n",
+                interface->if_name, IF_LAG_PARENT(interface)->if_name);
+        return FALSE;
+    }
+
+    if(IS_INTF_L3_MODE(interface) ||
+        IF_L2_MODE(interface) != L2_MODE_UNKNOWN){
+        printf("Error : Interface %s : L2/L3 mode enabled, config the LAG instead\n",
+                interface->if_name);
+        return FALSE;
+    }
+
+    if(lag->n_members == LAG_MAX_MEMBERS){
+        printf("Error : LAG %s has %u members already\n",
+                lag_intf->if_name, LAG_MAX_MEMBERS);
+        return FALSE;
+    }
+
+    pthread_mutex_lock(&lag->lock);
+    lag->members[lag->n_members++] = interface;
+    pthread_mutex_unlock(&lag->lock);
+
+    __atomic_store_n(&IF_LAG_PARENT(interface), lag_intf, __ATOMIC_RELEASE);
+    lag_update(lag);
+    return TRUE;
+}
+
+bool_t
+node_add_lag_member(node_t *node, char *lag_name, char *intf_name){
+
+    interface_t *lag_intf = get_node_if_by_name(node, lag_name);
+    interface_t *interface = get_node_if_by_name(node, intf_name);
+
+    assert(lag_intf);
+    assert(interface);
+
+    return lag_add_member(lag_intf, interface);
+}
+
+void
+lag_set_hash_mode(interface_t *lag_intf, lag_hash_mode_t hash_mode){
+
+    __atomic_store_n(&IF_LAG(lag_intf)->hash_mode, hash_mode, __ATOMIC_RELAXED);
+}
+
+/*Hash mode option of the CLI, l2|l3|l4*/
+void
+interface_set_lag_hash(interface_t *interface, char *lag_hash_option){
+
+    if(!IF_LAG(interface)){
+        printf("Error : Interface %s is not a LAG\n", interface->if_name);
+        return;
+    }
+
+    if(strcmp(lag_hash_option, "l2") == 0)
+        lag_set_hash_mode(interface, LAG_HASH_L2);
+    else if(strcmp(lag_hash_option, "l3") == 0)
+        lag_set_hash_mode(interface, LAG_HASH_L3);
+    else if(strcmp(lag_hash_option, "l4") == 0)
+        lag_set_hash_mode(interface, LAG_HASH_L4);
+    else
+        assert(0);
+}
+
+void
+dump_lag(interface_t *lag_intf){
+
+    unsigned int i, j, n_slots;
+    lag_t *lag = IF_LAG(lag_intf);
+
+    pthread_mutex_lock(&lag->lock);
+
+    printf("\t LAG hash : %s, members up : %u/%u, failovers : %llu, "
+            "tx drops : %llu\n", lag_hash_mode_str(lag->hash_mode),
+            lag->n_active, lag->n_members, lag->n_failovers, lag->n_tx_drops);
+
+    for(i = 0; i < lag->n_members; i++){
+
+        for(n_slots = 0, j = 0; j < LAG_HASH_SLOTS; j++){
+            if(lag->slots[j] == i) n_slots++;
+        }
+
+        printf("\t\t%-16s | %-4s | buckets : %3u | tx : %llu\n",
+                lag->members[i]->if_name, lag->active[i] ? "up" : "down",
+                n_slots, __atomic_load_n(&lag->n_tx[i], __ATOMIC_RELAXED));
+    }
+
+    pthread_mutex_unlock(&lag->lock);
+}
@@ -44,10 +44,9 @@ send_arp_broadcast_request(node_t *node,
                            interface_t *oif,
                            char *ip_addr){
 
-    /*Take memory which can accomodate Ethernet hdr + ARP hdr*/
+    ethernet_hdr_t *ethernet_hdr;
+    pkt_buffer_t *pkt_buf;
     unsigned int payload_size = sizeof(arp_hdr_t);
-    ethernet_hdr_t *ethernet_hdr = (ethernet_hdr_t *)calloc(1, 
-                ETH_HDR_SIZE_EXCL_PAYLOAD + payload_size);
 
     if(!oif){
         oif = node_get_matching_subnet_interface(node, ip_addr);
@@ -62,6 +61,15 @@ send_arp_broadcast_request(node_t *node,
             return;
         }
     }
+
+    /*Take memory which can accomodate Ethernet hdr + ARP hdr*/
+    pkt_buf = pkt_buffer_alloc(ETH_HDR_SIZE_EXCL_PAYLOAD + payload_size);
+    if(!pkt_buf)
+        return;
+    ethernet_hdr = (ethernet_hdr_t *)pkt_buffer_put(pkt_buf,
+                        ETH_HDR_SIZE_EXCL_PAYLOAD + payload_size);
+    memset(ethernet_hdr, 0, ETH_HDR_SIZE_EXCL_PAYLOAD + payload_size);
+
     /*STEP 1 : Prepare ethernet hdr*/
     layer2_fill_with_broadcast_mac(ethernet_hdr->dst_mac.mac);
     memcpy(ethernet_hdr->src_mac.mac, IF_MAC(oif), sizeof(mac_add_t));
@@ -92,7 +100,7 @@ send_arp_broadcast_request(node_t *node,
     send_pkt_out((char *)ethernet_hdr, ETH_HDR_SIZE_EXCL_PAYLOAD + payload_size,
                     oif);
 
-    free(ethernet_hdr);
+    pkt_buffer_free(pkt_buf);
 }
 
 static void
@@ -100,7 +108,16 @@ send_arp_reply_msg(ethernet_hdr_t *ethernet_hdr_in, interface_t *oif){
 
     arp_hdr_t *arp_hdr_in = (arp_hdr_t *)(GET_ETHERNET_HDR_PAYLOAD(ethernet_hdr_in));
 
-    ethernet_hdr_t *ethernet_hdr_reply = (ethernet_hdr_t *)calloc(1, MAX_PACKET_BUFFER_SIZE);
+    unsigned int total_pkt_size = ETH_HDR_SIZE_EXCL_PAYLOAD + sizeof(arp_hdr_t);
+
+    pkt_buffer_t *pkt_buf = pkt_buffer_alloc(total_pkt_size);
+
+    if(!pkt_buf)
+        return;
+
+    ethernet_hdr_t *ethernet_hdr_reply = 
+        (ethernet_hdr_t *)pkt_buffer_put(pkt_buf, total_pkt_size);
+    memset(ethernet_hdr_reply, 0, total_pkt_size);
 
     memcpy(ethernet_hdr_reply->dst_mac.mac, arp_hdr_in->src_mac.mac, sizeof(mac_add_t));
     memcpy(ethernet_hdr_reply->src_mac.mac, IF_MAC(oif), sizeof(mac_add_t));
@@ -125,14 +142,9 @@ send_arp_reply_msg(ethernet_hdr_t *ethernet_hdr_in, interface_t *oif){
   
     SET_COMMON_ETH_FCS(ethernet_hdr_reply, sizeof(arp_hdr_t), 0); /*Not used*/
 
-    unsigned int total_pkt_size = ETH_HDR_SIZE_EXCL_PAYLOAD + sizeof(arp_hdr_t);
-
-    char *shifted_pkt_buffer = pkt_buffer_shift_right((char *)ethernet_hdr_reply, 
-                               total_pkt_size, MAX_PACKET_BUFFER_SIZE);
+    send_pkt_out((char *)ethernet_hdr_reply, total_pkt_size, oif);
 
-    send_pkt_out(shifted_pkt_buffer, total_pkt_size, oif);
-
-    free(ethernet_hdr_reply);  
+    pkt_buffer_free(pkt_buf);
 }
 
 static void
@@ -178,11 +190,11 @@ process_arp_broadcast_request(node_t *node, interface_t *iif,
 
 extern void
 l2_switch_recv_frame(interface_t *interface,
-                     char *pkt, unsigned int pkt_size);
+                     pkt_buffer_t *pkt_buf);
 
 extern void
 promote_pkt_to_layer3(node_t *node, interface_t *interface,
-                         char *pkt, unsigned int pkt_size,
+                         pkt_buffer_t *pkt_buf,
                          int L3_protocol_type);
 
 void
@@ -190,20 +202,73 @@ init_arp_table(arp_table_t **arp_table){
 
     *arp_table = calloc(1, sizeof(arp_table_t));
     init_glthread(&((*arp_table)->arp_entries));
+    (*arp_table)->buckets = calloc(ARP_TABLE_INIT_SIZE, sizeof(arp_entry_t *));
+    (*arp_table)->size = ARP_TABLE_INIT_SIZE;
+    pthread_mutex_init(&(*arp_table)->lock, NULL);
 }
 
-arp_entry_t *
-arp_table_lookup(arp_table_t *arp_table, char *ip_addr){
+/*Multiplicative hash, IPs of a subnet differ in the low bits only*/
+static inline unsigned int
+arp_table_hash(arp_table_t *arp_table, uint32_t ip_addr){
+
+    uint32_t hash = ip_addr * 2654435769U;
+
+    return (hash ^ (hash >> 16)) & (arp_table->size - 1);
+}
+
+/*Double the no of buckets, and rechain all the entries*/
+static void
+arp_table_grow(arp_table_t *arp_table){
 
     glthread_t *curr;
     arp_entry_t *arp_entry;
+    unsigned int bucket;
+    arp_entry_t **buckets = calloc(arp_table->size * 2, sizeof(arp_entry_t *));
+
+    if(!buckets)
+        return;
+
+    free(arp_table->buckets);
+    arp_table->buckets = buckets;
+    arp_table->size *= 2;
+
     ITERATE_GLTHREAD_BEGIN(&arp_table->arp_entries, curr){
-    
+
         arp_entry = arp_glue_to_arp_entry(curr);
-        if(strncmp(arp_entry->ip_addr.ip_addr, ip_addr, 16) == 0){
-            return arp_entry;
-        }
+        bucket = arp_table_hash(arp_table, arp_entry->ip_addr);
+        arp_entry->hash_next = buckets[bucket];
+        buckets[bucket] = arp_entry;
     } ITERATE_GLTHREAD_END(&arp_table->arp_entries, curr);
+}
+
+static void
+arp_table_insert(arp_table_t *arp_table, arp_entry_t *arp_entry){
+
+    unsigned int bucket;
+
+    init_glthread(&arp_entry->arp_glue);
+    glthread_add_next(&arp_table->arp_entries, &arp_entry->arp_glue);
+
+    if(++arp_table->n_entries > arp_table->size){
+        arp_table_grow(arp_table);
+        return;
+    }
+
+    bucket = arp_table_hash(arp_table, arp_entry->ip_addr);
+    arp_entry->hash_next = arp_table->buckets[bucket];
+    arp_table->buckets[bucket] = arp_entry;
+}
+
+arp_entry_t *
+arp_table_lookup(arp_table_t *arp_table, uint32_t ip_addr){
+
+    arp_entry_t *arp_entry =
+        arp_table->buckets[arp_table_hash(arp_table, ip_addr)];
+
+    for( ; arp_entry; arp_entry = arp_entry->hash_next){
+        if(arp_entry->ip_addr == ip_addr)
+            return arp_entry;
+    }
     return NULL;
 }
 
@@ -213,22 +278,26 @@ clear_arp_table(arp_table_t *arp_table){
     glthread_t *curr;
     arp_entry_t *arp_entry;
 
+    pthread_mutex_lock(&arp_table->lock);
     ITERATE_GLTHREAD_BEGIN(&arp_table->arp_entries, curr){
         
         arp_entry = arp_glue_to_arp_entry(curr);
-        delete_arp_entry(arp_entry);
+        delete_arp_entry(arp_table, arp_entry);
     } ITERATE_GLTHREAD_END(&arp_table->arp_entries, curr);
+    pthread_mutex_unlock(&arp_table->lock);
 }
 
 void
-delete_arp_table_entry(arp_table_t *arp_table, char *ip_addr){
+delete_arp_table_entry(arp_table_t *arp_table, uint32_t ip_addr){
+
+    pthread_mutex_lock(&arp_table->lock);
 
     arp_entry_t *arp_entry = arp_table_lookup(arp_table, ip_addr);
     
-    if(!arp_entry)
-        return;
+    if(arp_entry)
+        delete_arp_entry(arp_table, arp_entry);
 
-    delete_arp_entry(arp_entry);
+    pthread_mutex_unlock(&arp_table->lock);
 }
 
 bool_t
@@ -240,12 +309,12 @@ arp_table_entry_add(arp_table_t *arp_table, arp_entry_t *arp_entry,
     }
 
     arp_entry_t *arp_entry_old = arp_table_lookup(arp_table, 
-            arp_entry->ip_addr.ip_addr);
+            arp_entry->ip_addr);
 
     /* Case 0 : if ARP table do not exist already, then add it
      * and return TRUE*/
     if(!arp_entry_old){
-        glthread_add_next(&arp_table->arp_entries, &arp_entry->arp_glue);
+        arp_table_insert(arp_table, arp_entry);
         return TRUE;
     }
     
@@ -260,9 +329,8 @@ arp_table_entry_add(arp_table_t *arp_table, arp_entry_t *arp_entry,
 
     /*Case 2 : If there already exists full ARP table entry, then replace it*/
     if(arp_entry_old && !arp_entry_sane(arp_entry_old)){
-        delete_arp_entry(arp_entry_old);
-        init_glthread(&arp_entry->arp_glue);
-        glthread_add_next(&arp_table->arp_entries, &arp_entry->arp_glue);
+        delete_arp_entry(arp_table, arp_entry_old);
+        arp_table_insert(arp_table, arp_entry);
         return TRUE;
     }
 
@@ -287,9 +355,8 @@ arp_table_entry_add(arp_table_t *arp_table, arp_entry_t *arp_entry,
         arp_entry_sane(arp_entry_old) && 
         !arp_entry_sane(arp_entry)){
 
-        strncpy(arp_entry_old->mac_addr.mac, arp_entry->mac_addr.mac, sizeof(mac_add_t));
-        strncpy(arp_entry_old->oif_name, arp_entry->oif_name, IF_NAME_SIZE);
-        arp_entry_old->oif_name[IF_NAME_SIZE -1] = '\0';
+        memcpy(arp_entry_old->mac_addr.mac, arp_entry->mac_addr.mac, sizeof(mac_add_t));
+        arp_entry_old->oif = arp_entry->oif;
 
         if(arp_pending_list)
             *arp_pending_list = &arp_entry_old->arp_pending_list;
@@ -299,18 +366,18 @@ arp_table_entry_add(arp_table_t *arp_table, arp_entry_t *arp_entry,
     return FALSE;
 }
 
+/*Fill in the L2 addresses of the pending frame, the caller sends it*/
 static void 
 pending_arp_processing_callback_function(node_t *node,
                                          interface_t *oif,
                                          arp_entry_t *arp_entry,
                                          arp_pending_entry_t *arp_pending_entry){
 
-    ethernet_hdr_t *ethernet_hdr = (ethernet_hdr_t *)arp_pending_entry->pkt;
-    unsigned int pkt_size = arp_pending_entry->pkt_size;
+    ethernet_hdr_t *ethernet_hdr = (ethernet_hdr_t *)arp_pending_entry->pkt_buf->data;
+    unsigned int pkt_size = arp_pending_entry->pkt_buf->len;
     memcpy(ethernet_hdr->dst_mac.mac, arp_entry->mac_addr.mac, sizeof(mac_add_t));
     memcpy(ethernet_hdr->src_mac.mac, IF_MAC(oif), sizeof(mac_add_t));
     SET_COMMON_ETH_FCS(ethernet_hdr, pkt_size - GET_ETH_HDR_SIZE_EXCL_PAYLOAD(ethernet_hdr), 0);
-    send_pkt_out((char *)ethernet_hdr, pkt_size, oif);
 }
 
 
@@ -326,29 +393,50 @@ static void
 delete_arp_pending_entry(arp_pending_entry_t *arp_pending_entry){
 
     remove_glthread(&arp_pending_entry->arp_pending_entry_glue);
+    pkt_buffer_free(arp_pending_entry->pkt_buf);
     free(arp_pending_entry);
 }
 
+/* Send the frames of the resolved pending entries out of 'oif' in one
+ * go, and release the entries*/
+static void
+send_arp_pending_pkts(interface_t *oif,
+                      arp_pending_entry_t **arp_pending_entries,
+                      unsigned int n_entries){
+
+    unsigned int i;
+    char *pkts[MAX_RX_BATCH_SIZE];
+    unsigned int pkt_sizes[MAX_RX_BATCH_SIZE];
+
+    for(i = 0; i < n_entries; i++){
+        pkts[i] = arp_pending_entries[i]->pkt_buf->data;
+        pkt_sizes[i] = arp_pending_entries[i]->pkt_buf->len;
+    }
+
+    send_pkt_out_batch(pkts, pkt_sizes, n_entries, oif);
+
+    for(i = 0; i < n_entries; i++)
+        delete_arp_pending_entry(arp_pending_entries[i]);
+}
+
 void
 arp_table_update_from_arp_reply(arp_table_t *arp_table, 
                                 arp_hdr_t *arp_hdr, interface_t *iif){
 
-    unsigned int src_ip = 0;
     glthread_t *arp_pending_list = NULL;
+    arp_entry_t *arp_entry_resolved;
 
     assert(arp_hdr->op_code == ARP_REPLY);
 
-    arp_entry_t *arp_entry = calloc(1, sizeof(arp_entry_t));
-
-    src_ip = htonl(arp_hdr->src_ip);
+    pthread_mutex_lock(&arp_table->lock);
 
-    inet_ntop(AF_INET, &src_ip, arp_entry->ip_addr.ip_addr, 16);
+    arp_entry_t *arp_entry = calloc(1, sizeof(arp_entry_t));
 
-    arp_entry->ip_addr.ip_addr[15] = '\0';
+    arp_entry->ip_addr = arp_hdr->src_ip;
 
     memcpy(arp_entry->mac_addr.mac, arp_hdr->src_mac.mac, sizeof(mac_add_t));
 
-    strncpy(arp_entry->oif_name, iif->if_name, IF_NAME_SIZE);
+    arp_entry->oif = iif;
 
     arp_entry->is_sane = FALSE;
 
@@ -356,9 +444,12 @@ arp_table_update_from_arp_reply(arp_table_t *arp_table,
 
     glthread_t *curr;
     arp_pending_entry_t *arp_pending_entry;
+    arp_pending_entry_t *arp_pending_entries[MAX_RX_BATCH_SIZE];
+    unsigned int n_entries = 0;
 
     if(arp_pending_list){
         
+        /*Frames queued to the nbr go out MAX_RX_BATCH_SIZE at a time*/
         ITERATE_GLTHREAD_BEGIN(arp_pending_list, curr){
         
             arp_pending_entry = arp_pending_entry_glue_to_arp_pending_entry(curr);
@@ -367,15 +458,147 @@ arp_table_update_from_arp_reply(arp_table_t *arp_table,
 
             process_arp_pending_entry(iif->att_node, iif, arp_entry, arp_pending_entry);
             
-            delete_arp_pending_entry(arp_pending_entry);
+            arp_pending_entries[n_entries++] = arp_pending_entry;
+            if(n_entries == MAX_RX_BATCH_SIZE){
+                send_arp_pending_pkts(iif, arp_pending_entries, n_entries);
+                n_entries = 0;
+            }
 
         } ITERATE_GLTHREAD_END(arp_pending_list, curr);
 
+        if(n_entries)
+            send_arp_pending_pkts(iif, arp_pending_entries, n_entries);
+
         (arp_pending_list_to_arp_entry(arp_pending_list))->is_sane = FALSE;
+        (arp_pending_list_to_arp_entry(arp_pending_list))->n_pending = 0;
     }
 
+    /*The reply confirms the entry, whichever state it was in*/
+    arp_entry_resolved = arp_table_lookup(arp_table, arp_entry->ip_addr);
+    arp_entry_resolved->state = ARP_ENTRY_REACHABLE;
+    arp_entry_resolved->expires = arp_table->now + ARP_REACHABLE_TIME;
+    arp_entry_resolved->n_requests = 0;
+
     if(rc == FALSE){
-        delete_arp_entry(arp_entry);
+        delete_arp_entry(arp_table, arp_entry);
+    }
+
+    pthread_mutex_unlock(&arp_table->lock);
+}
+
+static void
+arp_entry_send_request(arp_table_t *arp_table, arp_entry_t *arp_entry){
+
+    char ip_addr[16];
+
+    send_arp_broadcast_request(arp_entry->req_oif->att_node,
+            arp_entry->req_oif,
+            tcp_ip_covert_ip_n_to_p(arp_entry->ip_addr, ip_addr));
+    arp_entry->n_requests++;
+    arp_table->n_requests++;
+}
+
+static void
+arp_entry_drop_pending_pkts(arp_entry_t *arp_entry){
+
+    glthread_t *curr;
+
+    ITERATE_GLTHREAD_BEGIN(&arp_entry->arp_pending_list, curr){
+
+        delete_arp_pending_entry(
+                arp_pending_entry_glue_to_arp_pending_entry(curr));
+    } ITERATE_GLTHREAD_END(&arp_entry->arp_pending_list, curr);
+    arp_entry->n_pending = 0;
+}
+
+void
+arp_table_tick(arp_table_t *arp_table){
+
+    glthread_t *curr;
+    arp_entry_t *arp_entry;
+
+    pthread_mutex_lock(&arp_table->lock);
+
+    arp_table->now += NW_TIMER_TICK_SEC;
+
+    ITERATE_GLTHREAD_BEGIN(&arp_table->arp_entries, curr){
+
+        arp_entry = arp_glue_to_arp_entry(curr);
+
+        if((int32_t)(arp_table->now - arp_entry->expires) < 0)
+            continue;
+
+        switch(arp_entry->state){
+            case ARP_ENTRY_INCOMPLETE:
+                if(arp_entry->n_requests < ARP_MAX_REQUESTS){
+                    /*Retransmit, and back off*/
+                    arp_entry_send_request(arp_table, arp_entry);
+                    arp_table->n_retransmits++;
+                    arp_entry->expires = arp_table->now +
+                        (ARP_RETRANS_TIME << (arp_entry->n_requests - 1));
+                    break;
+                }
+                /*Give up, remember the failure for a while*/
+                arp_table->n_failures++;
+                arp_table->n_unresolved_drops += arp_entry->n_pending;
+                arp_entry_drop_pending_pkts(arp_entry);
+                arp_entry->state = ARP_ENTRY_FAILED;
+                arp_entry->expires = arp_table->now + ARP_NEGATIVE_CACHE_TIME;
+                break;
+            case ARP_ENTRY_REACHABLE:
+                arp_entry->state = ARP_ENTRY_STALE;
+                arp_entry->expires = arp_table->now + ARP_STALE_TIME;
+                break;
+            case ARP_ENTRY_STALE:
+                arp_table->n_aged++;
+                delete_arp_entry(arp_table, arp_entry);
+                break;
+            case ARP_ENTRY_FAILED:
+                delete_arp_entry(arp_table, arp_entry);
+                break;
+            default:
+                ;
+        }
+    } ITERATE_GLTHREAD_END(&arp_table->arp_entries, curr);
+
+    pthread_mutex_unlock(&arp_table->lock);
+}
+
+static void
+arp_table_timer_cb(void *arg, int arg_size){
+
+    arp_table_tick(*(arp_table_t **)arg);
+}
+
+/* Register the timer of the table with the nw timer once the node
+ * sends its first pkt needing ARP. Any thread sending pkts out of the
+ * node may get here first*/
+static void
+arp_table_start_timer(arp_table_t *arp_table){
+
+    if(__atomic_load_n(&arp_table->timer_started, __ATOMIC_ACQUIRE) ||
+        __atomic_exchange_n(&arp_table->timer_started, 1, __ATOMIC_ACQ_REL))
+        return;
+
+    arp_table->timer = register_app_event(nw_get_timer(),
+            arp_table_timer_cb, &arp_table, sizeof(arp_table_t *),
+            NW_TIMER_TICK_SEC, 1);
+}
+
+static char *
+arp_entry_state_str(arp_entry_state_t state){
+
+    switch(state){
+        case ARP_ENTRY_INCOMPLETE:
+            return "INCOMPLETE";
+        case ARP_ENTRY_REACHABLE:
+            return "REACHABLE";
+        case ARP_ENTRY_STALE:
+            return "STALE";
+        case ARP_ENTRY_FAILED:
+            return "FAILED";
+        default:
+            return "UNKNOWN";
     }
 }
 
@@ -385,21 +608,33 @@ dump_arp_table(arp_table_t *arp_table){
 
     glthread_t *curr;
     arp_entry_t *arp_entry;
+    char ip_addr[16];
+
+    pthread_mutex_lock(&arp_table->lock);
 
     ITERATE_GLTHREAD_BEGIN(&arp_table->arp_entries, curr){
 
         arp_entry = arp_glue_to_arp_entry(curr);
-        printf("IP : %s, MAC : %u:%u:%u:%u:%u:%u, OIF = %s, Is Sane : %s\n", 
-            arp_entry->ip_addr.ip_addr, 
+        printf("IP : %s, MAC : %u:%u:%u:%u:%u:%u, OIF = %s, Is Sane : %s, State : %s\n", 
+            tcp_ip_covert_ip_n_to_p(arp_entry->ip_addr, ip_addr), 
             arp_entry->mac_addr.mac[0], 
             arp_entry->mac_addr.mac[1], 
             arp_entry->mac_addr.mac[2], 
             arp_entry->mac_addr.mac[3], 
             arp_entry->mac_addr.mac[4], 
             arp_entry->mac_addr.mac[5], 
-            arp_entry->oif_name,
-            arp_entry_sane(arp_entry) ? "TRUE" : "FALSE");
+            arp_entry->oif ? arp_entry->oif->if_name : "",
+            arp_entry_sane(arp_entry) ? "TRUE" : "FALSE",
+            arp_entry_state_str(arp_entry->state));
     } ITERATE_GLTHREAD_END(&arp_table->arp_entries, curr);
+
+    printf("Requests : %llu, Retransmits : %llu, Failures : %llu, Aged : %llu\n",
+            arp_table->n_requests, arp_table->n_retransmits,
+            arp_table->n_failures, arp_table->n_aged);
+    printf("Pkts dropped : queue full %llu, unresolved %llu\n",
+            arp_table->n_queue_drops, arp_table->n_unresolved_drops);
+
+    pthread_mutex_unlock(&arp_table->lock);
 }
 
 /*Interface config APIs for L2 mode configuration*/
@@ -421,6 +656,16 @@ interface_set_l2_mode(node_t *node,
         assert(0);
     }
 
+    /*Config of the members is the config of their LAG*/
+    if(IF_LAG_PARENT(interface)){
+        printf("Error : Interface %s is a member of %s\n",
+                interface->if_name, IF_LAG_PARENT(interface)->if_name);
+        return;
+    }
+
+    /*Node with an interface in L2 mode switches frames, and learns MACs*/
+    mac_table_start_aging(NODE_MAC_TABLE(node));
+
     /*Case 1 : if interface is working in L3 mode, i.e. IP address is configured.
      * then disable ip address, and set interface in L2 mode*/
     if(IS_INTF_L3_MODE(interface)){
@@ -428,6 +673,8 @@ interface_set_l2_mode(node_t *node,
         interface->intf_nw_props.is_ipadd_config = FALSE;
 
         IF_L2_MODE(interface) = intf_l2_mode;
+        l2_switch_rebuild_flood_lists(node);
+        stp_intf_state_changed(interface);
         return;
     }
 
@@ -435,6 +682,8 @@ interface_set_l2_mode(node_t *node,
      * apply L2 config*/
     if(IF_L2_MODE(interface) == L2_MODE_UNKNOWN){
         IF_L2_MODE(interface) = intf_l2_mode;
+        l2_switch_rebuild_flood_lists(node);
+        stp_intf_state_changed(interface);
         return;
     }
 
@@ -449,6 +698,13 @@ interface_set_l2_mode(node_t *node,
     if(IF_L2_MODE(interface) == ACCESS &&
             intf_l2_mode == TRUNK){
         IF_L2_MODE(interface) = intf_l2_mode;
+        /*Vlan of the access port stays enabled on the trunk*/
+        if(IF_ACCESS_VLAN(interface)){
+            IF_SET_VLAN(interface, IF_ACCESS_VLAN(interface));
+            IF_ACCESS_VLAN(interface) = 0;
+        }
+        l2_switch_rebuild_flood_lists(node);
+        stp_intf_state_changed(interface);
         return;
     }
 
@@ -459,12 +715,10 @@ interface_set_l2_mode(node_t *node,
            intf_l2_mode == ACCESS){
 
         IF_L2_MODE(interface) = intf_l2_mode;
-
-        unsigned int i = 0;
-
-        for ( ; i < MAX_VLAN_MEMBERSHIP; i++){
-            interface->intf_nw_props.vlans[i] = 0;
-        }
+        memset(interface->intf_nw_props.vlan_bitmap, 0,
+                sizeof(interface->intf_nw_props.vlan_bitmap));
+        l2_switch_rebuild_flood_lists(node);
+        stp_intf_state_changed(interface);
     }
 }
 
@@ -488,6 +742,11 @@ interface_set_vlan(node_t *node,
         return;
     }
 
+    if(vlan_id < VLAN_ID_MIN || vlan_id > VLAN_ID_MAX){
+        printf("Error : Interface %s : Invalid vlan %u\n", interface->if_name, vlan_id);
+        return;
+    }
+
     /*Case 2 : Cant set vlan on interface not operating in L2 mode*/
     if(IF_L2_MODE(interface) != ACCESS &&
         IF_L2_MODE(interface) != TRUNK){
@@ -497,38 +756,16 @@ interface_set_vlan(node_t *node,
 
     /*case 3 : Can set only one vlan on interface operating in ACCESS mode*/
     if(interface->intf_nw_props.intf_l2_mode == ACCESS){
-        
-        unsigned int i = 0, *vlan = NULL;    
-        for( ; i < MAX_VLAN_MEMBERSHIP; i++){
-            if(interface->intf_nw_props.vlans[i]){
-                vlan = &interface->intf_nw_props.vlans[i];
-            }
-        }
-        if(vlan){
-            *vlan = vlan_id;
-            return;
-        }
-        interface->intf_nw_props.vlans[0] = vlan_id;
+        unsigned int old_vlan_id = IF_ACCESS_VLAN(interface);
+        IF_ACCESS_VLAN(interface) = vlan_id;
+        l2_switch_rebuild_flood_list(node, old_vlan_id);
+        l2_switch_rebuild_flood_list(node, vlan_id);
+        return;
     }
     /*case 4 : Add vlan membership on interface operating in TRUNK mode*/
     if(interface->intf_nw_props.intf_l2_mode == TRUNK){
-
-        unsigned int i = 0, *vlan = NULL;
-
-        for( ; i < MAX_VLAN_MEMBERSHIP; i++){
-
-            if(!vlan && interface->intf_nw_props.vlans[i] == 0){
-                vlan = &interface->intf_nw_props.vlans[i];
-            }
-            else if(interface->intf_nw_props.vlans[i] == vlan_id){
-                return;
-            }
-        }
-        if(vlan){
-            *vlan = vlan_id;
-            return;
-        }
-        printf("Error : Interface %s : Max Vlan membership limit reached", interface->if_name);
+        IF_SET_VLAN(interface, vlan_id);
+        l2_switch_rebuild_flood_list(node, vlan_id);
     }
 }
 
@@ -537,6 +774,20 @@ interface_unset_vlan(node_t *node,
                    interface_t *interface,
                    unsigned int vlan){
 
+    if(IF_L2_MODE(interface) == ACCESS){
+        if(IF_ACCESS_VLAN(interface) == vlan){
+            IF_ACCESS_VLAN(interface) = 0;
+            l2_switch_rebuild_flood_list(node, vlan);
+            l2_switch_rebuild_flood_list(node, 0);
+        }
+        return;
+    }
+
+    if(IF_L2_MODE(interface) == TRUNK &&
+        vlan <= VLAN_ID_MAX){
+        IF_UNSET_VLAN(interface, vlan);
+        l2_switch_rebuild_flood_list(node, vlan);
+    }
 }
 
 /*APIs to be used to create topologies*/
@@ -564,69 +815,106 @@ extern bool_t
 is_layer3_local_delivery(node_t *node, 
                          uint32_t dst_ip);
 
+/* Resolve the MAC of 'next_hop_ip' reachable out of 'oif'. Returns
+ * TRUE with the MAC copied to 'mac' if the frame may be sent now, else
+ * the frame is queued till the resolution completes, or dropped*/
+static bool_t
+l2_resolve_next_hop(node_t *node, interface_t *oif, uint32_t next_hop_ip,
+                    pkt_buffer_t *pkt_buf, char *mac){
+
+    arp_table_t *arp_table = NODE_ARP_TABLE(node);
+    arp_entry_t *arp_entry;
+    bool_t resolved = FALSE;
+
+    arp_table_start_timer(arp_table);
+
+    pthread_mutex_lock(&arp_table->lock);
+
+    arp_entry = arp_table_lookup(arp_table, next_hop_ip);
+
+    if(!arp_entry){
+
+        /*Time for ARP resolution*/
+        arp_entry = create_arp_sane_entry(arp_table, next_hop_ip);
+        arp_entry->state = ARP_ENTRY_INCOMPLETE;
+        arp_entry->req_oif = oif;
+
+        add_arp_pending_entry(arp_entry,
+                pending_arp_processing_callback_function,
+                pkt_buf->data, pkt_buf->len);
+
+        arp_entry_send_request(arp_table, arp_entry);
+        arp_entry->expires = arp_table->now + ARP_RETRANS_TIME;
+        goto done;
+    }
+
+    switch(arp_entry->state){
+        case ARP_ENTRY_INCOMPLETE:
+            if(!add_arp_pending_entry(arp_entry,
+                    pending_arp_processing_callback_function,
+                    pkt_buf->data, pkt_buf->len))
+                arp_table->n_queue_drops++;
+            break;
+        case ARP_ENTRY_FAILED:
+            arp_table->n_unresolved_drops++;
+            break;
+        case ARP_ENTRY_STALE:
+            /*Revalidate the entry in use*/
+            if(!arp_entry->n_requests){
+                arp_entry->req_oif = oif;
+                arp_entry_send_request(arp_table, arp_entry);
+                arp_entry->expires = arp_table->now + ARP_PROBE_TIME;
+            }
+            /*Fall through*/
+        case ARP_ENTRY_REACHABLE:
+            memcpy(mac, arp_entry->mac_addr.mac, sizeof(mac_add_t));
+            resolved = TRUE;
+            break;
+        default:
+            ;
+    }
+
+    done:
+    pthread_mutex_unlock(&arp_table->lock);
+    return resolved;
+}
+
 static void
 l2_forward_ip_packet(node_t *node, unsigned int next_hop_ip,
-                    char *outgoing_intf, ethernet_hdr_t *pkt, 
-                    unsigned int pkt_size){
+                    interface_t *outgoing_intf, pkt_buffer_t *pkt_buf){
 
     interface_t *oif = NULL;
     char next_hop_ip_str[16];
-    arp_entry_t * arp_entry = NULL;
-    ethernet_hdr_t *ethernet_hdr = (ethernet_hdr_t *)pkt;
+    mac_add_t next_hop_mac;
+    ethernet_hdr_t *ethernet_hdr = (ethernet_hdr_t *)pkt_buf->data;
+    unsigned int pkt_size = pkt_buf->len;
     unsigned int ethernet_payload_size = pkt_size - ETH_HDR_SIZE_EXCL_PAYLOAD;
 
-    next_hop_ip = htonl(next_hop_ip);
-    inet_ntop(AF_INET, &next_hop_ip, next_hop_ip_str, 16);
-    
-    /*restore again, since htonl reverses the byte
-     * order*/
-    next_hop_ip = htonl(next_hop_ip);
-
     if(outgoing_intf) {
 
         /* Case 1 : Forwarding Case
          * It means, L3 has resolved the nexthop, So its 
          * time to L2 forward the pkt out of this interface*/
-        oif = get_node_if_by_name(node, outgoing_intf);
-        assert(oif);
-
-        arp_entry = arp_table_lookup(NODE_ARP_TABLE(node), next_hop_ip_str);
-
-        if (!arp_entry){
+        oif = outgoing_intf;
 
-            /*Time for ARP resolution*/
-            arp_entry = create_arp_sane_entry(NODE_ARP_TABLE(node),
-                    next_hop_ip_str);
-            
-            add_arp_pending_entry(arp_entry,
-                    pending_arp_processing_callback_function,
-                    (char *)pkt, pkt_size);
-
-            send_arp_broadcast_request(node, oif, next_hop_ip_str);
-            return;
-
-        }
-        else if(arp_entry_sane(arp_entry)){
-            add_arp_pending_entry(arp_entry,
-                    pending_arp_processing_callback_function,
-                    (char *)pkt, pkt_size);
+        if(!l2_resolve_next_hop(node, oif, next_hop_ip, pkt_buf,
+                    next_hop_mac.mac))
             return;
-        }
-        else
-            goto l2_frame_prepare ;
+        goto l2_frame_prepare ;
     }
    
     /*Case 4 : Self ping*/
     if(is_layer3_local_delivery(node, next_hop_ip)){
 
-        promote_pkt_to_layer3(node, 0, GET_ETHERNET_HDR_PAYLOAD(ethernet_hdr),
-                pkt_size - GET_ETH_HDR_SIZE_EXCL_PAYLOAD(ethernet_hdr),
-                ethernet_hdr->type);
+        int type = ethernet_hdr->type;
+        PULL_ETH_HDR(pkt_buf);
+        promote_pkt_to_layer3(node, 0, pkt_buf, type);
         return;
     }
 
     /* case 2 : Direct host Delivery
        L2 has to forward the frame to machine on local connected subnet */
+    tcp_ip_covert_ip_n_to_p(next_hop_ip, next_hop_ip_str);
     oif = node_get_matching_subnet_interface(node, next_hop_ip_str);
 
     if(!oif){
@@ -635,28 +923,12 @@ l2_forward_ip_packet(node_t *node, unsigned int next_hop_ip,
         return;
     }
 
-    arp_entry = arp_table_lookup(NODE_ARP_TABLE(node), next_hop_ip_str);
-
-    if (!arp_entry){
-        /*Time for ARP resolution*/
-        arp_entry = create_arp_sane_entry(NODE_ARP_TABLE(node),
-                next_hop_ip_str);
-
-        add_arp_pending_entry(arp_entry,
-                pending_arp_processing_callback_function,
-                (char *)pkt, pkt_size);
-
-        send_arp_broadcast_request(node, oif, next_hop_ip_str);
+    if(!l2_resolve_next_hop(node, oif, next_hop_ip, pkt_buf,
+                next_hop_mac.mac))
         return;
-    }
-    else if(arp_entry_sane(arp_entry)){
-        add_arp_pending_entry(arp_entry,
-                pending_arp_processing_callback_function,
-                (char *)pkt, pkt_size);
-        return;
-    }
+
     l2_frame_prepare:
-        memcpy(ethernet_hdr->dst_mac.mac, arp_entry->mac_addr.mac, sizeof(mac_add_t));
+        memcpy(ethernet_hdr->dst_mac.mac, next_hop_mac.mac, sizeof(mac_add_t));
         memcpy(ethernet_hdr->src_mac.mac, IF_MAC(oif), sizeof(mac_add_t));
         SET_COMMON_ETH_FCS(ethernet_hdr, ethernet_payload_size, 0);
         send_pkt_out((char *)ethernet_hdr, pkt_size, oif);
@@ -665,19 +937,19 @@ l2_forward_ip_packet(node_t *node, unsigned int next_hop_ip,
 static void
 layer2_pkt_receieve_from_top(node_t *node, 
                     unsigned int next_hop_ip,
-                    char *outgoing_intf,
-                    char *pkt, unsigned int pkt_size,
+                    interface_t *outgoing_intf,
+                    pkt_buffer_t *pkt_buf,
                     int protocol_number){
 
-    assert(pkt_size < sizeof(((ethernet_hdr_t *)0)->payload));
+    assert(pkt_buf->len <= sizeof(((ethernet_hdr_t *)0)->payload));
 
     if(protocol_number == ETH_IP){
 
-        ethernet_hdr_t *empty_ethernet_hdr = ALLOC_ETH_HDR_WITH_PAYLOAD(pkt, pkt_size); 
+        ethernet_hdr_t *empty_ethernet_hdr = PUSH_ETH_HDR(pkt_buf); 
         empty_ethernet_hdr->type = ETH_IP;
 
         l2_forward_ip_packet(node, next_hop_ip, 
-                outgoing_intf, empty_ethernet_hdr, pkt_size + ETH_HDR_SIZE_EXCL_PAYLOAD);
+                outgoing_intf, pkt_buf);
     }
 }
 
@@ -690,20 +962,32 @@ layer2_pkt_receieve_from_top(node_t *node,
 void
 demote_pkt_to_layer2(node_t *node, /*Currenot node*/ 
         unsigned int next_hop_ip,  /*If pkt is forwarded to next router, then this is Nexthop IP address (gateway) provided by L3 layer. L2 need to resolve ARP for this IP address*/
-        char *outgoing_intf,       /*The oif obtained from L3 lookup if L3 has decided to forward the pkt. If NULL, then L2 will find the appropriate interface*/
-        char *pkt, unsigned int pkt_size,   /*Higher Layers payload*/
-        int protocol_number){               /*Higher Layer need to tell L2 what value need to be feed in eth_hdr->type field*/
+        interface_t *outgoing_intf,/*The oif obtained from L3 lookup if L3 has decided to forward the pkt. If NULL, then L2 will find the appropriate interface*/
+        pkt_buffer_t *pkt_buf,     /*Higher Layers payload, L2 hdr is prepended in the headroom*/
+        int protocol_number){      /*Higher Layer need to tell L2 what value need to be feed in eth_hdr->type field*/
 
     layer2_pkt_receieve_from_top(node, next_hop_ip,
-        outgoing_intf, pkt, pkt_size,
+        outgoing_intf, pkt_buf,
         protocol_number);
 }
 
+/* Entry may also be one which never made it to the table, see
+ * arp_table_update_from_arp_reply()*/
 void
-delete_arp_entry(arp_entry_t *arp_entry){
+delete_arp_entry(arp_table_t *arp_table, arp_entry_t *arp_entry){
     
     glthread_t *curr;
     arp_pending_entry_t *arp_pending_entry;
+    arp_entry_t **prev =
+        &arp_table->buckets[arp_table_hash(arp_table, arp_entry->ip_addr)];
+
+    for( ; *prev; prev = &(*prev)->hash_next){
+        if(*prev == arp_entry){
+            *prev = arp_entry->hash_next;
+            arp_table->n_entries--;
+            break;
+        }
+    }
     remove_glthread(&arp_entry->arp_glue);
 
     ITERATE_GLTHREAD_BEGIN(&arp_entry->arp_pending_list, curr){
@@ -715,26 +999,36 @@ delete_arp_entry(arp_entry_t *arp_entry){
     free(arp_entry);
 }
 
-void
+bool_t
 add_arp_pending_entry(arp_entry_t *arp_entry,
         arp_processing_fn cb,
         char *pkt,
         unsigned int pkt_size){
 
-    arp_pending_entry_t *arp_pending_entry = 
-        calloc(1, sizeof(arp_pending_entry_t) + pkt_size);
+    pkt_buffer_t *pkt_buf;
+    arp_pending_entry_t *arp_pending_entry;
+
+    if(arp_entry->n_pending >= ARP_MAX_PENDING_PKTS)
+        return FALSE;
 
+    pkt_buf = pkt_buffer_alloc(pkt_size);
+    if(!pkt_buf)
+        return FALSE;
+
+    arp_pending_entry = calloc(1, sizeof(arp_pending_entry_t));
     init_glthread(&arp_pending_entry->arp_pending_entry_glue);
     arp_pending_entry->cb = cb;
-    arp_pending_entry->pkt_size = pkt_size;
-    memcpy(arp_pending_entry->pkt, pkt, pkt_size);
+    arp_pending_entry->pkt_buf = pkt_buf;
+    pkt_buffer_copy(pkt_buffer_put(pkt_buf, pkt_size), pkt, pkt_size);
 
     glthread_add_next(&arp_entry->arp_pending_list, 
                     &arp_pending_entry->arp_pending_entry_glue);
+    arp_entry->n_pending++;
+    return TRUE;
 }
 
 arp_entry_t *
-create_arp_sane_entry(arp_table_t *arp_table, char *ip_addr){ 
+create_arp_sane_entry(arp_table_t *arp_table, uint32_t ip_addr){ 
 
     /*case 1 : If full entry already exist - assert. The L2 must have
      * not create ARP sane entry if the already was already existing*/
@@ -752,8 +1046,7 @@ create_arp_sane_entry(arp_table_t *arp_table, char *ip_addr){
 
     /*if ARP entry do not exist, create a new sane entry*/
     arp_entry = calloc(1, sizeof(arp_entry_t));
-    strncpy(arp_entry->ip_addr.ip_addr, ip_addr, 16);
-    arp_entry->ip_addr.ip_addr[15] = '\0';
+    arp_entry->ip_addr = ip_addr;
     init_glthread(&arp_entry->arp_pending_list);
     arp_entry->is_sane = TRUE;
     bool_t rc = arp_table_entry_add(arp_table, arp_entry, 0);
@@ -766,7 +1059,55 @@ create_arp_sane_entry(arp_table_t *arp_table, char *ip_addr){
 
 /*Vlan Management Routines*/
 
-/* Return new packet size if pkt is tagged with new vlan id*/
+/* Frames carry a zero FCS unless enabled, the FCS of the frames
+ * re-tagged by the switches is then recomputed*/
+bool_t l2_fcs_enabled = FALSE;
+
+static uint32_t fcs_crc32_table[256];
+static pthread_once_t fcs_crc32_table_once = PTHREAD_ONCE_INIT;
+
+static void
+fcs_crc32_table_init(void){
+
+    uint32_t i, j, crc;
+
+    for(i = 0; i < 256; i++){
+        crc = i;
+        for(j = 0; j < 8; j++)
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320U : 0);
+        fcs_crc32_table[i] = crc;
+    }
+}
+
+/*CRC-32 of the frame from the dst MAC to the end of payload*/
+unsigned int
+ethernet_fcs_compute(char *frame, unsigned int size){
+
+    uint32_t crc = 0xFFFFFFFFU;
+    unsigned int i;
+
+    pthread_once(&fcs_crc32_table_once, fcs_crc32_table_init);
+
+    for(i = 0; i < size; i++)
+        crc = fcs_crc32_table[(crc ^ (unsigned char)frame[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFU;
+}
+
+static inline void
+ethernet_fcs_update(ethernet_hdr_t *ethernet_hdr, unsigned int pkt_size){
+
+    if(!l2_fcs_enabled)
+        return;
+
+    SET_COMMON_ETH_FCS(ethernet_hdr,
+        pkt_size - GET_ETH_HDR_SIZE_EXCL_PAYLOAD(ethernet_hdr),
+        ethernet_fcs_compute((char *)ethernet_hdr, pkt_size - sizeof(ethernet_hdr->FCS)));
+}
+
+/* Return new packet size if pkt is tagged with new vlan id. The 802.1Q
+ * hdr goes in front of the type field : the MACs are moved 4 bytes into
+ * the headroom of the buffer, which the caller must have, and the type
+ * and payload stay where they are*/
 
 ethernet_hdr_t * 
 tag_pkt_with_vlan_id(ethernet_hdr_t *ethernet_hdr, 
@@ -774,42 +1115,25 @@ tag_pkt_with_vlan_id(ethernet_hdr_t *ethernet_hdr,
                      int vlan_id, 
                      unsigned int *new_pkt_size){
 
-    unsigned int payload_size  = 0 ;
-    *new_pkt_size = 0;
+    vlan_ethernet_hdr_t *vlan_ethernet_hdr;
 
     /*If the pkt is already tagged, replace it*/
     vlan_8021q_hdr_t *vlan_8021q_hdr = 
         is_pkt_vlan_tagged(ethernet_hdr);
 
-    
     if(vlan_8021q_hdr){
-        payload_size = total_pkt_size - VLAN_ETH_HDR_SIZE_EXCL_PAYLOAD;
         vlan_8021q_hdr->tci_vid = (short)vlan_id;
-        
-        /*Update checksum, however not used*/
-        SET_COMMON_ETH_FCS(ethernet_hdr, payload_size, 0);
-
+        ethernet_fcs_update(ethernet_hdr, total_pkt_size);
         *new_pkt_size = total_pkt_size;
         return ethernet_hdr;
     }
 
     /*If the pkt is not already tagged, tag it*/
-    /*Fix me : Avoid declaring local variables of type 
-     ethernet_hdr_t or vlan_ethernet_hdr_t as the size of these
-     variables are too large and is not healthy for program stack
-     memory*/
-    ethernet_hdr_t ethernet_hdr_old;
-    memcpy((char *)&ethernet_hdr_old, (char *)ethernet_hdr, 
-                ETH_HDR_SIZE_EXCL_PAYLOAD - sizeof(ethernet_hdr_old.FCS));
-
-    payload_size = total_pkt_size - ETH_HDR_SIZE_EXCL_PAYLOAD; 
-    vlan_ethernet_hdr_t *vlan_ethernet_hdr = 
-            (vlan_ethernet_hdr_t *)((char *)ethernet_hdr - sizeof(vlan_8021q_hdr_t));
-
-    memset((char *)vlan_ethernet_hdr, 0, 
-                VLAN_ETH_HDR_SIZE_EXCL_PAYLOAD - sizeof(vlan_ethernet_hdr->FCS));
-    memcpy(vlan_ethernet_hdr->dst_mac.mac, ethernet_hdr_old.dst_mac.mac, sizeof(mac_add_t));
-    memcpy(vlan_ethernet_hdr->src_mac.mac, ethernet_hdr_old.src_mac.mac, sizeof(mac_add_t));
+    vlan_ethernet_hdr = (vlan_ethernet_hdr_t *)
+        ((char *)ethernet_hdr - sizeof(vlan_8021q_hdr_t));
+
+    memmove((char *)vlan_ethernet_hdr, (char *)ethernet_hdr,
+            sizeof(mac_add_t) * 2);
 
     /*Come to 802.1Q vlan hdr*/
     vlan_ethernet_hdr->vlan_8021q_hdr.tpid = VLAN_8021Q_PROTO;
@@ -817,64 +1141,40 @@ tag_pkt_with_vlan_id(ethernet_hdr_t *ethernet_hdr,
     vlan_ethernet_hdr->vlan_8021q_hdr.tci_dei = 0;
     vlan_ethernet_hdr->vlan_8021q_hdr.tci_vid = (short)vlan_id;
 
-    /*Type field*/
-    vlan_ethernet_hdr->type = ethernet_hdr_old.type;
-
-    /*No need to copy data*/
-
-    /*Update checksum, however not used*/
-    SET_COMMON_ETH_FCS((ethernet_hdr_t *)vlan_ethernet_hdr, payload_size, 0 );
-    *new_pkt_size = total_pkt_size  + sizeof(vlan_8021q_hdr_t);
+    *new_pkt_size = total_pkt_size + sizeof(vlan_8021q_hdr_t);
+    ethernet_fcs_update((ethernet_hdr_t *)vlan_ethernet_hdr, *new_pkt_size);
     return (ethernet_hdr_t *)vlan_ethernet_hdr;
 }
 
 /* Return new packet size if pkt is untagged with the existing
- * vlan 801.1q hdr*/
+ * vlan 801.1q hdr. The MACs are moved 4 bytes forward over the
+ * 802.1Q hdr, the frame then starts 4 bytes later in the buffer*/
 ethernet_hdr_t *
 untag_pkt_with_vlan_id(ethernet_hdr_t *ethernet_hdr, 
                      unsigned int total_pkt_size,
                      unsigned int *new_pkt_size){
 
-    *new_pkt_size = 0;
+    char *vlan_ethernet_hdr = (char *)ethernet_hdr;
 
-    vlan_8021q_hdr_t *vlan_8021q_hdr =
-        is_pkt_vlan_tagged(ethernet_hdr);
-    
     /*NOt tagged already, do nothing*/    
-    if(!vlan_8021q_hdr){
+    if(!is_pkt_vlan_tagged(ethernet_hdr)){
         *new_pkt_size = total_pkt_size;
         return ethernet_hdr;
     }
 
-    /*Fix me : Avoid declaring local variables of type 
-     ethernet_hdr_t or vlan_ethernet_hdr_t as the size of these
-     variables are too large and is not healthy for program stack
-     memory*/
-    vlan_ethernet_hdr_t vlan_ethernet_hdr_old;
-    memcpy((char *)&vlan_ethernet_hdr_old, (char *)ethernet_hdr, 
-                VLAN_ETH_HDR_SIZE_EXCL_PAYLOAD - sizeof(vlan_ethernet_hdr_old.FCS));
-
-    ethernet_hdr = (ethernet_hdr_t *)((char *)ethernet_hdr + sizeof(vlan_8021q_hdr_t));
-   
-    memcpy(ethernet_hdr->dst_mac.mac, vlan_ethernet_hdr_old.dst_mac.mac, sizeof(mac_add_t));
-    memcpy(ethernet_hdr->src_mac.mac, vlan_ethernet_hdr_old.src_mac.mac, sizeof(mac_add_t));
-
-    ethernet_hdr->type = vlan_ethernet_hdr_old.type;
-    
-    /*No need to copy data*/
-    unsigned int payload_size = total_pkt_size - VLAN_ETH_HDR_SIZE_EXCL_PAYLOAD;
+    ethernet_hdr = (ethernet_hdr_t *)(vlan_ethernet_hdr + sizeof(vlan_8021q_hdr_t));
+    memmove((char *)ethernet_hdr, vlan_ethernet_hdr, sizeof(mac_add_t) * 2);
 
-    /*Update checksum, however not used*/
-    SET_COMMON_ETH_FCS(ethernet_hdr, payload_size, 0);
-    
     *new_pkt_size = total_pkt_size - sizeof(vlan_8021q_hdr_t);
+    ethernet_fcs_update(ethernet_hdr, *new_pkt_size);
     return ethernet_hdr;
 }
 
 static void
 promote_pkt_to_layer2(node_t *node, interface_t *iif,
-        ethernet_hdr_t *ethernet_hdr,
-        uint32_t pkt_size){
+        pkt_buffer_t *pkt_buf){
+
+    ethernet_hdr_t *ethernet_hdr = (ethernet_hdr_t *)pkt_buf->data;
 
     switch(ethernet_hdr->type){
         case ARP_MSG:
@@ -894,10 +1194,8 @@ promote_pkt_to_layer2(node_t *node, interface_t *iif,
             }
             break;
         case ETH_IP:
-            promote_pkt_to_layer3(node, iif,
-                    GET_ETHERNET_HDR_PAYLOAD(ethernet_hdr),
-                    pkt_size - GET_ETH_HDR_SIZE_EXCL_PAYLOAD(ethernet_hdr),
-                    ethernet_hdr->type);
+            PULL_ETH_HDR(pkt_buf);
+            promote_pkt_to_layer3(node, iif, pkt_buf, ETH_IP);
             break;
         default:
             ;
@@ -907,11 +1205,18 @@ promote_pkt_to_layer2(node_t *node, interface_t *iif,
 
 void
 layer2_frame_recv(node_t *node, interface_t *interface,
-                     char *pkt, unsigned int pkt_size){
+                  pkt_buffer_t *pkt_buf){
 
     unsigned int vlan_id_to_tag = 0;
 
-    ethernet_hdr_t *ethernet_hdr = (ethernet_hdr_t *)pkt;
+    ethernet_hdr_t *ethernet_hdr = (ethernet_hdr_t *)pkt_buf->data;
+
+    /*BPDUs are untagged on trunks too, and never forwarded*/
+    if(IS_STP_BPDU(ethernet_hdr)){
+        if(!IS_INTF_L3_MODE(interface) && IF_L2_MODE(interface) != L2_MODE_UNKNOWN)
+            stp_recv_bpdu(node, interface, pkt_buf);
+        return;
+    }
     
     if(l2_frame_recv_qualify_on_interface(interface, 
                                           ethernet_hdr, 
@@ -926,7 +1231,7 @@ layer2_frame_recv(node_t *node, interface_t *interface,
     /*Handle Reception of a L2 Frame on L3 Interface*/
     if(IS_INTF_L3_MODE(interface)){
 
-       promote_pkt_to_layer2(node, interface, ethernet_hdr, pkt_size);
+       promote_pkt_to_layer2(node, interface, pkt_buf);
     }
     else if(IF_L2_MODE(interface) == ACCESS ||
                 IF_L2_MODE(interface) == TRUNK){
@@ -934,12 +1239,15 @@ layer2_frame_recv(node_t *node, interface_t *interface,
         unsigned int new_pkt_size = 0;
 
         if(vlan_id_to_tag){
-            pkt = (char *)tag_pkt_with_vlan_id((ethernet_hdr_t *)pkt,
-                                                pkt_size, vlan_id_to_tag,
+            /*802.1Q hdr goes into the headroom*/
+            assert(pkt_buffer_headroom(pkt_buf) >= sizeof(vlan_8021q_hdr_t));
+            ethernet_hdr = tag_pkt_with_vlan_id(ethernet_hdr,
+                                                pkt_buf->len, vlan_id_to_tag,
                                                 &new_pkt_size);
-            assert(new_pkt_size != pkt_size);
+            assert(new_pkt_size != pkt_buf->len);
+            pkt_buffer_set_data(pkt_buf, (char *)ethernet_hdr, new_pkt_size);
         }
-        l2_switch_recv_frame(interface, pkt, vlan_id_to_tag ? new_pkt_size : pkt_size);
+        l2_switch_recv_frame(interface, pkt_buf);
     }
     else
         return; /*Do nothing, drop the packet*/
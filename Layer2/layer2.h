@@ -38,6 +38,9 @@
 #include "../tcpconst.h"
 #include <stdlib.h>  /*for calloc*/
 #include "../graph.h"
+#include "../pkt_buffer.h"
+#include "../WheelTimer/WheelTimer.h"
+#include <stddef.h>  /*for offsetof*/
 
 #pragma pack (push,1)
 typedef struct arp_hdr_{
@@ -58,7 +61,7 @@ typedef struct ethernet_hdr_{
     mac_add_t dst_mac;
     mac_add_t src_mac;
     unsigned short type;
-    char payload[248];  /*Max allowed 1500*/
+    char payload[IF_MAX_MTU];  /*Max allowed IF_MAX_MTU, jumbo frames*/
     unsigned int FCS;
 } ethernet_hdr_t;
 
@@ -76,14 +79,62 @@ send_arp_broadcast_request(node_t *node,
                            interface_t *oif, 
                            char *ip_addr);
 
-/*ARP Table APIs*/
+/* ARP Table APIs : entries are chained in a hash table keyed on the
+ * IP address, no of buckets is doubled when exceeded by the no of
+ * entries*/
+#define ARP_TABLE_INIT_SIZE     16
+
+/* Timers of the entries, in sec. A resolved entry is REACHABLE for
+ * ARP_REACHABLE_TIME after the ARP reply, then STALE : still used, but
+ * the first use sends a request, and the entry is removed unless
+ * confirmed within ARP_PROBE_TIME, or if unused for ARP_STALE_TIME.
+ * Requests of an unresolved entry are retransmitted after
+ * ARP_RETRANS_TIME, doubled after every retransmission. After
+ * ARP_MAX_REQUESTS requests the entry FAILED, its queued pkts are
+ * dropped, and so are the pkts to the IP for ARP_NEGATIVE_CACHE_TIME,
+ * without sending any request*/
+#define ARP_REACHABLE_TIME      30
+#define ARP_STALE_TIME          60
+#define ARP_PROBE_TIME          5
+#define ARP_RETRANS_TIME        1
+#define ARP_MAX_REQUESTS        4
+#define ARP_NEGATIVE_CACHE_TIME 5
+
+/*Pkts queued on an unresolved entry, pkts beyond are dropped*/
+#define ARP_MAX_PENDING_PKTS    64
+
+typedef enum{
+
+    ARP_ENTRY_INCOMPLETE,   /*Sane entry, resolution in progress*/
+    ARP_ENTRY_REACHABLE,
+    ARP_ENTRY_STALE,
+    ARP_ENTRY_FAILED        /*Negative cache entry*/
+} arp_entry_state_t;
+
+typedef struct arp_pending_entry_ arp_pending_entry_t;
+typedef struct arp_entry_ arp_entry_t;
+
 typedef struct arp_table_{
 
     glthread_t arp_entries;
+    arp_entry_t **buckets;
+    unsigned int size;      /*No of buckets, power of 2*/
+    unsigned int n_entries;
+    uint32_t now;           /*sec, advanced by the ARP timer*/
+    unsigned long long n_requests;      /*Incl. retransmissions*/
+    unsigned long long n_retransmits;
+    unsigned long long n_failures;      /*Resolutions given up*/
+    unsigned long long n_queue_drops;   /*Pkts dropped, pending queue full*/
+    unsigned long long n_unresolved_drops; /*Pkts dropped, resolution failed*/
+    unsigned long long n_aged;          /*Stale entries removed*/
+    int timer_started;
+    wheel_timer_elem_t *timer;
+    /* Serializes the threads sending pkts out of the node with the ARP
+     * timer and the CLI. APIs below do not take it, except the ones
+     * which say so*/
+    pthread_mutex_t lock;
 } arp_table_t;
 
-typedef struct arp_pending_entry_ arp_pending_entry_t;
-typedef struct arp_entry_ arp_entry_t;
 typedef void (*arp_processing_fn)(node_t *, 
                                   interface_t *oif,
                                   arp_entry_t *, 
@@ -92,8 +143,7 @@ struct arp_pending_entry_{
 
     glthread_t arp_pending_entry_glue;
     arp_processing_fn cb;
-    unsigned int pkt_size;  /*Including ether net hdr*/
-    char pkt[0];
+    pkt_buffer_t *pkt_buf;  /*Including ether net hdr*/
 };
 GLTHREAD_TO_STRUCT(arp_pending_entry_glue_to_arp_pending_entry, \
     arp_pending_entry_t, arp_pending_entry_glue);
@@ -101,51 +151,445 @@ GLTHREAD_TO_STRUCT(arp_pending_entry_glue_to_arp_pending_entry, \
 
 struct arp_entry_{
 
-    ip_add_t ip_addr;   /*key*/
+    uint32_t ip_addr;   /*key, host byte order*/
     mac_add_t mac_addr;
-    char oif_name[IF_NAME_SIZE];
+    interface_t *oif;   /*NULL till resolved*/
     glthread_t arp_glue;
+    arp_entry_t *hash_next; /*Next entry in the bucket*/
     bool_t is_sane;
+    arp_entry_state_t state;
+    uint32_t expires;       /*arp_table->now the state times out at*/
+    unsigned int n_requests;/*Sent since the last reply*/
+    interface_t *req_oif;   /*Requests are sent out of*/
     /* List of packets which are pending for
      * this ARP resolution*/
     glthread_t arp_pending_list;
+    unsigned int n_pending;
 };
 GLTHREAD_TO_STRUCT(arp_glue_to_arp_entry, arp_entry_t, arp_glue);
 GLTHREAD_TO_STRUCT(arp_pending_list_to_arp_entry, arp_entry_t, arp_pending_list);
 
 #define IS_ARP_ENTRIES_EQUAL(arp_entry_1, arp_entry_2)  \
-    (strncmp(arp_entry_1->ip_addr.ip_addr, arp_entry_2->ip_addr.ip_addr, 16) == 0 && \
+    (arp_entry_1->ip_addr == arp_entry_2->ip_addr && \
         strncmp(arp_entry_1->mac_addr.mac, arp_entry_2->mac_addr.mac, 6) == 0 && \
-        strncmp(arp_entry_1->oif_name, arp_entry_2->oif_name, IF_NAME_SIZE) == 0 && \
+        arp_entry_1->oif == arp_entry_2->oif && \
         arp_entry_1->is_sane == arp_entry_2->is_sane &&     \
         arp_entry_1->is_sane == FALSE)
 
 void
 init_arp_table(arp_table_t **arp_table);
 
+/*ip_addr in host byte order*/
 arp_entry_t *
-arp_table_lookup(arp_table_t *arp_table, char *ip_addr);
+arp_table_lookup(arp_table_t *arp_table, uint32_t ip_addr);
 
+/*Takes arp_table->lock*/
 void
 clear_arp_table(arp_table_t *arp_table);
 
 void
-delete_arp_entry(arp_entry_t *arp_entry);
+delete_arp_entry(arp_table_t *arp_table, arp_entry_t *arp_entry);
 
+/*Takes arp_table->lock*/
 void
-delete_arp_table_entry(arp_table_t *arp_table, char *ip_addr);
+delete_arp_table_entry(arp_table_t *arp_table, uint32_t ip_addr);
 
 bool_t
 arp_table_entry_add(arp_table_t *arp_table, arp_entry_t *arp_entry,
                         glthread_t **arp_pending_list);
 
+/*Takes arp_table->lock*/
 void
 dump_arp_table(arp_table_t *arp_table);
 
+/*Takes arp_table->lock*/
 void
 arp_table_update_from_arp_reply(arp_table_t *arp_table,
                                 arp_hdr_t *arp_hdr, interface_t *iif);
 
+/* One tick of the ARP timer : advance the clock of the table, and
+ * retransmit, fail, age or remove the entries whose state timed out.
+ * Takes arp_table->lock*/
+void
+arp_table_tick(arp_table_t *arp_table);
+
+/* MAC Table APIs : open addressing hash table keyed on (MAC, VLAN),
+ * collisions are resolved by linear probing. No of slots is a power of
+ * 2, doubled when the table is MAC_TABLE_MAX_LOAD_PCT % full*/
+#define MAC_TABLE_INIT_SIZE     64
+#define MAC_TABLE_MAX_LOAD_PCT  75
+
+/* Entries not refreshed for the aging time are removed by the aging
+ * timer. Rather than a timer per entry, every tick of the timer sweeps
+ * a bucket of slots, the whole table is swept every aging time / 2, so
+ * an entry is removed between 1 and 1.5 times the aging time after the
+ * MAC was last seen. Default aging time is in net.h*/
+
+typedef struct mac_table_entry_{
+
+    mac_add_t mac;          /*key*/
+    unsigned short vlan_id; /*key, 0 for untagged frames*/
+    uint32_t last_seen;     /*mac_table->now the MAC was last learned*/
+    interface_t *oif;       /*NULL for a free slot*/
+} mac_table_entry_t;
+
+typedef struct mac_table_{
+
+    mac_table_entry_t *entries;
+    unsigned int size;
+    unsigned int n_entries;
+    unsigned int aging_time;    /*sec, 0 : entries never age*/
+    uint32_t now;               /*sec, advanced by the aging timer*/
+    unsigned int sweep_slot;    /*Next slot the aging sweep visits*/
+    unsigned long long n_learned;
+    unsigned long long n_aged;
+    wheel_timer_elem_t *aging_timer;
+    /* Serializes the receiver thread of the node with the aging timer
+     * and the CLI. APIs below do not take it, except the ones which
+     * say so*/
+    pthread_mutex_t lock;
+} mac_table_t;
+
+mac_table_entry_t *
+mac_table_lookup(mac_table_t *mac_table, char *mac, unsigned int vlan_id);
+
+/* Learn that 'mac' in 'vlan_id' is reachable via 'oif' : an existing
+ * entry is refreshed in place, memory is allocated only when the table
+ * grows. Returns FALSE if the table could not grow*/
+bool_t
+mac_table_learn(mac_table_t *mac_table, char *mac, unsigned int vlan_id,
+                interface_t *oif);
+
+void
+delete_mac_table_entry(mac_table_t *mac_table, char *mac,
+                       unsigned int vlan_id);
+
+/*Takes mac_table->lock*/
+void
+clear_mac_table(mac_table_t *mac_table);
+
+/*Takes mac_table->lock*/
+void
+dump_mac_table(mac_table_t *mac_table);
+
+/* One tick of the aging timer : advance the clock of the table and
+ * sweep the next bucket of slots. Takes mac_table->lock*/
+void
+mac_table_age_out(mac_table_t *mac_table);
+
+/* Register the aging timer of the table with the nw timer, done once
+ * the node has an interface in L2 mode*/
+void
+mac_table_start_aging(mac_table_t *mac_table);
+
+/* 0 disables aging, returns FALSE if aging time is out of range. Takes
+ * mac_table->lock*/
+bool_t
+mac_table_set_aging_time(mac_table_t *mac_table, unsigned int aging_time);
+
+/* Flood list of a vlan : interfaces of the L2 switch broadcast and
+ * unknown unicast frames of the vlan are flooded out of. Interfaces
+ * which send the frame as is (trunks of the vlan) come first, the ones
+ * which untag it (access ports of the vlan) last. List of vlan 0 holds
+ * the vlan unaware access ports, which flood untagged frames as is*/
+typedef struct l2_flood_list_{
+
+    unsigned int n_intf;
+    unsigned int n_untag;   /*Last n_untag interfaces untag the frame*/
+    interface_t *intf[0];
+} l2_flood_list_t;
+
+struct l2_flood_table_{
+
+    l2_flood_list_t *lists[VLAN_ID_MAX + 1];    /*NULL for a vlan with no interfaces*/
+    /*Receiver thread of the node walks the lists while the CLI rebuilds them*/
+    pthread_rwlock_t lock;
+};
+
+/* Rebuild the flood lists of all the vlans of the node, called when
+ * the L2 or L3 mode of an interface of the node changes*/
+void
+l2_switch_rebuild_flood_lists(node_t *node);
+
+/* Rebuild the flood list of 'vlan_id' only, called when the vlan
+ * membership of an interface of the node changes*/
+void
+l2_switch_rebuild_flood_list(node_t *node, unsigned int vlan_id);
+
+/* ARP suppression : an L2 switch snoops the ARP replies it switches
+ * into a cache of the IP to MAC bindings of every vlan, and answers an
+ * ARP request for an IP of the cache itself, out of the interface the
+ * request came in on, instead of flooding it over the vlan. A binding
+ * is trusted only while the MAC table knows its MAC on another
+ * interface, the request is flooded and the binding removed otherwise.
+ * Open addressing hash table keyed on (IP, VLAN), as the MAC table*/
+#define ARP_SUPPR_TABLE_INIT_SIZE       64
+#define ARP_SUPPR_TABLE_MAX_LOAD_PCT    75
+/*Replies of IPs not cached are not snooped once the cache is full*/
+#define ARP_SUPPR_TABLE_MAX_ENTRIES     65536
+/* Bindings not refreshed by an ARP reply for so long are removed, the
+ * table is swept by the nw timer as the MAC table is, in sec*/
+#define ARP_SUPPR_AGING_TIME            MAC_TABLE_DEF_AGING_TIME
+
+typedef struct arp_suppr_entry_{
+
+    uint32_t ip_addr;       /*key, host byte order, 0 for a free slot*/
+    unsigned short vlan_id; /*key, 0 for untagged frames*/
+    mac_add_t mac;
+    uint32_t last_seen;     /*arp_suppr_table->now of the last reply snooped*/
+} arp_suppr_entry_t;
+
+struct arp_suppr_table_{
+
+    arp_suppr_entry_t *entries;
+    unsigned int size;
+    unsigned int n_entries;
+    bool_t enabled;
+    uint32_t now;                       /*sec, advanced by the aging timer*/
+    unsigned int sweep_slot;            /*Next slot the aging sweep visits*/
+    unsigned long long n_snooped;       /*ARP replies snooped*/
+    unsigned long long n_full;          /*Replies not snooped, cache full*/
+    unsigned long long n_removed;       /*Bindings aged, or whose MAC is gone*/
+    unsigned long long n_suppressed;    /*ARP requests answered, not flooded*/
+    unsigned long long n_flooded;       /*ARP requests not in the cache*/
+    wheel_timer_elem_t *aging_timer;
+    /*Serializes the receiver thread of the node with the timer and the CLI*/
+    pthread_mutex_t lock;
+};
+
+/*Cache is allocated when first enabled, and cleared when disabled*/
+void
+l2_switch_set_arp_suppression(node_t *node, bool_t enable);
+
+void
+dump_arp_suppr_table(node_t *node);
+
+/* Spanning tree : every L2 switch runs a rapid spanning tree (802.1w)
+ * instance shared by all the vlans. Ports the tree blocks neither
+ * receive nor send data frames, see stp_port_state(). Access ports are
+ * edge ports and forward at once, unless they receive a BPDU. Timers
+ * are driven by the nw timer, in sec*/
+#define STP_MAX_BRIDGE_PRIORITY 61440   /*In steps of 4096*/
+#define STP_PORT_PRIORITY       128
+#define STP_PORT_PATH_COST      20000   /*1 Gbps*/
+#define STP_HELLO_TIME          2
+#define STP_MAX_AGE             20
+#define STP_FORWARD_DELAY       15
+/*Info received on a port is discarded if not refreshed for so long*/
+#define STP_INFO_AGE            (3 * STP_HELLO_TIME)
+
+/*BPDU flags*/
+#define STP_FLAG_TC             0x01
+#define STP_FLAG_PROPOSAL       0x02
+#define STP_FLAG_ROLE_SHIFT     2
+#define STP_FLAG_ROLE_MASK      0x0c
+#define STP_FLAG_LEARNING       0x10
+#define STP_FLAG_FORWARDING     0x20
+#define STP_FLAG_AGREEMENT      0x40
+
+/*Port role encoding in BPDU flags*/
+#define STP_BPDU_ROLE_ALT_BACKUP    1
+#define STP_BPDU_ROLE_ROOT          2
+#define STP_BPDU_ROLE_DESIGNATED    3
+
+#pragma pack (push,1)
+/*LLC hdr and RST BPDU, carried in an 802.3 frame*/
+typedef struct stp_bpdu_{
+
+    unsigned char llc_dsap;     /*0x42*/
+    unsigned char llc_ssap;     /*0x42*/
+    unsigned char llc_ctrl;     /*0x03*/
+    unsigned short protocol_id; /*0*/
+    unsigned char version;      /*2 : RSTP*/
+    unsigned char bpdu_type;    /*0x02 : RST BPDU*/
+    unsigned char flags;
+    uint64_t root_id;
+    uint32_t root_path_cost;
+    uint64_t bridge_id;
+    unsigned short port_id;
+    unsigned short message_age; /*Hops from the root*/
+    unsigned short max_age;
+    unsigned short hello_time;
+    unsigned short forward_delay;
+    unsigned char version1_length;
+} stp_bpdu_t;
+#pragma pack(pop)
+
+typedef enum{
+
+    STP_PORT_DISCARDING,
+    STP_PORT_LEARNING,
+    STP_PORT_FORWARDING
+} stp_port_state_t;
+
+typedef enum{
+
+    STP_ROLE_DISABLED,
+    STP_ROLE_ROOT,
+    STP_ROLE_DESIGNATED,
+    STP_ROLE_ALTERNATE,
+    STP_ROLE_BACKUP
+} stp_port_role_t;
+
+/*Spanning tree priority vector, lower is better*/
+typedef struct stp_prio_vector_{
+
+    uint64_t root_id;
+    uint32_t root_path_cost;
+    uint64_t bridge_id;         /*Designated bridge*/
+    unsigned short port_id;     /*Designated port*/
+} stp_prio_vector_t;
+
+struct stp_port_{
+
+    interface_t *intf;
+    unsigned short port_id;
+    stp_port_role_t role;
+    stp_port_state_t state;
+    bool_t enabled;             /*L2 mode and link up*/
+    bool_t admin_edge;          /*Access port*/
+    bool_t edge;                /*Access port which received no BPDU*/
+    bool_t info_valid;          /*msg_prio holds the info of the designated port of the link*/
+    stp_prio_vector_t msg_prio;
+    unsigned short msg_age;
+    uint32_t info_expires;
+    uint32_t fwd_expires;       /*Designated port moves to the next state, 0 if not running*/
+    bool_t proposing;           /*Designated port waiting for an agreement*/
+    bool_t synced;              /*Root port agreed to the proposal of its designated port*/
+    uint32_t tc_until;          /*BPDUs sent carry the TC flag until then*/
+    unsigned long long n_bpdu_rx;
+    unsigned long long n_bpdu_tx;
+};
+
+struct stp_bridge_{
+
+    node_t *node;
+    uint64_t bridge_id;
+    stp_prio_vector_t root_prio;    /*Root priority vector of the bridge*/
+    stp_port_t *root_port;          /*NULL if the bridge is the root*/
+    unsigned short root_msg_age;
+    uint32_t now;                   /*sec, advanced by the stp timer*/
+    uint32_t next_hello;
+    unsigned long long n_topology_changes;
+    wheel_timer_elem_t *timer;
+    /* Serializes the receiver thread of the node with the stp timer
+     * and the CLI*/
+    pthread_mutex_t lock;
+};
+
+static inline bool_t
+IS_STP_BPDU(ethernet_hdr_t *ethernet_hdr){
+
+    return ethernet_hdr->dst_mac.mac[0] == 0x01 &&
+           ethernet_hdr->dst_mac.mac[1] == 0x80 &&
+           ethernet_hdr->dst_mac.mac[2] == 0xC2 &&
+           ethernet_hdr->dst_mac.mac[3] == 0x00 &&
+           ethernet_hdr->dst_mac.mac[4] == 0x00 &&
+           ethernet_hdr->dst_mac.mac[5] == 0x00;
+}
+
+/* Interfaces not under spanning tree control are forwarding, the state
+ * is read without the bridge lock*/
+static inline stp_port_state_t
+stp_port_state(interface_t *interface){
+
+    stp_port_t *stp_port = IF_STP_PORT(interface);
+
+    return stp_port ? __atomic_load_n(&stp_port->state, __ATOMIC_RELAXED) :
+                      STP_PORT_FORWARDING;
+}
+
+/*BPDU received on an interface of the node in L2 mode*/
+void
+stp_recv_bpdu(node_t *node, interface_t *interface, pkt_buffer_t *pkt_buf);
+
+/* Takes the interface under spanning tree control or out of it, called
+ * when its L2/L3 mode or the state of its link changes*/
+void
+stp_intf_state_changed(interface_t *interface);
+
+/*Returns FALSE if priority is out of range. Takes the bridge lock*/
+bool_t
+stp_set_bridge_priority(node_t *node, unsigned int priority);
+
+/* TRUE if no port of the bridge is waiting for an agreement or for its
+ * forward delay. Takes the bridge lock*/
+bool_t
+stp_bridge_converged(node_t *node);
+
+/*Takes the bridge lock*/
+void
+dump_stp_bridge(node_t *node);
+
+/*Remove the MACs learned on 'oif'. Takes mac_table->lock*/
+void
+mac_table_flush_intf(mac_table_t *mac_table, interface_t *oif);
+
+/*Remove the MACs learned on all interfaces but 'oif'. Takes mac_table->lock*/
+void
+mac_table_flush_other_intfs(mac_table_t *mac_table, interface_t *oif);
+
+/* Link aggregation : a LAG is a logical interface of the node bundling
+ * physical interfaces (members) to the same nbr. L2/L3 config lives on
+ * the LAG, frames received on a member are received on the LAG, and
+ * frames sent out of the LAG leave through one member picked by the
+ * hash of their hdrs, so that the frames of a flow are not reordered.
+ * No LACP, members are bundled statically at both ends*/
+#define LAG_MAX_MEMBERS     16
+
+/* Hash buckets, each mapped to an operational member. Buckets of a
+ * member which goes down are spread over the other members, so that
+ * the flows on those stay where they are*/
+#define LAG_HASH_SLOTS      256
+#define LAG_SLOT_NONE       0xFF
+
+typedef enum{
+
+    LAG_HASH_L2,    /*src and dst MAC*/
+    LAG_HASH_L3,    /*L2, src and dst IP*/
+    LAG_HASH_L4     /*L3, protocol and first 4 bytes of the L4 hdr (ports)*/
+} lag_hash_mode_t;
+
+struct lag_{
+
+    interface_t *intf;
+    lag_hash_mode_t hash_mode;
+    unsigned int n_members;
+    interface_t *members[LAG_MAX_MEMBERS];  /*Members are never removed*/
+    bool_t active[LAG_MAX_MEMBERS];         /*Member up at both ends*/
+    unsigned int n_active;
+    /*Index in members[] of the member carrying the bucket*/
+    unsigned char slots[LAG_HASH_SLOTS];
+    unsigned long long n_tx[LAG_MAX_MEMBERS];
+    unsigned long long n_tx_drops;          /*No member up*/
+    unsigned long long n_failovers;         /*Members gone down*/
+    /*Serializes the updates, the data path reads the slots lock free*/
+    pthread_mutex_t lock;
+};
+
+/* Creates the LAG interface 'lag_name' on the node. Returns NULL if
+ * the name is taken*/
+interface_t *
+node_create_lag(node_t *node, char *lag_name);
+
+/* Interface must be linked, and be in neither L2 nor L3 mode. Returns
+ * FALSE if it can not be bundled*/
+bool_t
+lag_add_member(interface_t *lag_intf, interface_t *interface);
+
+bool_t
+node_add_lag_member(node_t *node, char *lag_name, char *intf_name);
+
+void
+lag_set_hash_mode(interface_t *lag_intf, lag_hash_mode_t hash_mode);
+
+void
+interface_set_lag_hash(interface_t *interface, char *lag_hash_option);
+
+/*Takes lag->lock*/
+void
+dump_lag(interface_t *lag_intf);
+
 /*APIs to be used to create topologies*/
 void
 node_set_intf_l2_mode(node_t *node, char *intf_name, intf_l2_mode_t intf_l2_mode);
@@ -153,14 +597,15 @@ node_set_intf_l2_mode(node_t *node, char *intf_name, intf_l2_mode_t intf_l2_mode
 void
 node_set_intf_vlan_membsership(node_t *node, char *intf_name, unsigned int vlan_id);
 
-void
+/*Returns FALSE if the pkt could not be queued*/
+bool_t
 add_arp_pending_entry(arp_entry_t *arp_entry, 
                         arp_processing_fn, 
                         char *pkt, 
                         unsigned int pkt_size); 
 
 arp_entry_t *
-create_arp_sane_entry(arp_table_t *arp_table, char *ip_addr);
+create_arp_sane_entry(arp_table_t *arp_table, uint32_t ip_addr);
 
 static bool_t 
 arp_entry_sane(arp_entry_t *arp_entry){
@@ -176,9 +621,9 @@ arp_entry_sane(arp_entry_t *arp_entry){
 typedef struct vlan_8021q_hdr_{
 
     unsigned short tpid; /* = 0x8100*/
-    short tci_pcp : 3 ;  /* inital 4 bits not used in this course*/
-    short tci_dei : 1;   /*Not used*/
-    short tci_vid : 12 ; /*Tagged vlan id*/
+    unsigned short tci_pcp : 3 ;  /* inital 4 bits not used in this course*/
+    unsigned short tci_dei : 1;   /*Not used*/
+    unsigned short tci_vid : 12 ; /*Tagged vlan id*/
 } vlan_8021q_hdr_t;
 
 typedef struct vlan_ethernet_hdr_{
@@ -187,7 +632,7 @@ typedef struct vlan_ethernet_hdr_{
     mac_add_t src_mac;
     vlan_8021q_hdr_t vlan_8021q_hdr;
     unsigned short type;
-    char payload[248];  /*Max allowed 1500*/
+    char payload[IF_MAX_MTU];  /*Max allowed IF_MAX_MTU, jumbo frames*/
     unsigned int FCS;
 } vlan_ethernet_hdr_t;
 #pragma pack(pop)
@@ -249,17 +694,19 @@ SET_COMMON_ETH_FCS(ethernet_hdr_t *ethernet_hdr,
     }
 }
 
+/* Wrap the pkt present in the pkt buffer into an ethernet frame : the
+ * hdr goes into the headroom and the FCS into the tailroom of the
+ * buffer, the payload is not moved*/
 static inline ethernet_hdr_t *
-ALLOC_ETH_HDR_WITH_PAYLOAD(char *pkt, unsigned int pkt_size){
+PUSH_ETH_HDR(pkt_buffer_t *pkt_buf){
 
-    char *temp = calloc(1, pkt_size);
-    memcpy(temp, pkt, pkt_size);
+    unsigned int payload_size = pkt_buf->len;
 
-    ethernet_hdr_t *eth_hdr = (ethernet_hdr_t *)(pkt - ETH_HDR_SIZE_EXCL_PAYLOAD);
-    memset((char *)eth_hdr, 0, ETH_HDR_SIZE_EXCL_PAYLOAD);
-    memcpy(eth_hdr->payload, temp, pkt_size);
-    SET_COMMON_ETH_FCS(eth_hdr, pkt_size, 0);
-    free(temp);
+    ethernet_hdr_t *eth_hdr = (ethernet_hdr_t *)pkt_buffer_push(pkt_buf,
+                                offsetof(ethernet_hdr_t, payload));
+    pkt_buffer_put(pkt_buf, sizeof(eth_hdr->FCS));
+    memset((char *)eth_hdr, 0, offsetof(ethernet_hdr_t, payload));
+    SET_COMMON_ETH_FCS(eth_hdr, payload_size, 0);
     return eth_hdr;
 }
 
@@ -274,6 +721,19 @@ GET_ETH_HDR_SIZE_EXCL_PAYLOAD(ethernet_hdr_t *ethernet_hdr){
     }
 }
 
+/* Strip the ethernet hdr and the FCS off the frame present in the pkt
+ * buffer, leaving the ethernet payload in the buffer*/
+static inline void
+PULL_ETH_HDR(pkt_buffer_t *pkt_buf){
+
+    ethernet_hdr_t *eth_hdr = (ethernet_hdr_t *)pkt_buf->data;
+    unsigned int payload_size = pkt_buf->len - 
+                                GET_ETH_HDR_SIZE_EXCL_PAYLOAD(eth_hdr);
+
+    pkt_buffer_pull(pkt_buf, GET_ETHERNET_HDR_PAYLOAD(eth_hdr) - (char *)eth_hdr);
+    pkt_buffer_trim(pkt_buf, payload_size);
+}
+
 static inline bool_t 
 l2_frame_recv_qualify_on_interface(interface_t *interface, 
                                     ethernet_hdr_t *ethernet_hdr,
@@ -385,6 +845,11 @@ l2_frame_recv_qualify_on_interface(interface_t *interface,
     return FALSE;
 }
 
+extern bool_t l2_fcs_enabled;
+
+unsigned int
+ethernet_fcs_compute(char *frame, unsigned int size);
+
 ethernet_hdr_t *
 untag_pkt_with_vlan_id(ethernet_hdr_t *ethernet_hdr,
                      unsigned int total_pkt_size,
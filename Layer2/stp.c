@@ -0,0 +1,777 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  stp.c
+ *
+ *    Description:  This file implements the rapid spanning tree protocol (802.1w) run by
+ *    L2 switches, so that a loop in the L2 topology does not turn every broadcast into
+ *    a storm : BPDUs, port role selection, proposal/agreement and the port state timers
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 09:14:37 AM
+ *       Revision:  1.0
+ *       Compiler:  gcc
+ *
+ *        This file is part of the NetworkGraph distribution (https://github.com/sachinites).
+ *        Copyright (c) 2017 Abhishek Sagar.
+ *        This program is free software: you can redistribute it and/or modify
+ *        it under the terms of the GNU General Public License as published by
+ *        the Free Software Foundation, version 3.
+ *
+ *        This program is distributed in the hope that it will be useful, but
+ *        WITHOUT ANY WARRANTY; without even the implied warranty of
+ *        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *        General Public License for more details.
+ *
+ *        You should have received a copy of the GNU General Public License
+ *        along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =====================================================================================
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <memory.h>
+#include "../graph.h"
+#include "layer2.h"
+#include "comm.h"
+
+static unsigned char stp_group_mac[sizeof(mac_add_t)] =
+    {0x01, 0x80, 0xC2, 0x00, 0x00, 0x00};
+
+#define STP_BRIDGE_ID(priority, mac)    (((uint64_t)(priority) << 48) | (mac))
+#define STP_BRIDGE_PRIORITY(bridge_id)  ((unsigned int)((bridge_id) >> 48))
+
+static char *
+stp_port_role_str(stp_port_role_t role){
+
+    switch(role){
+        case STP_ROLE_ROOT:
+            return "root";
+        case STP_ROLE_DESIGNATED:
+            return "designated";
+        case STP_ROLE_ALTERNATE:
+            return "alternate";
+        case STP_ROLE_BACKUP:
+            return "backup";
+        default:
+            return "disabled";
+    }
+}
+
+static char *
+stp_port_state_str(stp_port_state_t state){
+
+    switch(state){
+        case STP_PORT_LEARNING:
+            return "learning";
+        case STP_PORT_FORWARDING:
+            return "forwarding";
+        default:
+            return "discarding";
+    }
+}
+
+/*Returns < 0 if 'a' is better than 'b', 0 if same, > 0 if worse*/
+static int
+stp_prio_vector_cmp(stp_prio_vector_t *a, stp_prio_vector_t *b){
+
+    if(a->root_id != b->root_id)
+        return a->root_id < b->root_id ? -1 : 1;
+    if(a->root_path_cost != b->root_path_cost)
+        return a->root_path_cost < b->root_path_cost ? -1 : 1;
+    if(a->bridge_id != b->bridge_id)
+        return a->bridge_id < b->bridge_id ? -1 : 1;
+    if(a->port_id != b->port_id)
+        return a->port_id < b->port_id ? -1 : 1;
+    return 0;
+}
+
+/*MAC of the bridge is the lowest MAC of the interfaces of the node*/
+static uint64_t
+stp_bridge_mac(node_t *node){
+
+    unsigned int i, j;
+    uint64_t mac, min_mac = ~0ULL;
+
+    for(i = 0; i < node->n_intf; i++){
+        for(mac = 0, j = 0; j < sizeof(mac_add_t); j++)
+            mac = (mac << 8) | IF_MAC(node->intf[i])[j];
+        if(mac < min_mac)
+            min_mac = mac;
+    }
+    return min_mac & 0xffffffffffffULL;
+}
+
+/* Interface in L2 mode whose link is up at both ends, LAG with a
+ * member up*/
+static bool_t
+stp_intf_oper(interface_t *interface){
+
+    if(IS_INTF_L3_MODE(interface) ||
+        (IF_L2_MODE(interface) != ACCESS && IF_L2_MODE(interface) != TRUNK) ||
+        !IF_IS_UP(interface))
+        return FALSE;
+
+    if(IF_LAG(interface))
+        return __atomic_load_n(&IF_LAG(interface)->n_active, __ATOMIC_RELAXED) != 0;
+
+    return interface->link &&
+           IF_IS_UP(get_nbr_interface(interface));
+}
+
+/*Priority vector the port advertises*/
+static void
+stp_port_prio_vector(stp_bridge_t *stp_bridge, stp_port_t *stp_port,
+                     stp_prio_vector_t *prio_vector){
+
+    prio_vector->root_id = stp_bridge->root_prio.root_id;
+    prio_vector->root_path_cost = stp_bridge->root_prio.root_path_cost;
+    prio_vector->bridge_id = stp_bridge->bridge_id;
+    prio_vector->port_id = stp_port->port_id;
+}
+
+static void
+stp_send_bpdu(stp_bridge_t *stp_bridge, stp_port_t *stp_port,
+              unsigned char flags){
+
+    ethernet_hdr_t *ethernet_hdr;
+    stp_bpdu_t *bpdu;
+    pkt_buffer_t *pkt_buf;
+    stp_prio_vector_t prio_vector;
+    unsigned int payload_size = sizeof(stp_bpdu_t);
+
+    pkt_buf = pkt_buffer_alloc(ETH_HDR_SIZE_EXCL_PAYLOAD + payload_size);
+    if(!pkt_buf)
+        return;
+    ethernet_hdr = (ethernet_hdr_t *)pkt_buffer_put(pkt_buf,
+                        ETH_HDR_SIZE_EXCL_PAYLOAD + payload_size);
+    memset(ethernet_hdr, 0, ETH_HDR_SIZE_EXCL_PAYLOAD + payload_size);
+
+    memcpy(ethernet_hdr->dst_mac.mac, stp_group_mac, sizeof(mac_add_t));
+    memcpy(ethernet_hdr->src_mac.mac, IF_MAC(stp_port->intf), sizeof(mac_add_t));
+    ethernet_hdr->type = payload_size;  /*802.3 length*/
+
+    switch(stp_port->role){
+        case STP_ROLE_ROOT:
+            flags |= STP_BPDU_ROLE_ROOT << STP_FLAG_ROLE_SHIFT;
+            break;
+        case STP_ROLE_DESIGNATED:
+            flags |= STP_BPDU_ROLE_DESIGNATED << STP_FLAG_ROLE_SHIFT;
+            if(stp_port->proposing)
+                flags |= STP_FLAG_PROPOSAL;
+            break;
+        default:
+            flags |= STP_BPDU_ROLE_ALT_BACKUP << STP_FLAG_ROLE_SHIFT;
+    }
+    if(stp_port->state == STP_PORT_LEARNING)
+        flags |= STP_FLAG_LEARNING;
+    if(stp_port->state == STP_PORT_FORWARDING)
+        flags |= STP_FLAG_LEARNING | STP_FLAG_FORWARDING;
+    if(stp_bridge->now < stp_port->tc_until)
+        flags |= STP_FLAG_TC;
+
+    stp_port_prio_vector(stp_bridge, stp_port, &prio_vector);
+
+    bpdu = (stp_bpdu_t *)ethernet_hdr->payload;
+    bpdu->llc_dsap = 0x42;
+    bpdu->llc_ssap = 0x42;
+    bpdu->llc_ctrl = 0x03;
+    bpdu->protocol_id = 0;
+    bpdu->version = 2;
+    bpdu->bpdu_type = 0x02;
+    bpdu->flags = flags;
+    bpdu->root_id = prio_vector.root_id;
+    bpdu->root_path_cost = prio_vector.root_path_cost;
+    bpdu->bridge_id = prio_vector.bridge_id;
+    bpdu->port_id = prio_vector.port_id;
+    bpdu->message_age = stp_bridge->root_msg_age;
+    bpdu->max_age = STP_MAX_AGE;
+    bpdu->hello_time = STP_HELLO_TIME;
+    bpdu->forward_delay = STP_FORWARD_DELAY;
+    bpdu->version1_length = 0;
+
+    SET_COMMON_ETH_FCS(ethernet_hdr, payload_size, 0); /*Not used*/
+
+    send_pkt_out((char *)ethernet_hdr, ETH_HDR_SIZE_EXCL_PAYLOAD + payload_size,
+                 stp_port->intf);
+    stp_port->n_bpdu_tx++;
+    pkt_buffer_free(pkt_buf);
+}
+
+static void
+stp_send_designated_bpdus(stp_bridge_t *stp_bridge){
+
+    unsigned int i;
+    stp_port_t *stp_port;
+    node_t *node = stp_bridge->node;
+
+    for(i = 0; i < node->n_intf; i++){
+        stp_port = IF_STP_PORT(node->intf[i]);
+        if(stp_port && stp_port->enabled &&
+            stp_port->role == STP_ROLE_DESIGNATED)
+            stp_send_bpdu(stp_bridge, stp_port, 0);
+    }
+}
+
+/* Topology changed : MACs learned on other ports than 'stp_port' may
+ * now be reachable some other way. BPDUs sent out of the root port and
+ * the designated ports, but 'except', carry the TC flag for a while*/
+static void
+stp_topology_change(stp_bridge_t *stp_bridge, stp_port_t *stp_port,
+                    stp_port_t *except){
+
+    unsigned int i;
+    stp_port_t *other;
+    node_t *node = stp_bridge->node;
+
+    mac_table_flush_other_intfs(NODE_MAC_TABLE(node), stp_port->intf);
+
+    for(i = 0; i < node->n_intf; i++){
+        other = IF_STP_PORT(node->intf[i]);
+        if(!other || other == except || !other->enabled || other->edge ||
+            (other->role != STP_ROLE_ROOT && other->role != STP_ROLE_DESIGNATED))
+            continue;
+        other->tc_until = stp_bridge->now + 2 * STP_HELLO_TIME;
+        stp_send_bpdu(stp_bridge, other, 0);
+    }
+}
+
+static void
+stp_port_set_state(stp_bridge_t *stp_bridge, stp_port_t *stp_port,
+                   stp_port_state_t state){
+
+    if(stp_port->state == state)
+        return;
+
+    __atomic_store_n(&stp_port->state, state, __ATOMIC_RELAXED);
+
+    /*Non edge port starting to forward changes the topology*/
+    if(state == STP_PORT_FORWARDING && !stp_port->edge){
+        stp_bridge->n_topology_changes++;
+        stp_topology_change(stp_bridge, stp_port, NULL);
+    }
+}
+
+/* Port role selection : the root port is the port which offers the best
+ * path to the root, a port is designated if it offers the best path to
+ * the root to its link, else alternate, or backup if the better path is
+ * offered by another port of the bridge itself. Returns TRUE if the
+ * root or any role changed*/
+static bool_t
+stp_select_roles(stp_bridge_t *stp_bridge){
+
+    unsigned int i;
+    bool_t changed = FALSE;
+    stp_port_t *stp_port, *root_port = NULL;
+    stp_port_role_t role;
+    stp_prio_vector_t best, candidate, designated;
+    node_t *node = stp_bridge->node;
+
+    best.root_id = stp_bridge->bridge_id;
+    best.root_path_cost = 0;
+    best.bridge_id = stp_bridge->bridge_id;
+    best.port_id = 0;
+
+    for(i = 0; i < node->n_intf; i++){
+
+        stp_port = IF_STP_PORT(node->intf[i]);
+        if(!stp_port || !stp_port->enabled || !stp_port->info_valid)
+            continue;
+
+        /*Own BPDUs looped back, or too far from the root*/
+        if(stp_port->msg_prio.bridge_id == stp_bridge->bridge_id ||
+            stp_port->msg_age + 1 >= STP_MAX_AGE)
+            continue;
+
+        candidate = stp_port->msg_prio;
+        candidate.root_path_cost += STP_PORT_PATH_COST;
+
+        if(stp_prio_vector_cmp(&candidate, &best) < 0){
+            best = candidate;
+            root_port = stp_port;
+        }
+    }
+
+    if(root_port != stp_bridge->root_port ||
+        stp_prio_vector_cmp(&best, &stp_bridge->root_prio)){
+        changed = TRUE;
+        if(root_port)
+            root_port->synced = FALSE;
+    }
+
+    stp_bridge->root_prio = best;
+    stp_bridge->root_port = root_port;
+    stp_bridge->root_msg_age = root_port ? root_port->msg_age + 1 : 0;
+
+    for(i = 0; i < node->n_intf; i++){
+
+        stp_port = IF_STP_PORT(node->intf[i]);
+        if(!stp_port)
+            continue;
+
+        if(!stp_port->enabled)
+            role = STP_ROLE_DISABLED;
+        else if(stp_port == root_port)
+            role = STP_ROLE_ROOT;
+        else{
+            stp_port_prio_vector(stp_bridge, stp_port, &designated);
+            if(stp_port->info_valid &&
+                stp_prio_vector_cmp(&stp_port->msg_prio, &designated) < 0){
+                role = stp_port->msg_prio.bridge_id == stp_bridge->bridge_id ?
+                    STP_ROLE_BACKUP : STP_ROLE_ALTERNATE;
+            }
+            else{
+                /*Inferior info of the link is superseded by ours*/
+                stp_port->info_valid = FALSE;
+                role = STP_ROLE_DESIGNATED;
+            }
+        }
+
+        if(stp_port->role != role){
+            stp_port->role = role;
+            changed = TRUE;
+        }
+    }
+    return changed;
+}
+
+/* Move the ports to the state their role calls for : root port and edge
+ * ports forward at once, alternate and backup ports discard, other
+ * designated ports propose and wait for an agreement, or for twice the
+ * forward delay. Returns TRUE if a port started or stopped forwarding*/
+static bool_t
+stp_update_states(stp_bridge_t *stp_bridge){
+
+    unsigned int i;
+    bool_t changed = FALSE;
+    stp_port_t *stp_port;
+    stp_port_state_t state;
+    node_t *node = stp_bridge->node;
+
+    for(i = 0; i < node->n_intf; i++){
+
+        stp_port = IF_STP_PORT(node->intf[i]);
+        if(!stp_port)
+            continue;
+
+        state = stp_port->state;
+
+        switch(stp_port->role){
+            case STP_ROLE_ROOT:
+                stp_port->proposing = FALSE;
+                stp_port->fwd_expires = 0;
+                state = STP_PORT_FORWARDING;
+                break;
+            case STP_ROLE_DESIGNATED:
+                if(stp_port->edge){
+                    stp_port->proposing = FALSE;
+                    stp_port->fwd_expires = 0;
+                    state = STP_PORT_FORWARDING;
+                }
+                else if(state != STP_PORT_FORWARDING && !stp_port->fwd_expires){
+                    stp_port->proposing = TRUE;
+                    stp_port->fwd_expires = stp_bridge->now + STP_FORWARD_DELAY;
+                }
+                break;
+            default:
+                stp_port->proposing = FALSE;
+                stp_port->fwd_expires = 0;
+                state = STP_PORT_DISCARDING;
+        }
+
+        if(state != stp_port->state &&
+            (state == STP_PORT_FORWARDING ||
+             stp_port->state == STP_PORT_FORWARDING))
+            changed = TRUE;
+        stp_port_set_state(stp_bridge, stp_port, state);
+    }
+    return changed;
+}
+
+/* Root port received a proposal : every non edge designated port which
+ * is not discarding yet is blocked, and proposes downstream, so that no
+ * loop can form while the root port agrees*/
+static bool_t
+stp_sync(stp_bridge_t *stp_bridge, stp_port_t *root_port){
+
+    unsigned int i;
+    bool_t changed = FALSE;
+    stp_port_t *stp_port;
+    node_t *node = stp_bridge->node;
+
+    for(i = 0; i < node->n_intf; i++){
+
+        stp_port = IF_STP_PORT(node->intf[i]);
+        if(!stp_port || stp_port == root_port || !stp_port->enabled ||
+            stp_port->edge || stp_port->role != STP_ROLE_DESIGNATED ||
+            stp_port->state == STP_PORT_DISCARDING)
+            continue;
+
+        if(stp_port->state == STP_PORT_FORWARDING)
+            changed = TRUE;
+        stp_port_set_state(stp_bridge, stp_port, STP_PORT_DISCARDING);
+        stp_port->proposing = TRUE;
+        stp_port->fwd_expires = stp_bridge->now + STP_FORWARD_DELAY;
+    }
+    root_port->synced = TRUE;
+    return changed;
+}
+
+void
+stp_recv_bpdu(node_t *node, interface_t *interface, pkt_buffer_t *pkt_buf){
+
+    stp_bpdu_t *bpdu;
+    unsigned int bpdu_role;
+    bool_t changed, fwd_changed;
+    stp_prio_vector_t msg_prio;
+    stp_bridge_t *stp_bridge = NODE_STP_BRIDGE(node);
+    stp_port_t *stp_port = IF_STP_PORT(interface);
+    ethernet_hdr_t *ethernet_hdr = (ethernet_hdr_t *)pkt_buf->data;
+
+    if(!stp_bridge || !stp_port ||
+        pkt_buf->len < ETH_HDR_SIZE_EXCL_PAYLOAD + sizeof(stp_bpdu_t))
+        return;
+
+    bpdu = (stp_bpdu_t *)ethernet_hdr->payload;
+    if(bpdu->llc_dsap != 0x42 || bpdu->protocol_id != 0 ||
+        bpdu->bpdu_type != 0x02)
+        return;
+
+    pthread_mutex_lock(&stp_bridge->lock);
+
+    if(!stp_port->enabled){
+        pthread_mutex_unlock(&stp_bridge->lock);
+        return;
+    }
+
+    stp_port->n_bpdu_rx++;
+    /*There is a bridge behind the port after all*/
+    stp_port->edge = FALSE;
+
+    bpdu_role = (bpdu->flags & STP_FLAG_ROLE_MASK) >> STP_FLAG_ROLE_SHIFT;
+
+    /*Only designated ports advertise the info of the link*/
+    if(bpdu_role == STP_BPDU_ROLE_DESIGNATED &&
+        bpdu->message_age < STP_MAX_AGE){
+
+        msg_prio.root_id = bpdu->root_id;
+        msg_prio.root_path_cost = bpdu->root_path_cost;
+        msg_prio.bridge_id = bpdu->bridge_id;
+        msg_prio.port_id = bpdu->port_id;
+
+        if(!stp_port->info_valid ||
+            stp_prio_vector_cmp(&msg_prio, &stp_port->msg_prio))
+            stp_port->synced = FALSE;
+
+        stp_port->msg_prio = msg_prio;
+        stp_port->msg_age = bpdu->message_age;
+        stp_port->info_valid = TRUE;
+        stp_port->info_expires = stp_bridge->now + STP_INFO_AGE;
+    }
+
+    changed = stp_select_roles(stp_bridge);
+    fwd_changed = stp_update_states(stp_bridge);
+
+    if(bpdu_role == STP_BPDU_ROLE_DESIGNATED &&
+        (bpdu->flags & STP_FLAG_PROPOSAL)){
+
+        /*Root port syncs before it agrees, a blocked port is in sync*/
+        if(stp_port->role == STP_ROLE_ROOT && !stp_port->synced){
+            fwd_changed |= stp_sync(stp_bridge, stp_port);
+            changed = TRUE;
+        }
+        if(stp_port->role == STP_ROLE_ROOT ||
+            stp_port->role == STP_ROLE_ALTERNATE ||
+            stp_port->role == STP_ROLE_BACKUP)
+            stp_send_bpdu(stp_bridge, stp_port, STP_FLAG_AGREEMENT);
+    }
+
+    if((bpdu->flags & STP_FLAG_AGREEMENT) &&
+        bpdu_role != STP_BPDU_ROLE_DESIGNATED &&
+        stp_port->role == STP_ROLE_DESIGNATED &&
+        stp_port->proposing &&
+        bpdu->root_id == stp_bridge->root_prio.root_id){
+
+        stp_port->proposing = FALSE;
+        stp_port->fwd_expires = 0;
+        stp_port_set_state(stp_bridge, stp_port, STP_PORT_FORWARDING);
+        fwd_changed = TRUE;
+    }
+
+    /*TC is propagated along the active topology only*/
+    if((bpdu->flags & STP_FLAG_TC) &&
+        (stp_port->role == STP_ROLE_ROOT ||
+         stp_port->role == STP_ROLE_DESIGNATED) &&
+        stp_port->state != STP_PORT_DISCARDING)
+        stp_topology_change(stp_bridge, stp_port, stp_port);
+
+    if(changed)
+        stp_send_designated_bpdus(stp_bridge);
+    else if(bpdu_role == STP_BPDU_ROLE_DESIGNATED &&
+            stp_port->role == STP_ROLE_DESIGNATED)
+        /*Nbr does not know better yet*/
+        stp_send_bpdu(stp_bridge, stp_port, 0);
+
+    if(fwd_changed)
+        l2_switch_rebuild_flood_lists(node);
+
+    pthread_mutex_unlock(&stp_bridge->lock);
+}
+
+/* One tick of the stp timer : received info ages out, designated ports
+ * no agreement came for move on to learning and forwarding, and
+ * designated ports send hello BPDUs. Takes the bridge lock*/
+static void
+stp_tick(stp_bridge_t *stp_bridge){
+
+    unsigned int i;
+    bool_t changed = FALSE, fwd_changed = FALSE;
+    stp_port_t *stp_port;
+    node_t *node = stp_bridge->node;
+
+    pthread_mutex_lock(&stp_bridge->lock);
+
+    stp_bridge->now += NW_TIMER_TICK_SEC;
+
+    for(i = 0; i < node->n_intf; i++){
+        stp_port = IF_STP_PORT(node->intf[i]);
+        if(stp_port && stp_port->info_valid &&
+            stp_bridge->now >= stp_port->info_expires){
+            stp_port->info_valid = FALSE;
+            changed = TRUE;
+        }
+    }
+
+    if(changed){
+        stp_select_roles(stp_bridge);
+        fwd_changed = stp_update_states(stp_bridge);
+    }
+
+    for(i = 0; i < node->n_intf; i++){
+
+        stp_port = IF_STP_PORT(node->intf[i]);
+        if(!stp_port || !stp_port->enabled ||
+            stp_port->role != STP_ROLE_DESIGNATED ||
+            !stp_port->fwd_expires ||
+            stp_bridge->now < stp_port->fwd_expires)
+            continue;
+
+        if(stp_port->state == STP_PORT_DISCARDING){
+            stp_port_set_state(stp_bridge, stp_port, STP_PORT_LEARNING);
+            stp_port->fwd_expires = stp_bridge->now + STP_FORWARD_DELAY;
+            continue;
+        }
+        stp_port->proposing = FALSE;
+        stp_port->fwd_expires = 0;
+        stp_port_set_state(stp_bridge, stp_port, STP_PORT_FORWARDING);
+        fwd_changed = TRUE;
+    }
+
+    if(changed || stp_bridge->now >= stp_bridge->next_hello){
+        stp_send_designated_bpdus(stp_bridge);
+        stp_bridge->next_hello = stp_bridge->now + STP_HELLO_TIME;
+    }
+
+    if(fwd_changed)
+        l2_switch_rebuild_flood_lists(node);
+
+    pthread_mutex_unlock(&stp_bridge->lock);
+}
+
+static void
+stp_timer_cb(void *arg, int arg_size){
+
+    stp_tick(*(stp_bridge_t **)arg);
+}
+
+static stp_bridge_t *
+stp_bridge_create(node_t *node){
+
+    stp_bridge_t *stp_bridge = calloc(1, sizeof(stp_bridge_t));
+
+    stp_bridge->node = node;
+    stp_bridge->bridge_id = STP_BRIDGE_ID(STP_DEF_BRIDGE_PRIORITY,
+                                          stp_bridge_mac(node));
+    stp_bridge->root_prio.root_id = stp_bridge->bridge_id;
+    stp_bridge->root_prio.bridge_id = stp_bridge->bridge_id;
+    pthread_mutex_init(&stp_bridge->lock, NULL);
+    __atomic_store_n(&NODE_STP_BRIDGE(node), stp_bridge, __ATOMIC_RELEASE);
+
+    stp_bridge->timer = register_app_event(nw_get_timer(),
+            stp_timer_cb, &stp_bridge, sizeof(stp_bridge_t *),
+            NW_TIMER_TICK_SEC, 1);
+    return stp_bridge;
+}
+
+static stp_port_t *
+stp_port_create(interface_t *interface){
+
+    stp_port_t *stp_port = calloc(1, sizeof(stp_port_t));
+
+    stp_port->intf = interface;
+    stp_port->port_id = ((STP_PORT_PRIORITY >> 4) << 12) |
+                        ((interface->ifindex + 1) & 0xfff);
+    stp_port->role = STP_ROLE_DISABLED;
+    stp_port->state = STP_PORT_DISCARDING;
+    __atomic_store_n(&IF_STP_PORT(interface), stp_port, __ATOMIC_RELEASE);
+    return stp_port;
+}
+
+void
+stp_intf_state_changed(interface_t *interface){
+
+    node_t *node = interface->att_node;
+    bool_t enabled = stp_intf_oper(interface);
+    bool_t admin_edge = IF_L2_MODE(interface) == ACCESS;
+    stp_bridge_t *stp_bridge = NODE_STP_BRIDGE(node);
+    stp_port_t *stp_port = IF_STP_PORT(interface);
+
+    /*Bridge and ports are created from the CLI thread only*/
+    if(!stp_port){
+        if(!enabled)
+            return;
+        if(!stp_bridge)
+            stp_bridge = stp_bridge_create(node);
+        stp_port = stp_port_create(interface);
+    }
+
+    pthread_mutex_lock(&stp_bridge->lock);
+
+    if(stp_port->enabled == enabled &&
+        (!enabled || stp_port->admin_edge == admin_edge)){
+        pthread_mutex_unlock(&stp_bridge->lock);
+        return;
+    }
+
+    /*MACs learned on the port are gone with its link*/
+    if(stp_port->enabled && !enabled)
+        mac_table_flush_intf(NODE_MAC_TABLE(node), interface);
+
+    stp_port->enabled = enabled;
+    stp_port->admin_edge = admin_edge;
+    stp_port->edge = admin_edge;
+    stp_port->info_valid = FALSE;
+    stp_port->synced = FALSE;
+    stp_port->proposing = FALSE;
+    stp_port->fwd_expires = 0;
+    stp_port->tc_until = 0;
+    __atomic_store_n(&stp_port->state,
+            enabled && admin_edge ? STP_PORT_FORWARDING : STP_PORT_DISCARDING,
+            __ATOMIC_RELAXED);
+
+    stp_select_roles(stp_bridge);
+    stp_update_states(stp_bridge);
+    stp_send_designated_bpdus(stp_bridge);
+    l2_switch_rebuild_flood_lists(node);
+
+    pthread_mutex_unlock(&stp_bridge->lock);
+}
+
+bool_t
+stp_set_bridge_priority(node_t *node, unsigned int priority){
+
+    stp_bridge_t *stp_bridge = NODE_STP_BRIDGE(node);
+
+    if(priority > STP_MAX_BRIDGE_PRIORITY || priority % 4096){
+        printf("Error : Bridge priority must be a multiple of 4096 in range [0-%u]\n",
+                STP_MAX_BRIDGE_PRIORITY);
+        return FALSE;
+    }
+
+    if(!stp_bridge)
+        stp_bridge = stp_bridge_create(node);
+
+    pthread_mutex_lock(&stp_bridge->lock);
+
+    stp_bridge->bridge_id = STP_BRIDGE_ID(priority, stp_bridge_mac(node));
+    stp_select_roles(stp_bridge);
+    if(stp_update_states(stp_bridge))
+        l2_switch_rebuild_flood_lists(node);
+    stp_send_designated_bpdus(stp_bridge);
+
+    pthread_mutex_unlock(&stp_bridge->lock);
+    return TRUE;
+}
+
+bool_t
+stp_bridge_converged(node_t *node){
+
+    unsigned int i;
+    bool_t converged = TRUE;
+    stp_port_t *stp_port;
+    stp_bridge_t *stp_bridge = NODE_STP_BRIDGE(node);
+
+    if(!stp_bridge)
+        return TRUE;
+
+    pthread_mutex_lock(&stp_bridge->lock);
+
+    for(i = 0; i < node->n_intf && converged; i++){
+
+        stp_port = IF_STP_PORT(node->intf[i]);
+        if(!stp_port || !stp_port->enabled)
+            continue;
+
+        if(stp_port->proposing ||
+            ((stp_port->role == STP_ROLE_ROOT ||
+              stp_port->role == STP_ROLE_DESIGNATED) &&
+             stp_port->state != STP_PORT_FORWARDING))
+            converged = FALSE;
+    }
+
+    pthread_mutex_unlock(&stp_bridge->lock);
+    return converged;
+}
+
+static void
+stp_print_bridge_id(uint64_t bridge_id){
+
+    printf("%u.%u:%u:%u:%u:%u:%u", STP_BRIDGE_PRIORITY(bridge_id),
+            (unsigned int)(bridge_id >> 40) & 0xff,
+            (unsigned int)(bridge_id >> 32) & 0xff,
+            (unsigned int)(bridge_id >> 24) & 0xff,
+            (unsigned int)(bridge_id >> 16) & 0xff,
+            (unsigned int)(bridge_id >> 8) & 0xff,
+            (unsigned int)bridge_id & 0xff);
+}
+
+void
+dump_stp_bridge(node_t *node){
+
+    unsigned int i;
+    stp_port_t *stp_port;
+    stp_bridge_t *stp_bridge = NODE_STP_BRIDGE(node);
+
+    if(!stp_bridge){
+        printf("Spanning tree not running, no interface in L2 mode\n");
+        return;
+    }
+
+    pthread_mutex_lock(&stp_bridge->lock);
+
+    printf("Bridge ID : ");
+    stp_print_bridge_id(stp_bridge->bridge_id);
+    printf("\nRoot ID   : ");
+    stp_print_bridge_id(stp_bridge->root_prio.root_id);
+    printf(", Root path cost : %u, Root port : %s\n",
+            stp_bridge->root_prio.root_path_cost,
+            stp_bridge->root_port ? stp_bridge->root_port->intf->if_name :
+                                    "none, bridge is root");
+    printf("Topology changes : %llu\n", stp_bridge->n_topology_changes);
+
+    for(i = 0; i < node->n_intf; i++){
+
+        stp_port = IF_STP_PORT(node->intf[i]);
+        if(!stp_port) continue;
+
+        printf("\t%-16s | %-10s | %-10s | %-4s | BPDUs rx : %llu, tx : %llu\n",
+                stp_port->intf->if_name,
+                stp_port_role_str(stp_port->role),
+                stp_port_state_str(stp_port->state),
+                stp_port->edge ? "edge" : "",
+                stp_port->n_bpdu_rx, stp_port->n_bpdu_tx);
+    }
+
+    pthread_mutex_unlock(&stp_bridge->lock);
+}
@@ -38,6 +38,7 @@
 #include <stdlib.h>
 #include "tcpconst.h"
 #include "comm.h"
+#include "pkt_buffer.h"
 #include <arpa/inet.h> /*for inet_ntop & inet_pton*/
 
 /*L3 layer recv pkt from below Layer 2. Layer 2 hdr has been
@@ -70,7 +71,7 @@ is_layer3_local_delivery(node_t *node, unsigned int dst_ip){
     unsigned int i = 0;
     interface_t *intf;
 
-    for( ; i < MAX_INTF_PER_NODE; i++){
+    for( ; i < node->n_intf; i++){
         
         intf = node->intf[i];
         if(!intf) return FALSE;
@@ -100,19 +101,20 @@ promote_pkt_to_layer5(node_t *node, interface_t *recv_intf,
 extern void
 demote_pkt_to_layer2(node_t *node,
                      unsigned int next_hop_ip,
-                     char *outgoing_intf, 
-                     char *pkt, unsigned int pkt_size,
+                     interface_t *outgoing_intf, 
+                     pkt_buffer_t *pkt_buf,
                      int protocol_number);
 
 
 static void
 layer3_ip_pkt_recv_from_bottom(node_t *node, interface_t *interface,
-        ip_hdr_t *pkt, unsigned int pkt_size){
+        pkt_buffer_t *pkt_buf){
 
     char *l4_hdr, *l5_hdr;
     char dest_ip_addr[16];
+    unsigned int ip_payload_size;
 
-    ip_hdr_t *ip_hdr = pkt;
+    ip_hdr_t *ip_hdr = (ip_hdr_t *)pkt_buf->data;
 
     unsigned int dst_ip = htonl(ip_hdr->dst_ip);
     inet_ntop(AF_INET, &dst_ip, dest_ip_addr, 16);
@@ -165,9 +167,10 @@ layer3_ip_pkt_recv_from_bottom(node_t *node, interface_t *interface,
                 case IP_IN_IP:
                     /*Packet has reached ERO, now set the packet onto its new 
                       Journey from ERO to final destination*/
-                    layer3_ip_pkt_recv_from_bottom(node, interface, 
-                            (ip_hdr_t *)INCREMENT_IPHDR(ip_hdr),
-                            IP_HDR_PAYLOAD_SIZE(ip_hdr));
+                    ip_payload_size = IP_HDR_PAYLOAD_SIZE(ip_hdr);
+                    pkt_buffer_pull(pkt_buf, IP_HDR_LEN_IN_BYTES(ip_hdr));
+                    pkt_buffer_trim(pkt_buf, ip_payload_size);
+                    layer3_ip_pkt_recv_from_bottom(node, interface, pkt_buf);
                     return;
                 default:
                     ;
@@ -181,7 +184,7 @@ layer3_ip_pkt_recv_from_bottom(node_t *node, interface_t *interface,
                 node,           /*Current processing node*/
                 0,              /*Dont know next hop IP as dest is present in local subnet*/
                 NULL,           /*No oif as dest is present in local subnet*/
-                (char *)ip_hdr, pkt_size,  /*Network Layer payload and size*/
+                pkt_buf,        /*Network Layer payload and size*/
                 ETH_IP);        /*Network Layer need to tell Data link layer, what type of payload it is passing down*/
         return;
     }
@@ -202,7 +205,7 @@ layer3_ip_pkt_recv_from_bottom(node_t *node, interface_t *interface,
     demote_pkt_to_layer2(node, 
             next_hop_ip,
             l3_route->oif,
-            (char *)ip_hdr, pkt_size,
+            pkt_buf,
             ETH_IP); /*Network Layer need to tell Data link layer, what type of payload it is passing down*/
 }
 
@@ -312,7 +315,7 @@ dump_rt_table(rt_table_t *rt_table){
         printf("\t%-18s %-4d %-18s %s\n", 
                 l3_route->dest, l3_route->mask,
                 l3_route->is_direct ? "NA" : l3_route->gw_ip, 
-                l3_route->is_direct ? "NA" : l3_route->oif);
+                l3_route->is_direct ? "NA" : l3_route->oif->if_name);
 
     } ITERATE_GLTHREAD_END(&rt_table->route_list, curr); 
 }
@@ -347,7 +350,7 @@ rt_table_add_direct_route(rt_table_t *rt_table,
 void
 rt_table_add_route(rt_table_t *rt_table,
                    char *dst, char mask,
-                   char *gw, char *oif){
+                   char *gw, interface_t *oif){
 
    unsigned int dst_int;
    char dst_str_with_mask[16];
@@ -374,8 +377,7 @@ rt_table_add_route(rt_table_t *rt_table,
    if(gw && oif){
         strncpy(l3_route->gw_ip, gw, 16);
         l3_route->gw_ip[15] = '\0';
-        strncpy(l3_route->oif, oif, IF_NAME_SIZE);
-        l3_route->oif[IF_NAME_SIZE - 1] = '\0';
+        l3_route->oif = oif;
    }
 
    if(!_rt_table_entry_add(rt_table, l3_route)){
@@ -387,14 +389,14 @@ rt_table_add_route(rt_table_t *rt_table,
 
 static void
 layer3_pkt_recv_from_bottom(node_t *node, interface_t *interface,
-                            char *pkt, unsigned int pkt_size, 
+                            pkt_buffer_t *pkt_buf, 
                             int L3_protocol_type){
 
     switch(L3_protocol_type){
         
         case ETH_IP:
         case IP_IN_IP:
-            layer3_ip_pkt_recv_from_bottom(node, interface, (ip_hdr_t *)pkt, pkt_size);
+            layer3_ip_pkt_recv_from_bottom(node, interface, pkt_buf);
             break;
         default:
             ;
@@ -406,10 +408,10 @@ layer3_pkt_recv_from_bottom(node_t *node, interface_t *interface,
 void
 promote_pkt_to_layer3(node_t *node,            /*Current node on which the pkt is received*/
                       interface_t *interface,  /*ingress interface*/
-                      char *pkt, unsigned int pkt_size, /*L3 payload*/
+                      pkt_buffer_t *pkt_buf,   /*L3 payload*/
                       int L3_protocol_number){  /*obtained from eth_hdr->type field*/
 
-        layer3_pkt_recv_from_bottom(node, interface, pkt, pkt_size, L3_protocol_number);
+        layer3_pkt_recv_from_bottom(node, interface, pkt_buf, L3_protocol_number);
 }
 
 static void
@@ -443,16 +445,24 @@ layer3_pkt_receieve_from_top(node_t *node, char *pkt,
         return;
     }
 
-    char *new_pkt = NULL;
-    unsigned int new_pkt_size = 0 ;
+    char *ip_payload = NULL;
+    unsigned int ip_payload_size = 0 ;
+    pkt_buffer_t *pkt_buf = pkt_buffer_alloc(
+                                ETH_MAX_FRAME_SIZE(iphdr.total_length * 4));
 
-    new_pkt_size = iphdr.total_length * 4;
-    new_pkt = calloc(1, MAX_PACKET_BUFFER_SIZE);
+    if(!pkt_buf)
+        return;
 
-    memcpy(new_pkt, (char *)&iphdr, iphdr.ihl * 4);
+    /*Payload first, then hdrs of all the layers are prepended
+     * in the headroom of the buffer*/
+    ip_payload_size = iphdr.total_length * 4 - iphdr.ihl * 4;
+    ip_payload = pkt_buffer_put(pkt_buf, ip_payload_size);
+    memset(ip_payload, 0, ip_payload_size);
 
     if(pkt && size)
-        memcpy(new_pkt + (iphdr.ihl * 4), pkt, size);
+        pkt_buffer_copy(ip_payload, pkt, size);
+
+    memcpy(pkt_buffer_push(pkt_buf, iphdr.ihl * 4), (char *)&iphdr, iphdr.ihl * 4);
 
     /*Now Resolve Next hop*/
     bool_t is_direct_route = l3_is_direct_route(l3_route);
@@ -472,16 +482,13 @@ layer3_pkt_receieve_from_top(node_t *node, char *pkt,
         next_hop_ip = dest_ip_address;
     }
 
-    char *shifted_pkt_buffer = pkt_buffer_shift_right(new_pkt,
-            new_pkt_size, MAX_PACKET_BUFFER_SIZE);
-
     demote_pkt_to_layer2(node,
             next_hop_ip,
             is_direct_route ? 0 : l3_route->oif,
-            shifted_pkt_buffer, new_pkt_size,
+            pkt_buf,
             ETH_IP);
 
-    free(new_pkt);
+    pkt_buffer_free(pkt_buf);
 }
 
 /*An API to be used by L4 or L5 to push the pkt down the TCP/IP
@@ -105,7 +105,7 @@ typedef struct l3_route_{
     char mask;      /*key*/
     bool_t is_direct;    /*if set to True, then gw_ip and oif has no meaning*/
     char gw_ip[16];      /*Next hop IP*/
-    char oif[IF_NAME_SIZE]; /*OIF*/
+    interface_t *oif;    /*OIF*/
     glthread_t rt_glue;
 } l3_route_t;
 GLTHREAD_TO_STRUCT(rt_glue_to_l3_route, l3_route_t, rt_glue);
@@ -127,7 +127,7 @@ delete_rt_table_entry(rt_table_t *rt_table, char *ip_addr, char mask);
 void
 rt_table_add_route(rt_table_t *rt_table, 
                    char *dst, char mask,
-                   char *gw, char *oif);
+                   char *gw, interface_t *oif);
 
 void
 rt_table_add_direct_route(rt_table_t *rt_table,
@@ -145,6 +145,6 @@ l3rib_lookup_lpm(rt_table_t *rt_table,
     (rt1->mask == rt2->mask) &&                   \
     (rt1->is_direct == rt2->is_direct) &&         \
     (strncmp(rt1->gw_ip, rt2->gw_ip, 16) == 0) && \
-    strncmp(rt1->oif, rt2->oif, IF_NAME_SIZE) == 0)
+    rt1->oif == rt2->oif)
 
 #endif /* __LAYER3__ */
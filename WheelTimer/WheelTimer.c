@@ -36,7 +36,13 @@ init_wheel_timer(int wheel_size, int clock_tic_interval){
 	wt->clock_tic_interval = clock_tic_interval;
 	wt->wheel_size = wheel_size;
 
-    memset(&(wt->wheel_thread), 0, sizeof(wheel_timer_t));
+    memset(&(wt->wheel_thread), 0, sizeof(pthread_t));
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&wt->wheel_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
 
 	int i = 0;
 	for(; i < wheel_size; i++)
@@ -52,7 +58,9 @@ de_register_app_event(wheel_timer_elem_t *wt_elem){
      * in which slot it is ? It shall be inefficient to search in all slots of
      * wheel timer.*/
 
+    pthread_mutex_lock(&wt_elem->wt->wheel_lock);
     remove_glthread(&wt_elem->glue);
+    pthread_mutex_unlock(&wt_elem->wt->wheel_lock);
     free_wheel_timer_element(wt_elem);
 }
 
@@ -77,11 +85,10 @@ wheel_fn(void *arg){
 
 		sleep(wt->clock_tic_interval);
 
+		pthread_mutex_lock(&wt->wheel_lock);
 		slot_list = &wt->slots[wt->current_clock_tic];
 		absolute_slot_no = GET_WT_CURRENT_ABS_SLOT_NO(wt);
 		//printf("Wheel Timer Time = %d : ", absolute_slot_no * wt->clock_tic_interval);
-		if(IS_GLTHREAD_LIST_EMPTY(slot_list))
-			printf("\n");
 
          /* This is a macro to iterate over a linked list. While 
           * iterating over a linked list, even if you delete the current node
@@ -127,6 +134,7 @@ wheel_fn(void *arg){
 				}
 			}
         } ITERATE_GLTHREAD_END(slot_list, curr)
+		pthread_mutex_unlock(&wt->wheel_lock);
 	}
 	return NULL;
 }
@@ -148,7 +156,9 @@ register_app_event(wheel_timer_t *wt,
 	memcpy(wt_elem->arg, arg, arg_size);
 	wt_elem->arg_size      = arg_size;
 	wt_elem->is_recurrence = is_recursive;
+	wt_elem->wt            = wt;
     init_glthread(&wt_elem->glue);
+    pthread_mutex_lock(&wt->wheel_lock);
 	int wt_absolute_slot = GET_WT_CURRENT_ABS_SLOT_NO(wt);
 	int registration_next_abs_slot = wt_absolute_slot + (wt_elem->time_interval/wt->clock_tic_interval);
 	int cycle_no = registration_next_abs_slot / wt->wheel_size;
@@ -157,6 +167,7 @@ register_app_event(wheel_timer_t *wt,
     glthread_priority_insert(&wt->slots[slot_no], &wt_elem->glue, 
             insert_wt_elem_in_slot, 
             (unsigned int)&((wheel_timer_elem_t *)0)->glue);
+    pthread_mutex_unlock(&wt->wheel_lock);
 	return wt_elem;
 }
 
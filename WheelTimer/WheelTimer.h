@@ -14,6 +14,7 @@ struct _wheel_timer_elem_t{
 	void *arg;
 	int arg_size;
 	char is_recurrence;
+	struct _wheel_timer_t *wt;
     glthread_t glue;
 };
 GLTHREAD_TO_STRUCT(glthread_to_wt_elem, wheel_timer_elem_t, glue);
@@ -24,6 +25,10 @@ typedef struct _wheel_timer_t {
 	int wheel_size;
 	int current_cycle_no;
 	pthread_t wheel_thread;
+	/*Serializes the wheel thread, which fires the events, with the threads
+	 * (de)registering events. Recursive, events may be (de)registered from
+	 * the callbacks*/
+	pthread_mutex_t wheel_lock;
     glthread_t slots[0];
 } wheel_timer_t;
 
@@ -0,0 +1,1964 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  bench.c
+ *
+ *    Description:  This file implements the benchmarks to measure the performance of the
+ *    data path of the TCP/IP stack. This program is a separate executable and
+ *    is not part of the TCP/IP stack framework.
+ *
+ *    To compile this program, simply run Makefile of the TCP/IP Stack.
+ *    To run this program : ./bench.exe [-t <udp|unix|shm|uring>] <benchmark-name> [args]
+ *    Run ./bench.exe without arguments to list all benchmarks.
+ *
+ *        Version:  1.0
+ *        Created:  10/16/2026 10:12:41 AM
+ *       Revision:  1.0
+ *       Compiler:  gcc
+ *
+ *        This file is part of the NetworkGraph distribution (https://github.com/sachinites).
+ *        Copyright (c) 2017 Abhishek Sagar.
+ *        This program is free software: you can redistribute it and/or modify
+ *        it under the terms of the GNU General Public License as published by
+ *        the Free Software Foundation, version 3.
+ *
+ *        This program is distributed in the hope that it will be useful, but
+ *        WITHOUT ANY WARRANTY; without even the implied warranty of
+ *        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *        General Public License for more details.
+ *
+ *        You should have received a copy of the GNU General Public License
+ *        along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/resource.h> /*for getrusage*/
+#include <netdb.h> /*for struct hostent*/
+#include "tcp_public.h"
+#include "pkt_buffer.h"
+
+/*Required by the CLI module linked into this program*/
+graph_t *topo = NULL;
+
+/* Benchmark results are written here, stdout is redirected to
+ * /dev/null so that the per pkt logs of the stack do not pollute
+ * the results*/
+static FILE *bench_out;
+
+extern void
+network_start_pkt_receiver_thread(graph_t *topo);
+
+extern graph_t *
+build_dualswitch_topo();
+
+extern graph_t *
+L2_loop_topo();
+
+static double
+bench_time_now(){
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+/*CPU time (user + sys) consumed by all the threads of the process*/
+static double
+bench_cpu_time(){
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+        (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+static void
+bench_report(char *test_name, unsigned int n_pkts, double elapsed){
+
+    fprintf(bench_out, "%-40s : %10u pkts in %8.3f sec, %12.0f pps\n",
+            test_name, n_pkts, elapsed, n_pkts / elapsed);
+}
+
+/* Prepare an ethernet frame carrying an IP hdr destined to 'dst_ip'
+ * followed by 'payload_size' bytes of zeros, 'payload_size' must be a
+ * multiple of 4. Returns the size of the frame*/
+static unsigned int
+bench_prepare_ip_frame(char *buffer, interface_t *oif, char *dst_ip,
+                       unsigned int payload_size){
+
+    ethernet_hdr_t *eth_hdr = (ethernet_hdr_t *)buffer;
+    unsigned int ip_pkt_size = sizeof(ip_hdr_t) + payload_size;
+
+    memset(buffer, 0, ETH_HDR_SIZE_EXCL_PAYLOAD + ip_pkt_size);
+    layer2_fill_with_broadcast_mac(eth_hdr->dst_mac.mac);
+    memcpy(eth_hdr->src_mac.mac, IF_MAC(oif), sizeof(mac_add_t));
+    eth_hdr->type = ETH_IP;
+
+    ip_hdr_t *ip_hdr = (ip_hdr_t *)(eth_hdr->payload);
+    initialize_ip_hdr(ip_hdr);
+    ip_hdr->protocol = ICMP_PRO;
+    ip_hdr->total_length = ip_pkt_size/4;
+    ip_hdr->dst_ip = tcp_ip_covert_ip_p_to_n(dst_ip);
+    SET_COMMON_ETH_FCS(eth_hdr, ip_pkt_size, 0);
+    return ETH_HDR_SIZE_EXCL_PAYLOAD + ip_pkt_size;
+}
+
+/* Replica of the transmission path as it used to be : a new socket
+ * and a resolver call for every frame sent out*/
+static int
+bench_legacy_send_pkt_out(char *pkt, unsigned int pkt_size,
+                          interface_t *interface){
+
+    static char send_buffer[MAX_PACKET_BUFFER_SIZE];
+    struct sockaddr_in dest_addr;
+    node_t *nbr_node = get_nbr_node(interface);
+    interface_t *other_interface = &interface->link->intf1 == interface ?
+        &interface->link->intf2 : &interface->link->intf1;
+
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+    if(sock < 0)
+        return -1;
+
+    memset(send_buffer, 0, MAX_PACKET_BUFFER_SIZE);
+    strncpy(send_buffer, other_interface->if_name, IF_NAME_SIZE);
+    memcpy(send_buffer + IF_NAME_SIZE, pkt, pkt_size);
+
+    struct hostent *host = (struct hostent *) gethostbyname("127.0.0.1");
+    dest_addr.sin_family = AF_INET;
+    dest_addr.sin_port = nbr_node->udp_port_number;
+    dest_addr.sin_addr = *((struct in_addr *)host->h_addr);
+
+    int rc = sendto(sock, send_buffer, pkt_size + IF_NAME_SIZE, 0,
+            (struct sockaddr *)&dest_addr, sizeof(struct sockaddr));
+    close(sock);
+    return rc;
+}
+
+/* Benchmark : Transmission cost of send_pkt_out(). Frames are sent
+ * from node S to node D, no receiver thread is running, so that only
+ * the sending side is measured*/
+static int
+bench_tx(int argc, char **argv){
+
+    unsigned int i, n_pkts = argc > 0 ? atoi(argv[0]) : 200000;
+    char frame[MAX_PACKET_BUFFER_SIZE];
+    double start;
+
+    graph_t *graph = create_new_graph("tx bench");
+    node_t *S = create_graph_node(graph, "S");
+    node_t *D = create_graph_node(graph, "D");
+    insert_link_between_two_nodes(S, D, "eth0/1", "eth0/2", 1);
+
+    interface_t *oif = get_node_if_by_name(S, "eth0/1");
+    unsigned int frame_size = bench_prepare_ip_frame(frame, oif, "122.1.1.2", 0);
+
+    start = bench_time_now();
+    for(i = 0; i < n_pkts; i++){
+        bench_legacy_send_pkt_out(frame, frame_size, oif);
+    }
+    bench_report("tx : per frame socket (legacy)", n_pkts, bench_time_now() - start);
+
+    start = bench_time_now();
+    for(i = 0; i < n_pkts; i++){
+        send_pkt_out(frame, frame_size, oif);
+    }
+    bench_report("tx : persistent socket", n_pkts, bench_time_now() - start);
+    return 0;
+}
+
+/* Wait until the receiver thread has received 'n_pkts' pkts in
+ * total, or no progress has been made for a sec. Returns the no of
+ * pkts received*/
+static unsigned long long
+bench_wait_rx(unsigned long long n_pkts){
+
+    unsigned long long rx_pkts = 0, prev_rx_pkts = 0;
+    double last_progress = bench_time_now();
+
+    while(1){
+        rx_pkts = comm_get_rx_pkt_count();
+        if(rx_pkts >= n_pkts)
+            return rx_pkts;
+        if(rx_pkts != prev_rx_pkts){
+            prev_rx_pkts = rx_pkts;
+            last_progress = bench_time_now();
+        }
+        else if(bench_time_now() - last_progress > 1.0){
+            return rx_pkts;
+        }
+        usleep(100);
+    }
+}
+
+/* Benchmark : Receiver thread wakeup cost on a large topology. A
+ * chain of 'n-nodes' nodes is built, and in every round each node
+ * sends a frame to one of its nbrs, time is measured until all frames
+ * have been received*/
+static int
+bench_rx_scale(int argc, char **argv){
+
+    unsigned int i, n_nodes = argc > 0 ? atoi(argv[0]) : 5000;
+    unsigned int rounds = argc > 1 ? atoi(argv[1]) : 10;
+    char node_name[NODE_NAME_SIZE];
+    char frame[MAX_PACKET_BUFFER_SIZE];
+    node_t **nodes = calloc(n_nodes, sizeof(node_t *));
+    unsigned int frame_size = 0, n_pkts = 0, round;
+    unsigned long long rx_pkts;
+    double start;
+
+    graph_t *graph = create_new_graph("rx scale bench");
+
+    start = bench_time_now();
+    for(i = 0; i < n_nodes; i++){
+        snprintf(node_name, NODE_NAME_SIZE, "N%u", i);
+        nodes[i] = create_graph_node(graph, node_name);
+        if(i){
+            insert_link_between_two_nodes(nodes[i-1], nodes[i], 
+                    "eth0/1", "eth0/2", 1);
+        }
+    }
+    fprintf(bench_out, "%-40s : %u nodes in %8.3f sec\n", "rx-scale : topology build",
+            n_nodes, bench_time_now() - start);
+
+    network_start_pkt_receiver_thread(graph);
+    usleep(100000);
+
+    start = bench_time_now();
+    for(round = 0; round < rounds; round++){
+        for(i = 0; i < n_nodes; i++){
+            interface_t *intf = get_node_if_by_name(nodes[i], i ? "eth0/2" : "eth0/1");
+            if(!frame_size)
+                frame_size = bench_prepare_ip_frame(frame, intf, "122.1.1.1", 0);
+            if(send_pkt_out(frame, frame_size, intf) > 0)
+                n_pkts++;
+        }
+        /*Let receiver thread catch up, socket buffers are finite*/
+        bench_wait_rx(n_pkts);
+    }
+    rx_pkts = bench_wait_rx(n_pkts);
+    bench_report("rx-scale : frames received", rx_pkts, bench_time_now() - start);
+    if(rx_pkts < n_pkts){
+        fprintf(bench_out, "rx-scale : %llu frames lost\n", n_pkts - rx_pkts);
+    }
+    return 0;
+}
+
+/* Topology used by the forwarding scale benchmark : chains of L3
+ * routers, every router has a default route towards its right nbr
+ * in the chain. Chain is divided into segments of 'hops' hops, the
+ * first router of every segment originates the traffic destined to
+ * the loopback address of the last router of the segment, so segments
+ * forward independently of each other*/
+#define BENCH_FRAME_SIZE    ETH_MAX_FRAME_SIZE(IF_MAX_MTU)
+#define BENCH_ROUNDS_IN_FLIGHT  4
+
+typedef struct bench_flow_{
+
+    interface_t *oif;
+    unsigned int frame_size;
+    char dst_ip[16];
+    char frame[BENCH_FRAME_SIZE];
+} bench_flow_t;
+
+static void
+bench_link_ip(unsigned int link_id, unsigned int host, char *ip_addr){
+
+    snprintf(ip_addr, 16, "%u.%u.%u.%u", 10 + (link_id >> 16),
+            (link_id >> 8) & 0xFF, link_id & 0xFF, host);
+}
+
+/* All loopback addresses are of same length in dotted decimal form,
+ * route lookup compares the address strings*/
+static void
+bench_lo_ip(unsigned int node_id, char *ip_addr){
+
+    snprintf(ip_addr, 16, "122.%u.%u.%u", 100 + (node_id / 10000) % 100,
+            100 + (node_id / 100) % 100, 100 + node_id % 100);
+}
+
+/* Build a chain of routers out of 'nodes', links and loopback
+ * addresses are numbered starting from 'link_id'. Flows for every
+ * segment are appended to 'flows'. Returns the no of flows added*/
+static unsigned int
+bench_build_router_chain(node_t **nodes, unsigned int n_nodes,
+                         unsigned int link_id, unsigned int hops,
+                         bench_flow_t *flows){
+
+    unsigned int i, n_flows = 0;
+    char left_ip[16], right_ip[16], lo_ip[16];
+
+    for(i = 0; i < n_nodes; i++){
+        bench_lo_ip(link_id + i, lo_ip);
+        node_set_loopback_address(nodes[i], lo_ip);
+    }
+
+    for(i = 0; i + 1 < n_nodes; i++, link_id++){
+
+        insert_link_between_two_nodes(nodes[i], nodes[i + 1],
+                "eth0/1", "eth0/2", 1);
+        bench_link_ip(link_id, 1, left_ip);
+        bench_link_ip(link_id, 2, right_ip);
+        node_set_intf_ip_address(nodes[i], "eth0/1", left_ip, 24);
+        node_set_intf_ip_address(nodes[i + 1], "eth0/2", right_ip, 24);
+        rt_table_add_route(NODE_RT_TABLE(nodes[i]), "0.0.0.0", 0,
+                right_ip, get_node_if_by_name(nodes[i], "eth0/1"));
+
+        /*Segment starting at node i ends at node i + hops*/
+        if(i % hops == 0 && i + hops < n_nodes){
+            bench_flow_t *flow = &flows[n_flows++];
+            flow->oif = get_node_if_by_name(nodes[i], "eth0/1");
+            bench_lo_ip(link_id + hops, flow->dst_ip);
+            flow->frame_size = bench_prepare_ip_frame(flow->frame,
+                    flow->oif, flow->dst_ip, 0);
+        }
+    }
+    return n_flows;
+}
+
+/* Inject 'rounds' frames on every flow, keeping at most a few
+ * rounds in flight so that socket buffers do not overflow. Every frame
+ * is received 'hops' times before it is consumed*/
+static void
+bench_run_flows(char *test_name, bench_flow_t *flows, unsigned int n_flows,
+                unsigned int hops, unsigned int rounds){
+
+    unsigned int i, round;
+    unsigned long long base = comm_get_rx_pkt_count();
+    unsigned long long per_round = (unsigned long long)n_flows * hops;
+    unsigned long long rx_pkts;
+    double start = bench_time_now();
+    double cpu_start = bench_cpu_time();
+    unsigned long long copied_start = pkt_buffer_bytes_copied;
+
+    for(round = 0; round < rounds; round++){
+        for(i = 0; i < n_flows; i++){
+            send_pkt_out(flows[i].frame, flows[i].frame_size, flows[i].oif);
+        }
+        if(round >= BENCH_ROUNDS_IN_FLIGHT)
+            bench_wait_rx(base + (round - BENCH_ROUNDS_IN_FLIGHT + 1) * per_round);
+    }
+    rx_pkts = bench_wait_rx(base + rounds * per_round) - base;
+    bench_report(test_name, rx_pkts, bench_time_now() - start);
+    if(rx_pkts){
+        fprintf(bench_out, "%-40s : %10.0f ns cpu per pkt\n", test_name,
+                (bench_cpu_time() - cpu_start) * 1e9 / rx_pkts);
+        fprintf(bench_out, "%-40s : %10.1f bytes copied per pkt\n", test_name,
+                (double)(pkt_buffer_bytes_copied - copied_start) / rx_pkts);
+    }
+    if(rx_pkts < rounds * per_round){
+        fprintf(bench_out, "%s : %llu frames lost\n", test_name,
+                rounds * per_round - rx_pkts);
+    }
+}
+
+static unsigned int bench_rx_threads[] = {1, 2, 4, 8};
+
+/* Benchmark : Forwarding throughput (frames received per sec by all
+ * the routers) as the no of receiver threads is scaled up, on a
+ * long chain of routers and on a grid (mesh) of routers*/
+static int
+bench_scale(int argc, char **argv){
+
+    unsigned int n_nodes = argc > 0 ? atoi(argv[0]) : 4096;
+    unsigned int hops = argc > 1 ? atoi(argv[1]) : 8;
+    unsigned int rounds = argc > 2 ? atoi(argv[2]) : 100;
+    unsigned int i, r, t, n_flows = 0;
+    unsigned int n_rows = 16, n_cols = n_nodes / n_rows;
+    char node_name[NODE_NAME_SIZE];
+    char test_name[64];
+    node_t **nodes = calloc(n_nodes, sizeof(node_t *));
+    bench_flow_t *flows = calloc(n_nodes, sizeof(bench_flow_t));
+    bench_flow_t *chain_flows, *mesh_flows;
+    unsigned int n_chain_flows, n_mesh_flows;
+
+    if(hops == 0 || hops >= 64 || n_cols <= hops){
+        fprintf(bench_out, "Error : hops must be in range [1-63] and "
+                "less than n-nodes/%u\n", n_rows);
+        return -1;
+    }
+
+    graph_t *graph = create_new_graph("scale bench");
+
+    /*Chain topology made of first half of the nodes*/
+    for(i = 0; i < n_nodes / 2; i++){
+        snprintf(node_name, NODE_NAME_SIZE, "C%u", i);
+        nodes[i] = create_graph_node(graph, node_name);
+    }
+    chain_flows = flows;
+    n_chain_flows = bench_build_router_chain(nodes, n_nodes / 2, 0,
+                        hops, chain_flows);
+    n_flows += n_chain_flows;
+
+    /*Mesh topology made of the other half, rows of the grid are router
+     * chains, and routers of adjacent rows are linked as well*/
+    n_cols = (n_nodes / 2) / n_rows;
+    mesh_flows = flows + n_flows;
+    n_mesh_flows = 0;
+    for(r = 0; r < n_rows; r++){
+        node_t **row = nodes + n_nodes / 2 + r * n_cols;
+        for(i = 0; i < n_cols; i++){
+            snprintf(node_name, NODE_NAME_SIZE, "M%u-%u", r, i);
+            row[i] = create_graph_node(graph, node_name);
+            if(r){
+                insert_link_between_two_nodes((row - n_cols)[i], row[i],
+                        "eth0/3", "eth0/4", 1);
+            }
+        }
+        n_mesh_flows += bench_build_router_chain(row, n_cols,
+                n_nodes + r * n_cols, hops, mesh_flows + n_mesh_flows);
+    }
+
+    fprintf(bench_out, "scale : chain of %u routers, %u x %u mesh, "
+            "%u hops per flow, %u + %u flows\n", n_nodes / 2, n_rows, n_cols,
+            hops, n_chain_flows, n_mesh_flows);
+
+    for(t = 0; t < sizeof(bench_rx_threads)/sizeof(bench_rx_threads[0]); t++){
+
+        comm_set_rx_threads(bench_rx_threads[t]);
+        if(t == 0){
+            network_start_pkt_receiver_thread(graph);
+            /*Warm up : let ARP resolution complete on all flows*/
+            for(i = 0; i < n_flows; i++){
+                send_pkt_out(flows[i].frame, flows[i].frame_size, flows[i].oif);
+            }
+            bench_wait_rx(~0ULL);
+        }
+
+        snprintf(test_name, sizeof(test_name), "scale : chain, %u rx threads",
+                bench_rx_threads[t]);
+        bench_run_flows(test_name, chain_flows, n_chain_flows, hops, rounds);
+        snprintf(test_name, sizeof(test_name), "scale : mesh, %u rx threads",
+                bench_rx_threads[t]);
+        bench_run_flows(test_name, mesh_flows, n_mesh_flows, hops, rounds);
+    }
+    return 0;
+}
+
+static char *bench_transport_names[] = {"udp", "unix", "shm", "uring", NULL};
+
+/* Loss, reordering and one-way latency of the frames received over
+ * the links of the topology, from the wire hdrs of the udp transports*/
+static void
+bench_report_links(char *test_name, graph_t *graph){
+
+    node_t *node;
+    glthread_t *curr;
+    unsigned int i;
+    intf_wire_stats_t *stats;
+    unsigned long long n_rx = 0, n_lost = 0, n_reordered = 0, latency_sum = 0;
+
+    ITERATE_GLTHREAD_BEGIN(&graph->node_list, curr){
+
+        node = graph_glue_to_node(curr);
+        for(i = 0; i < node->n_intf; i++){
+            if(!node->intf[i]) break;
+            stats = &node->intf[i]->wire_stats;
+            n_rx += stats->n_rx;
+            n_lost += stats->n_rx_lost;
+            n_reordered += stats->n_rx_reordered;
+            latency_sum += stats->latency_sum_ns;
+        }
+    } ITERATE_GLTHREAD_END(&graph->node_list, curr);
+
+    if(!n_rx)
+        return;
+
+    fprintf(bench_out, "%-40s : %10llu ns one-way latency, %llu lost, %llu reordered\n",
+            test_name, latency_sum / n_rx, n_lost, n_reordered);
+}
+
+/* Benchmark : Forwarding throughput of the same router chain built
+ * with every transport, one topology at a time*/
+static int
+bench_transports(int argc, char **argv){
+
+    unsigned int n_nodes = argc > 0 ? atoi(argv[0]) : 1024;
+    unsigned int hops = argc > 1 ? atoi(argv[1]) : 8;
+    unsigned int rounds = argc > 2 ? atoi(argv[2]) : 100;
+    unsigned int i, t, n_flows;
+    char node_name[NODE_NAME_SIZE];
+    char test_name[64];
+    node_t **nodes = calloc(n_nodes, sizeof(node_t *));
+    bench_flow_t *flows = calloc(n_nodes, sizeof(bench_flow_t));
+
+    if(hops == 0 || hops >= 64 || n_nodes <= hops){
+        fprintf(bench_out, "Error : hops must be in range [1-63] and "
+                "less than n-nodes\n");
+        return -1;
+    }
+
+    for(t = 0; bench_transport_names[t]; t++){
+
+        graph_t *graph = create_new_graph(bench_transport_names[t]);
+        if(comm_set_graph_transport(graph, bench_transport_names[t]) < 0)
+            return -1;
+
+        for(i = 0; i < n_nodes; i++){
+            snprintf(node_name, NODE_NAME_SIZE, "R%u", i);
+            nodes[i] = create_graph_node(graph, node_name);
+        }
+        n_flows = bench_build_router_chain(nodes, n_nodes, 0, hops, flows);
+
+        network_start_pkt_receiver_thread(graph);
+        /*Warm up : let ARP resolution complete on all flows*/
+        for(i = 0; i < n_flows; i++){
+            send_pkt_out(flows[i].frame, flows[i].frame_size, flows[i].oif);
+        }
+        bench_wait_rx(~0ULL);
+
+        snprintf(test_name, sizeof(test_name), "transports : %s, chain of %u",
+                bench_transport_names[t], n_nodes);
+        bench_run_flows(test_name, flows, n_flows, hops, rounds);
+        bench_report_links(test_name, graph);
+        comm_close_graph(graph);
+    }
+    return 0;
+}
+
+/* Benchmark : Topology build time. A chain of 'n-nodes' routers is
+ * built the way topology builders and CLI config do it : both ends of
+ * every link and every node configured are looked up by name*/
+static int
+bench_build(int argc, char **argv){
+
+    unsigned int n_nodes = argc > 0 ? atoi(argv[0]) : 10000;
+    unsigned int i, n_misses = 0;
+    char node_name[NODE_NAME_SIZE];
+    char nbr_name[NODE_NAME_SIZE];
+    char ip_addr[16];
+    char test_name[64];
+    node_t *node;
+    double start, elapsed;
+
+    if(n_nodes < 2){
+        fprintf(bench_out, "Error : n-nodes must be at least 2\n");
+        return -1;
+    }
+
+    start = bench_time_now();
+
+    graph_t *graph = create_new_graph("build bench");
+    for(i = 0; i < n_nodes; i++){
+        snprintf(node_name, NODE_NAME_SIZE, "R%u", i);
+        create_graph_node(graph, node_name);
+    }
+
+    for(i = 0; i + 1 < n_nodes; i++){
+        snprintf(node_name, NODE_NAME_SIZE, "R%u", i);
+        snprintf(nbr_name, NODE_NAME_SIZE, "R%u", i + 1);
+        insert_link_between_two_nodes(get_node_by_node_name(graph, node_name),
+                get_node_by_node_name(graph, nbr_name), "eth0/1", "eth0/2", 1);
+    }
+
+    for(i = 0; i < n_nodes; i++){
+        snprintf(node_name, NODE_NAME_SIZE, "R%u", i);
+        bench_lo_ip(i, ip_addr);
+        node_set_loopback_address(get_node_by_node_name(graph, node_name), ip_addr);
+    }
+
+    elapsed = bench_time_now() - start;
+    snprintf(test_name, sizeof(test_name), "build : chain of %u nodes", n_nodes);
+    fprintf(bench_out, "%-40s : %10.3f sec\n", test_name, elapsed);
+
+    /*Every node must be found under its own name, R1 must not be
+     * taken for R10*/
+    start = bench_time_now();
+    for(i = 0; i < n_nodes; i++){
+        snprintf(node_name, NODE_NAME_SIZE, "R%u", i);
+        node = get_node_by_node_name(graph, node_name);
+        if(!node || strncmp(node->node_name, node_name, NODE_NAME_SIZE))
+            n_misses++;
+    }
+    elapsed = bench_time_now() - start;
+    fprintf(bench_out, "%-40s : %10.0f ns per lookup, %u wrong nodes\n",
+            test_name, elapsed * 1e9 / n_nodes, n_misses);
+
+    comm_close_graph(graph);
+    return 0;
+}
+
+/* Benchmark : Unicast switching on a single L2 switch with one host
+ * on each of its access ports in VLAN 10. Every host sends to the host across
+ * the switch, whose MAC the switch has learnt, every frame is received
+ * by the switch and by the destination host*/
+#define BENCH_PORTS_RX_PER_FRAME    2
+
+static int
+bench_ports(int argc, char **argv){
+
+    unsigned int n_ports = argc > 0 ? atoi(argv[0]) : 128;
+    unsigned int rounds = argc > 1 ? atoi(argv[1]) : 200;
+    unsigned int i;
+    char node_name[NODE_NAME_SIZE];
+    char if_name[IF_NAME_SIZE];
+    char ip_addr[16];
+    char test_name[64];
+    node_t **hosts = calloc(n_ports, sizeof(node_t *));
+    bench_flow_t *flows = calloc(n_ports, sizeof(bench_flow_t));
+    ethernet_hdr_t *eth_hdr;
+
+    if(n_ports < 2 || n_ports > 250){
+        fprintf(bench_out, "Error : n-ports must be in range [2-250]\n");
+        return -1;
+    }
+
+    graph_t *graph = create_new_graph("ports bench");
+    node_t *sw = create_graph_node(graph, "SW");
+
+    for(i = 0; i < n_ports; i++){
+        snprintf(node_name, NODE_NAME_SIZE, "H%u", i);
+        snprintf(if_name, IF_NAME_SIZE, "eth%u", i);
+        snprintf(ip_addr, sizeof(ip_addr), "10.1.1.%u", i + 1);
+        hosts[i] = create_graph_node(graph, node_name);
+        insert_link_between_two_nodes(hosts[i], sw, "eth0/0", if_name, 1);
+        node_set_intf_ip_address(hosts[i], "eth0/0", ip_addr, 24);
+        node_set_intf_l2_mode(sw, if_name, ACCESS);
+        node_set_intf_vlan_membsership(sw, if_name, 10);
+        flows[i].oif = get_node_if_by_name(hosts[i], "eth0/0");
+    }
+
+    network_start_pkt_receiver_thread(graph);
+
+    /*Warm up : one broadcast from every host, the switch learns the
+     * MACs of all the hosts*/
+    for(i = 0; i < n_ports; i++){
+        flows[i].frame_size = bench_prepare_ip_frame(flows[i].frame,
+                flows[i].oif, "10.1.2.1", 0);
+        send_pkt_out(flows[i].frame, flows[i].frame_size, flows[i].oif);
+    }
+    bench_wait_rx(~0ULL);
+
+    for(i = 0; i < n_ports; i++){
+        eth_hdr = (ethernet_hdr_t *)flows[i].frame;
+        memcpy(eth_hdr->dst_mac.mac,
+                IF_MAC(flows[(i + n_ports / 2) % n_ports].oif),
+                sizeof(mac_add_t));
+    }
+
+    snprintf(test_name, sizeof(test_name), "ports : switch with %u ports",
+            sw->n_intf);
+    bench_run_flows(test_name, flows, n_ports, BENCH_PORTS_RX_PER_FRAME, rounds);
+    comm_close_graph(graph);
+    return 0;
+}
+
+/* Benchmark : Flooding on a single L2 switch with 'n-ports' hosts on
+ * its access ports, spread over 'n-vlans' vlans. Every host broadcasts,
+ * every frame is received by the switch and by the other hosts in the
+ * vlan of the sender*/
+static int
+bench_vlan_flood(int argc, char **argv){
+
+    unsigned int n_ports = argc > 0 ? atoi(argv[0]) : 240;
+    unsigned int n_vlans = argc > 1 ? atoi(argv[1]) : 24;
+    unsigned int rounds = argc > 2 ? atoi(argv[2]) : 200;
+    unsigned int i;
+    char node_name[NODE_NAME_SIZE];
+    char if_name[IF_NAME_SIZE];
+    char test_name[64];
+    node_t *host;
+    bench_flow_t *flows;
+
+    if(n_ports < 2 || n_ports > 250 ||
+        n_vlans < 1 || n_ports % n_vlans){
+        fprintf(bench_out, "Error : n-ports must be in range [2-250], "
+                "and a multiple of n-vlans\n");
+        return -1;
+    }
+
+    flows = calloc(n_ports, sizeof(bench_flow_t));
+    graph_t *graph = create_new_graph("vlan flood bench");
+    node_t *sw = create_graph_node(graph, "SW");
+
+    for(i = 0; i < n_ports; i++){
+        snprintf(node_name, NODE_NAME_SIZE, "H%u", i);
+        snprintf(if_name, IF_NAME_SIZE, "eth%u", i);
+        host = create_graph_node(graph, node_name);
+        insert_link_between_two_nodes(host, sw, "eth0/0", if_name, 1);
+        node_set_intf_ip_address(host, "eth0/0", "10.1.1.1", 24);
+        node_set_intf_l2_mode(sw, if_name, ACCESS);
+        node_set_intf_vlan_membsership(sw, if_name, i % n_vlans + 1);
+        flows[i].oif = get_node_if_by_name(host, "eth0/0");
+        flows[i].frame_size = bench_prepare_ip_frame(flows[i].frame,
+                flows[i].oif, "10.1.2.1", 0);
+    }
+
+    network_start_pkt_receiver_thread(graph);
+
+    snprintf(test_name, sizeof(test_name), "vlan-flood : %u ports, %u vlans",
+            n_ports, n_vlans);
+    bench_run_flows(test_name, flows, n_ports, n_ports / n_vlans, rounds);
+    comm_close_graph(graph);
+    free(flows);
+    return 0;
+}
+
+/* Benchmark : MAC table alone, no frames. 'n-macs' MACs spread over
+ * 16 VLANs are learned, learned again (refresh in place, as every
+ * frame from a known host does), looked up and deleted*/
+#define BENCH_MAC_TABLE_N_PORTS 48
+
+static void
+bench_mac(unsigned int i, char *mac){
+
+    memset(mac, 0, sizeof(mac_add_t));
+    mac[0] = 0x02;  /*Locally administered*/
+    memcpy(mac + 2, &i, sizeof(i));
+}
+
+static int
+bench_mac_table(int argc, char **argv){
+
+    unsigned int n_macs = argc > 0 ? atoi(argv[0]) : 1000000;
+    unsigned int i, n_misses = 0;
+    char mac[sizeof(mac_add_t)];
+    char test_name[64];
+    double start, elapsed;
+    mac_table_t *mac_table;
+    mac_table_entry_t *mac_table_entry;
+    interface_t *ports = calloc(BENCH_MAC_TABLE_N_PORTS, sizeof(interface_t));
+
+    init_mac_table(&mac_table);
+
+    snprintf(test_name, sizeof(test_name), "mac-table : learn %u MACs", n_macs);
+    start = bench_time_now();
+    for(i = 0; i < n_macs; i++){
+        bench_mac(i, mac);
+        mac_table_learn(mac_table, mac, i % 16 + 1,
+                &ports[i % BENCH_MAC_TABLE_N_PORTS]);
+    }
+    elapsed = bench_time_now() - start;
+    fprintf(bench_out, "%-40s : %10.0f ns per MAC, %u slots\n",
+            test_name, elapsed * 1e9 / n_macs, mac_table->size);
+
+    snprintf(test_name, sizeof(test_name), "mac-table : refresh %u MACs", n_macs);
+    start = bench_time_now();
+    for(i = 0; i < n_macs; i++){
+        bench_mac(i, mac);
+        mac_table_learn(mac_table, mac, i % 16 + 1,
+                &ports[(i + 1) % BENCH_MAC_TABLE_N_PORTS]);
+    }
+    elapsed = bench_time_now() - start;
+    fprintf(bench_out, "%-40s : %10.0f ns per MAC\n",
+            test_name, elapsed * 1e9 / n_macs);
+
+    snprintf(test_name, sizeof(test_name), "mac-table : lookup %u MACs", n_macs);
+    start = bench_time_now();
+    for(i = 0; i < n_macs; i++){
+        bench_mac(i, mac);
+        mac_table_entry = mac_table_lookup(mac_table, mac, i % 16 + 1);
+        if(!mac_table_entry ||
+            mac_table_entry->oif != &ports[(i + 1) % BENCH_MAC_TABLE_N_PORTS])
+            n_misses++;
+        /*Same MAC in another VLAN is another host*/
+        if(mac_table_lookup(mac_table, mac, i % 16 + 17))
+            n_misses++;
+    }
+    elapsed = bench_time_now() - start;
+    fprintf(bench_out, "%-40s : %10.0f ns per lookup, %u wrong entries\n",
+            test_name, elapsed * 1e9 / (2.0 * n_macs), n_misses);
+
+    snprintf(test_name, sizeof(test_name), "mac-table : delete %u MACs", n_macs);
+    start = bench_time_now();
+    for(i = 0; i < n_macs; i += 2){
+        bench_mac(i, mac);
+        delete_mac_table_entry(mac_table, mac, i % 16 + 1);
+    }
+    elapsed = bench_time_now() - start;
+
+    /*Odd MACs must survive the deletion of their even nbrs*/
+    for(i = 0, n_misses = 0; i < n_macs; i++){
+        bench_mac(i, mac);
+        if(!mac_table_lookup(mac_table, mac, i % 16 + 1) != !(i & 1))
+            n_misses++;
+    }
+    fprintf(bench_out, "%-40s : %10.0f ns per MAC, %u wrong entries\n",
+            test_name, elapsed * 1e9 / ((n_macs + 1) / 2), n_misses);
+
+    clear_mac_table(mac_table);
+    free(mac_table->entries);
+    free(mac_table);
+    free(ports);
+    return 0;
+}
+
+/* Benchmark : MAC aging. 'n-macs' MACs are learned, then the ticks of
+ * the aging timer are driven back to back until all the MACs age out.
+ * Reports the cost of a tick and when the MACs were aged*/
+static int
+bench_mac_aging(int argc, char **argv){
+
+    unsigned int n_macs = argc > 0 ? atoi(argv[0]) : 1000000;
+    unsigned int aging_time = argc > 1 ? atoi(argv[1]) : MAC_TABLE_DEF_AGING_TIME;
+    unsigned int i, n_ticks = 0, first_aged_at = 0;
+    char mac[sizeof(mac_add_t)];
+    char test_name[64];
+    double start, elapsed, total = 0, max = 0;
+    mac_table_t *mac_table;
+    interface_t *ports = calloc(BENCH_MAC_TABLE_N_PORTS, sizeof(interface_t));
+
+    if(!aging_time){
+        fprintf(bench_out, "Error : aging-time must not be 0\n");
+        return -1;
+    }
+
+    init_mac_table(&mac_table);
+    mac_table_set_aging_time(mac_table, aging_time);
+
+    for(i = 0; i < n_macs; i++){
+        bench_mac(i, mac);
+        mac_table_learn(mac_table, mac, i % 16 + 1,
+                &ports[i % BENCH_MAC_TABLE_N_PORTS]);
+    }
+
+    while(mac_table->n_entries && n_ticks < 4 * aging_time){
+
+        start = bench_time_now();
+        mac_table_age_out(mac_table);
+        elapsed = bench_time_now() - start;
+
+        n_ticks++;
+        total += elapsed;
+        if(elapsed > max)
+            max = elapsed;
+        if(!first_aged_at && mac_table->n_aged)
+            first_aged_at = mac_table->now;
+    }
+
+    snprintf(test_name, sizeof(test_name), "mac-aging : %u MACs, aging %u sec",
+            n_macs, aging_time);
+    fprintf(bench_out, "%-40s : %10.1f usec per tick (max %.1f), %u slots\n",
+            test_name, total * 1e6 / n_ticks, max * 1e6, mac_table->size);
+    fprintf(bench_out, "%-40s : first aged at %u sec, all %llu aged at %u sec\n",
+            test_name, first_aged_at, mac_table->n_aged, mac_table->now);
+
+    free(mac_table->entries);
+    free(mac_table);
+    free(ports);
+    return 0;
+}
+
+/* Benchmark : ARP table alone, no frames. 'n-entries' next hops of
+ * 10.0.0.0/8 are added, then looked up the way IP forwarding looks up
+ * the next hop, with the binary IP address*/
+static int
+bench_arp_table(int argc, char **argv){
+
+    unsigned int n_entries = argc > 0 ? atoi(argv[0]) : 100000;
+    unsigned int i, n_misses = 0;
+    uint32_t ip_addr;
+    char test_name[64];
+    double start, elapsed;
+    arp_table_t *arp_table;
+    arp_entry_t *arp_entry;
+
+    init_arp_table(&arp_table);
+
+    snprintf(test_name, sizeof(test_name), "arp-table : add %u entries", n_entries);
+    start = bench_time_now();
+    for(i = 0; i < n_entries; i++)
+        create_arp_sane_entry(arp_table, (10 << 24) + i);
+    elapsed = bench_time_now() - start;
+    fprintf(bench_out, "%-40s : %10.0f ns per entry, %u buckets\n",
+            test_name, elapsed * 1e9 / n_entries, arp_table->size);
+
+    snprintf(test_name, sizeof(test_name), "arp-table : lookup %u entries", n_entries);
+    start = bench_time_now();
+    for(i = 0; i < n_entries; i++){
+        /*Stride over the table, as next hops of successive pkts do*/
+        ip_addr = (10 << 24) + (i * 7919) % n_entries;
+        arp_entry = arp_table_lookup(arp_table, ip_addr);
+        if(!arp_entry || arp_entry->ip_addr != ip_addr)
+            n_misses++;
+        if(arp_table_lookup(arp_table, (11 << 24) + i))
+            n_misses++;
+    }
+    elapsed = bench_time_now() - start;
+    fprintf(bench_out, "%-40s : %10.0f ns per lookup, %u wrong entries\n",
+            test_name, elapsed * 1e9 / (2.0 * n_entries), n_misses);
+
+    snprintf(test_name, sizeof(test_name), "arp-table : delete %u entries", n_entries);
+    start = bench_time_now();
+    for(i = 0; i < n_entries; i++)
+        delete_arp_table_entry(arp_table, (10 << 24) + i);
+    elapsed = bench_time_now() - start;
+    fprintf(bench_out, "%-40s : %10.0f ns per entry, %u left\n",
+            test_name, elapsed * 1e9 / n_entries, arp_table->n_entries);
+
+    free(arp_table->buckets);
+    free(arp_table);
+    return 0;
+}
+
+/* Replica of the trunk vlan membership test as it used to be : a
+ * linear search of the vlans the interface is a member of*/
+static bool_t
+bench_legacy_trunk_vlan_enabled(unsigned int *vlans, unsigned int n_vlans,
+                                unsigned int vlan_id){
+
+    unsigned int i = 0;
+
+    for( ; i < n_vlans; i++){
+        if(vlans[i] == vlan_id)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/* Benchmark : Switching over trunks carrying many vlans. H1 and H2 are
+ * on access ports in the highest vlan of L2SW1 and L2SW2, which are
+ * connected by a trunk. Every frame is received by both switches and
+ * by the destination host. Forwarding is measured with trunks carrying
+ * 1 vlan and 'n-vlans' vlans, then the membership test alone against
+ * the linear search it replaces*/
+#define BENCH_VLANS_RX_PER_FRAME    3
+
+static void
+bench_vlans_config_trunks(graph_t *graph, unsigned int n_vlans){
+
+    unsigned int vlan_id;
+    node_t *sw1 = get_node_by_node_name(graph, "L2SW1");
+    node_t *sw2 = get_node_by_node_name(graph, "L2SW2");
+
+    /*trunk to access and back clears the vlans of the trunk*/
+    node_set_intf_l2_mode(sw1, "eth0/2", ACCESS);
+    node_set_intf_l2_mode(sw2, "eth0/2", ACCESS);
+    node_set_intf_l2_mode(sw1, "eth0/2", TRUNK);
+    node_set_intf_l2_mode(sw2, "eth0/2", TRUNK);
+
+    for(vlan_id = VLAN_ID_MAX - n_vlans + 1; vlan_id <= VLAN_ID_MAX; vlan_id++){
+        node_set_intf_vlan_membsership(sw1, "eth0/2", vlan_id);
+        node_set_intf_vlan_membsership(sw2, "eth0/2", vlan_id);
+    }
+}
+
+static int
+bench_vlans(int argc, char **argv){
+
+    unsigned int n_vlans = argc > 0 ? atoi(argv[0]) : 1000;
+    unsigned int rounds = argc > 1 ? atoi(argv[1]) : 20000;
+    unsigned int i, vlan_id, n_tests = 0, n_members = 0, n_legacy_members = 0;
+    unsigned int *vlans;
+    char test_name[64];
+    bench_flow_t flows[2];
+    double start, elapsed;
+
+    if(n_vlans < 1 || n_vlans > VLAN_ID_MAX){
+        fprintf(bench_out, "Error : n-vlans must be in range [1-%u]\n", VLAN_ID_MAX);
+        return -1;
+    }
+
+    graph_t *graph = create_new_graph("vlans bench");
+    node_t *H1 = create_graph_node(graph, "H1");
+    node_t *H2 = create_graph_node(graph, "H2");
+    node_t *sw1 = create_graph_node(graph, "L2SW1");
+    node_t *sw2 = create_graph_node(graph, "L2SW2");
+
+    insert_link_between_two_nodes(H1, sw1, "eth0/0", "eth0/1", 1);
+    insert_link_between_two_nodes(sw1, sw2, "eth0/2", "eth0/2", 1);
+    insert_link_between_two_nodes(H2, sw2, "eth0/0", "eth0/1", 1);
+    node_set_intf_ip_address(H1, "eth0/0", "10.1.1.1", 24);
+    node_set_intf_ip_address(H2, "eth0/0", "10.1.1.2", 24);
+    node_set_intf_l2_mode(sw1, "eth0/1", ACCESS);
+    node_set_intf_l2_mode(sw2, "eth0/1", ACCESS);
+    node_set_intf_vlan_membsership(sw1, "eth0/1", VLAN_ID_MAX);
+    node_set_intf_vlan_membsership(sw2, "eth0/1", VLAN_ID_MAX);
+    bench_vlans_config_trunks(graph, 1);
+
+    flows[0].oif = get_node_if_by_name(H1, "eth0/0");
+    flows[1].oif = get_node_if_by_name(H2, "eth0/0");
+
+    network_start_pkt_receiver_thread(graph);
+
+    /*Warm up : one broadcast from each host, the switches learn the
+     * MACs of both hosts*/
+    for(i = 0; i < 2; i++){
+        flows[i].frame_size = bench_prepare_ip_frame(flows[i].frame,
+                flows[i].oif, "10.1.2.1", 0);
+        send_pkt_out(flows[i].frame, flows[i].frame_size, flows[i].oif);
+    }
+    bench_wait_rx(~0ULL);
+
+    for(i = 0; i < 2; i++){
+        memcpy(((ethernet_hdr_t *)flows[i].frame)->dst_mac.mac,
+                IF_MAC(flows[1 - i].oif), sizeof(mac_add_t));
+    }
+
+    bench_run_flows("vlans : trunks carrying 1 vlan", flows, 2,
+            BENCH_VLANS_RX_PER_FRAME, rounds);
+
+    bench_vlans_config_trunks(graph, n_vlans);
+    snprintf(test_name, sizeof(test_name), "vlans : trunks carrying %u vlans", n_vlans);
+    bench_run_flows(test_name, flows, 2, BENCH_VLANS_RX_PER_FRAME, rounds);
+
+    /*Membership test alone, every vlan id is tested*/
+    interface_t *trunk = get_node_if_by_name(sw1, "eth0/2");
+    vlans = calloc(n_vlans, sizeof(unsigned int));
+    for(i = 0; i < n_vlans; i++)
+        vlans[i] = VLAN_ID_MAX - n_vlans + 1 + i;
+
+    snprintf(test_name, sizeof(test_name), "vlans : linear search, %u vlans", n_vlans);
+    start = bench_time_now();
+    for(i = 0; i < 100; i++){
+        for(vlan_id = VLAN_ID_MIN; vlan_id <= VLAN_ID_MAX; vlan_id++){
+            n_legacy_members += bench_legacy_trunk_vlan_enabled(vlans, n_vlans, vlan_id);
+        }
+    }
+    elapsed = bench_time_now() - start;
+    fprintf(bench_out, "%-40s : %10.1f ns per test\n",
+            test_name, elapsed * 1e9 / (100.0 * VLAN_ID_MAX));
+
+    snprintf(test_name, sizeof(test_name), "vlans : bitmap, %u vlans", n_vlans);
+    start = bench_time_now();
+    for(i = 0; i < 100; i++){
+        for(vlan_id = VLAN_ID_MIN; vlan_id <= VLAN_ID_MAX; vlan_id++, n_tests++){
+            n_members += is_trunk_interface_vlan_enabled(trunk, vlan_id);
+        }
+    }
+    elapsed = bench_time_now() - start;
+    fprintf(bench_out, "%-40s : %10.1f ns per test, %u vlans enabled, %u expected\n",
+            test_name, elapsed * 1e9 / n_tests, n_members / 100,
+            n_legacy_members / 100);
+
+    free(vlans);
+    comm_close_graph(graph);
+    return 0;
+}
+
+/* Benchmark : Spanning tree on the looped L2 topology, 4 switches in a
+ * ring with H1 on L2SW1 and H6 on L2SW2. Control plane convergence is
+ * the time until every root and designated port of every switch
+ * forwards : at start, after L2SW1 is made the root, and after the
+ * link L2SW1-L2SW2 is shut and brought back. Data plane convergence
+ * is the time until H1 resolves the ARP of H6 again, requests are sent
+ * every ms. Frames one ARP resolution costs must stay finite with the
+ * loop blocked*/
+#define BENCH_STP_TIMEOUT   60  /*sec*/
+
+/*Switches agree on the root, and their ports are done moving*/
+static bool_t
+bench_stp_converged(graph_t *graph){
+
+    node_t *node;
+    glthread_t *curr;
+    uint64_t root_id = 0;
+
+    ITERATE_GLTHREAD_BEGIN(&graph->node_list, curr){
+
+        node = graph_glue_to_node(curr);
+        if(!NODE_STP_BRIDGE(node))
+            continue;
+        if(!stp_bridge_converged(node))
+            return FALSE;
+        if(root_id && NODE_STP_BRIDGE(node)->root_prio.root_id != root_id)
+            return FALSE;
+        root_id = NODE_STP_BRIDGE(node)->root_prio.root_id;
+    } ITERATE_GLTHREAD_END(&graph->node_list, curr);
+    return TRUE;
+}
+
+/* Wait until no frame has been received for 50 ms, BPDUs keep
+ * bench_wait_rx() from ever seeing a sec without progress*/
+static unsigned long long
+bench_stp_wait_quiet(){
+
+    unsigned long long rx_pkts, prev_rx_pkts = comm_get_rx_pkt_count();
+    double last_progress = bench_time_now();
+
+    while(bench_time_now() - last_progress < 0.05){
+        usleep(1000);
+        rx_pkts = comm_get_rx_pkt_count();
+        if(rx_pkts != prev_rx_pkts){
+            prev_rx_pkts = rx_pkts;
+            last_progress = bench_time_now();
+        }
+    }
+    return prev_rx_pkts;
+}
+
+static double
+bench_stp_wait_converged(graph_t *graph, double start){
+
+    while(!bench_stp_converged(graph) &&
+          bench_time_now() - start < BENCH_STP_TIMEOUT)
+        usleep(100);
+    return bench_time_now() - start;
+}
+
+/*BPDUs sent so far by all the switches*/
+static unsigned long long
+bench_stp_bpdus(graph_t *graph){
+
+    unsigned int i;
+    unsigned long long n_bpdus = 0;
+    node_t *node;
+    glthread_t *curr;
+
+    ITERATE_GLTHREAD_BEGIN(&graph->node_list, curr){
+
+        node = graph_glue_to_node(curr);
+        for(i = 0; i < node->n_intf; i++){
+            if(IF_STP_PORT(node->intf[i]))
+                n_bpdus += IF_STP_PORT(node->intf[i])->n_bpdu_tx;
+        }
+    } ITERATE_GLTHREAD_END(&graph->node_list, curr);
+    return n_bpdus;
+}
+
+static bool_t
+bench_stp_arp_resolved(node_t *node, uint32_t ip_addr){
+
+    bool_t resolved;
+    arp_entry_t *arp_entry;
+    arp_table_t *arp_table = NODE_ARP_TABLE(node);
+
+    pthread_mutex_lock(&arp_table->lock);
+    arp_entry = arp_table_lookup(arp_table, ip_addr);
+    resolved = arp_entry && arp_entry->state == ARP_ENTRY_REACHABLE;
+    pthread_mutex_unlock(&arp_table->lock);
+    return resolved;
+}
+
+/*Time from 'start' until H1 resolves the ARP of H6*/
+static double
+bench_stp_wait_arp(node_t *H1, interface_t *oif, double start){
+
+    uint32_t ip_addr = (10 << 24) | (1 << 16) | (1 << 8) | 6;
+
+    delete_arp_table_entry(NODE_ARP_TABLE(H1), ip_addr);
+    while(!bench_stp_arp_resolved(H1, ip_addr) &&
+          bench_time_now() - start < BENCH_STP_TIMEOUT){
+        send_arp_broadcast_request(H1, oif, "10.1.1.6");
+        usleep(1000);
+    }
+    return bench_time_now() - start;
+}
+
+static void
+bench_stp_report(char *test_name, double control_plane, double data_plane){
+
+    fprintf(bench_out, "%-40s : %10.3f ms control plane, %10.3f ms data plane\n",
+            test_name, control_plane * 1e3, data_plane * 1e3);
+}
+
+static int
+bench_stp(int argc, char **argv){
+
+    unsigned long long rx_start, bpdus_start, rx_pkts;
+    double start, control_plane, data_plane;
+    uint32_t ip_addr = (10 << 24) | (1 << 16) | (1 << 8) | 6;
+
+    start = bench_time_now();
+    graph_t *graph = L2_loop_topo();
+    node_t *H1 = get_node_by_node_name(graph, "H1");
+    node_t *sw1 = get_node_by_node_name(graph, "L2SW1");
+    interface_t *oif = get_node_if_by_name(H1, "eth0/1");
+    interface_t *sw1_sw2 = get_node_if_by_name(sw1, "eth0/5");
+
+    control_plane = bench_stp_wait_converged(graph, start);
+    data_plane = bench_stp_wait_arp(H1, oif, start);
+    bench_stp_report("stp : initial convergence", control_plane, data_plane);
+
+    start = bench_time_now();
+    stp_set_bridge_priority(sw1, 4096);
+    control_plane = bench_stp_wait_converged(graph, start);
+    data_plane = bench_stp_wait_arp(H1, oif, start);
+    bench_stp_report("stp : L2SW1 made root", control_plane, data_plane);
+
+    /*One ARP resolution, broadcast request and unicast reply*/
+    bench_stp_wait_quiet();
+    delete_arp_table_entry(NODE_ARP_TABLE(H1), ip_addr);
+    rx_start = comm_get_rx_pkt_count();
+    bpdus_start = bench_stp_bpdus(graph);
+    send_arp_broadcast_request(H1, oif, "10.1.1.6");
+    rx_pkts = bench_stp_wait_quiet() - rx_start -
+              (bench_stp_bpdus(graph) - bpdus_start);
+    fprintf(bench_out, "%-40s : %10llu frames received, ARP %sresolved\n",
+            "stp : one ARP resolution, loop blocked", rx_pkts,
+            bench_stp_arp_resolved(H1, ip_addr) ? "" : "not ");
+
+    start = bench_time_now();
+    interface_set_admin_state(sw1_sw2, FALSE);
+    control_plane = bench_stp_wait_converged(graph, start);
+    data_plane = bench_stp_wait_arp(H1, oif, start);
+    bench_stp_report("stp : link L2SW1-L2SW2 shut", control_plane, data_plane);
+
+    start = bench_time_now();
+    interface_set_admin_state(sw1_sw2, TRUE);
+    control_plane = bench_stp_wait_converged(graph, start);
+    data_plane = bench_stp_wait_arp(H1, oif, start);
+    bench_stp_report("stp : link L2SW1-L2SW2 restored", control_plane, data_plane);
+
+    comm_close_graph(graph);
+    return 0;
+}
+
+/* Benchmark : Broadcast flooding. On the dual switch topology H1
+ * broadcasts IP frames nobody routes, L2SW1 floods them out of its
+ * access port in VLAN 10 and its trunk, L2SW2 out of its access ports
+ * in VLAN 10. Every frame is received by L2SW1, H2, L2SW2, H5 and H6.
+ * On the looped topology H1 broadcasts the same IP frames, then ARP
+ * requests for an IP nobody owns, once spanning tree blocked the loop :
+ * every frame is received by the 4 switches, H6, and the switch at the
+ * blocked end of the link the tree does not use, which drops it. Without
+ * the tree these frames would circulate the loop for ever*/
+#define BENCH_FLOOD_RX_PER_FRAME        5
+#define BENCH_FLOOD_LOOP_RX_PER_FRAME   6
+
+static int
+bench_flood(int argc, char **argv){
+
+    unsigned int rounds = argc > 0 ? atoi(argv[0]) : 20000;
+    unsigned int payload_size = argc > 1 ? atoi(argv[1]) : 200;
+    char test_name[64];
+    bench_flow_t flow;
+    ethernet_hdr_t *eth_hdr;
+    arp_hdr_t *arp_hdr;
+
+    payload_size &= ~3;
+    if(ETH_HDR_SIZE_EXCL_PAYLOAD + sizeof(ip_hdr_t) + payload_size >
+            BENCH_FRAME_SIZE){
+        fprintf(bench_out, "Error : payload size must be less than %u\n",
+                (unsigned int)(BENCH_FRAME_SIZE - ETH_HDR_SIZE_EXCL_PAYLOAD -
+                    sizeof(ip_hdr_t)));
+        return -1;
+    }
+
+    graph_t *graph = build_dualswitch_topo();
+    node_t *H1 = get_node_by_node_name(graph, "H1");
+
+    flow.oif = get_node_if_by_name(H1, "eth0/1");
+    flow.frame_size = bench_prepare_ip_frame(flow.frame, flow.oif,
+            "200.1.1.1", payload_size);
+
+    snprintf(test_name, sizeof(test_name), "flood : dual switch, %u B frames",
+            flow.frame_size);
+    bench_run_flows(test_name, &flow, 1, BENCH_FLOOD_RX_PER_FRAME, rounds);
+    comm_close_graph(graph);
+
+    graph = L2_loop_topo();
+    H1 = get_node_by_node_name(graph, "H1");
+    flow.oif = get_node_if_by_name(H1, "eth0/1");
+
+    if(bench_stp_wait_converged(graph, bench_time_now()) >= BENCH_STP_TIMEOUT){
+        fprintf(bench_out, "flood : spanning tree did not converge on the loop\n");
+        comm_close_graph(graph);
+        return -1;
+    }
+    bench_stp_wait_quiet();
+
+    flow.frame_size = bench_prepare_ip_frame(flow.frame, flow.oif,
+            "200.1.1.1", payload_size);
+    snprintf(test_name, sizeof(test_name), "flood : loop, %u B frames",
+            flow.frame_size);
+    bench_run_flows(test_name, &flow, 1, BENCH_FLOOD_LOOP_RX_PER_FRAME, rounds);
+    bench_stp_wait_quiet();
+
+    /*ARP storm : requests nobody answers*/
+    flow.frame_size = ETH_HDR_SIZE_EXCL_PAYLOAD + sizeof(arp_hdr_t);
+    memset(flow.frame, 0, flow.frame_size);
+    eth_hdr = (ethernet_hdr_t *)flow.frame;
+    layer2_fill_with_broadcast_mac(eth_hdr->dst_mac.mac);
+    memcpy(eth_hdr->src_mac.mac, IF_MAC(flow.oif), sizeof(mac_add_t));
+    eth_hdr->type = ARP_MSG;
+    arp_hdr = (arp_hdr_t *)eth_hdr->payload;
+    arp_hdr->hw_type = 1;
+    arp_hdr->proto_type = 0x0800;
+    arp_hdr->hw_addr_len = sizeof(mac_add_t);
+    arp_hdr->proto_addr_len = 4;
+    arp_hdr->op_code = ARP_BROAD_REQ;
+    memcpy(arp_hdr->src_mac.mac, IF_MAC(flow.oif), sizeof(mac_add_t));
+    arp_hdr->src_ip = tcp_ip_covert_ip_p_to_n("10.1.1.1");
+    arp_hdr->dst_ip = tcp_ip_covert_ip_p_to_n("10.1.1.200");
+
+    bench_run_flows("flood : loop, ARP storm", &flow, 1,
+            BENCH_FLOOD_LOOP_RX_PER_FRAME, rounds);
+    comm_close_graph(graph);
+    return 0;
+}
+
+/* Benchmark : Link aggregation. R1 and R2 are linked by a LAG of 4
+ * members, and by a plain link. Spread over the members of the flows
+ * sent out of the LAG with every hash mode, flows differing in src IP
+ * (hosts) or in L4 ports only (ports). Failover when a member is shut :
+ * flows of the member move, the others must stay where they are. Cost
+ * of sending out of the LAG against sending out of the plain link*/
+#define BENCH_LAG_MEMBERS   4
+#define BENCH_LAG_FLOWS     64
+
+/*Frames R2 must have received once all the frames sent are*/
+static unsigned long long bench_lag_rx_expected;
+
+static void
+bench_lag_prepare_flows(bench_flow_t *flows, interface_t *oif,
+                        bool_t vary_ports){
+
+    unsigned int i;
+    ip_hdr_t *ip_hdr;
+    uint16_t ports[2];
+
+    for(i = 0; i < BENCH_LAG_FLOWS; i++){
+
+        flows[i].oif = oif;
+        strncpy(flows[i].dst_ip, "10.1.1.2", 16);
+        flows[i].frame_size = bench_prepare_ip_frame(flows[i].frame, oif,
+                flows[i].dst_ip, sizeof(ports));
+
+        ip_hdr = (ip_hdr_t *)(((ethernet_hdr_t *)flows[i].frame)->payload);
+        ip_hdr->src_ip = (10 << 24) | (1 << 16) | (2 << 8) |
+                         (vary_ports ? 1 : i);
+        ports[0] = vary_ports ? 1024 + i : 1024;
+        ports[1] = 80;
+        memcpy(INCREMENT_IPHDR(ip_hdr), ports, sizeof(ports));
+    }
+}
+
+/*Member of the LAG the flow is sent out of, from the tx counters*/
+static int
+bench_lag_flow_member(lag_t *lag, bench_flow_t *flow){
+
+    unsigned int i;
+    unsigned long long n_tx[LAG_MAX_MEMBERS];
+
+    memcpy(n_tx, lag->n_tx, sizeof(n_tx));
+    send_pkt_out(flow->frame, flow->frame_size, flow->oif);
+    bench_lag_rx_expected++;
+    for(i = 0; i < lag->n_members; i++){
+        if(lag->n_tx[i] != n_tx[i])
+            return i;
+    }
+    return -1;
+}
+
+/* Send 'rounds' frames on every flow, a round at a time : with the l2
+ * hash all the flows queue up on one member. Returns the frames lost
+ * since the last call*/
+static unsigned long long
+bench_lag_run_flows(bench_flow_t *flows, unsigned int rounds){
+
+    unsigned int i, round;
+    unsigned long long rx_pkts, n_lost;
+
+    for(round = 0; round < rounds; round++){
+        for(i = 0; i < BENCH_LAG_FLOWS; i++){
+            send_pkt_out(flows[i].frame, flows[i].frame_size, flows[i].oif);
+        }
+        bench_lag_rx_expected += BENCH_LAG_FLOWS;
+        rx_pkts = bench_wait_rx(bench_lag_rx_expected);
+    }
+
+    n_lost = bench_lag_rx_expected - rx_pkts;
+    bench_lag_rx_expected = rx_pkts;
+    return n_lost;
+}
+
+static void
+bench_lag_report_spread(char *test_name, lag_t *lag, unsigned long long *n_tx_start){
+
+    unsigned int i;
+    unsigned long long n_tx, max = 0, total = 0;
+    char spread[64];
+    int len = 0;
+
+    for(i = 0; i < lag->n_members; i++){
+        n_tx = lag->n_tx[i] - n_tx_start[i];
+        total += n_tx;
+        if(n_tx > max) max = n_tx;
+        len += snprintf(spread + len, sizeof(spread) - len, " %6llu", n_tx);
+    }
+
+    fprintf(bench_out, "%-40s : %10.2f max/avg, frames per member%s\n",
+            test_name, total ? (double)max * lag->n_members / total : 0, spread);
+}
+
+static int
+bench_lag(int argc, char **argv){
+
+    unsigned int rounds = argc > 0 ? atoi(argv[0]) : 100;
+    unsigned int n_pkts = argc > 1 ? atoi(argv[1]) : 200000;
+    unsigned int i, h, n_failed_over, n_moved, n_rebalanced;
+    unsigned long long n_tx_start[LAG_MAX_MEMBERS], n_lost;
+    int members[BENCH_LAG_FLOWS], member;
+    char if_name[IF_NAME_SIZE], test_name[64];
+    char frame[MAX_PACKET_BUFFER_SIZE];
+    unsigned int frame_size;
+    double start, elapsed;
+    static char *hash_names[] = {"l2", "l3", "l4"};
+    bench_flow_t *host_flows = calloc(BENCH_LAG_FLOWS, sizeof(bench_flow_t));
+    bench_flow_t *port_flows = calloc(BENCH_LAG_FLOWS, sizeof(bench_flow_t));
+
+    graph_t *graph = create_new_graph("lag bench");
+    node_t *R1 = create_graph_node(graph, "R1");
+    node_t *R2 = create_graph_node(graph, "R2");
+
+    node_create_lag(R1, "lag0");
+    node_create_lag(R2, "lag0");
+    for(i = 0; i < BENCH_LAG_MEMBERS; i++){
+        snprintf(if_name, IF_NAME_SIZE, "eth0/%u", i + 1);
+        insert_link_between_two_nodes(R1, R2, if_name, if_name, 1);
+        node_add_lag_member(R1, "lag0", if_name);
+        node_add_lag_member(R2, "lag0", if_name);
+    }
+    insert_link_between_two_nodes(R1, R2, "eth0/9", "eth0/9", 1);
+
+    node_set_intf_ip_address(R1, "lag0", "10.1.1.1", 24);
+    node_set_intf_ip_address(R2, "lag0", "10.1.1.2", 24);
+    node_set_intf_ip_address(R1, "eth0/9", "20.1.1.1", 24);
+    node_set_intf_ip_address(R2, "eth0/9", "20.1.1.2", 24);
+
+    interface_t *lag_intf = get_node_if_by_name(R1, "lag0");
+    interface_t *plain_intf = get_node_if_by_name(R1, "eth0/9");
+    interface_t *member_intf = get_node_if_by_name(R1, "eth0/1");
+    lag_t *lag = IF_LAG(lag_intf);
+
+    bench_lag_prepare_flows(host_flows, lag_intf, FALSE);
+    bench_lag_prepare_flows(port_flows, lag_intf, TRUE);
+
+    /*Sending side only, no receiver thread is running yet*/
+    frame_size = bench_prepare_ip_frame(frame, plain_intf, "20.1.1.2", 0);
+    start = bench_time_now();
+    for(i = 0; i < n_pkts; i++){
+        send_pkt_out(frame, frame_size, plain_intf);
+    }
+    bench_report("lag : tx plain link", n_pkts, bench_time_now() - start);
+
+    lag_set_hash_mode(lag_intf, LAG_HASH_L4);
+    start = bench_time_now();
+    for(i = 0; i < n_pkts; i++){
+        bench_flow_t *flow = &port_flows[i % BENCH_LAG_FLOWS];
+        send_pkt_out(flow->frame, flow->frame_size, lag_intf);
+    }
+    bench_report("lag : tx LAG, l4 hash", n_pkts, bench_time_now() - start);
+
+    network_start_pkt_receiver_thread(graph);
+    bench_lag_rx_expected = bench_wait_rx(~0ULL);
+
+    for(h = LAG_HASH_L2; h <= LAG_HASH_L4; h++){
+
+        lag_set_hash_mode(lag_intf, h);
+
+        memcpy(n_tx_start, lag->n_tx, sizeof(n_tx_start));
+        n_lost = bench_lag_run_flows(host_flows, rounds);
+        snprintf(test_name, sizeof(test_name), "lag : %s hash, %u flows by src IP",
+                hash_names[h], BENCH_LAG_FLOWS);
+        bench_lag_report_spread(test_name, lag, n_tx_start);
+
+        memcpy(n_tx_start, lag->n_tx, sizeof(n_tx_start));
+        n_lost += bench_lag_run_flows(port_flows, rounds);
+        snprintf(test_name, sizeof(test_name), "lag : %s hash, %u flows by L4 port",
+                hash_names[h], BENCH_LAG_FLOWS);
+        bench_lag_report_spread(test_name, lag, n_tx_start);
+
+        if(n_lost)
+            fprintf(bench_out, "lag : %s hash, %llu frames lost\n", hash_names[h], n_lost);
+    }
+
+    /*Failover, with the flows spread over all the members*/
+    lag_set_hash_mode(lag_intf, LAG_HASH_L4);
+    for(i = 0; i < BENCH_LAG_FLOWS; i++)
+        members[i] = bench_lag_flow_member(lag, &port_flows[i]);
+
+    start = bench_time_now();
+    interface_set_admin_state(member_intf, FALSE);
+    elapsed = bench_time_now() - start;
+
+    for(n_failed_over = 0, n_moved = 0, i = 0; i < BENCH_LAG_FLOWS; i++){
+        member = bench_lag_flow_member(lag, &port_flows[i]);
+        if(members[i] == 0)
+            n_failed_over++;
+        else if(member != members[i])
+            n_moved++;
+    }
+    memcpy(n_tx_start, lag->n_tx, sizeof(n_tx_start));
+    n_lost = bench_lag_run_flows(port_flows, rounds);
+    fprintf(bench_out, "%-40s : %10.3f ms, %u flows failed over, %u other flows moved, "
+            "%llu frames lost\n", "lag : member shut", elapsed * 1e3,
+            n_failed_over, n_moved, n_lost);
+    bench_lag_report_spread("lag : l4 hash, member shut", lag, n_tx_start);
+
+    start = bench_time_now();
+    interface_set_admin_state(member_intf, TRUE);
+    elapsed = bench_time_now() - start;
+
+    for(n_rebalanced = 0, i = 0; i < BENCH_LAG_FLOWS; i++){
+        if(bench_lag_flow_member(lag, &port_flows[i]) == 0)
+            n_rebalanced++;
+    }
+    memcpy(n_tx_start, lag->n_tx, sizeof(n_tx_start));
+    n_lost = bench_lag_run_flows(port_flows, rounds);
+    fprintf(bench_out, "%-40s : %10.3f ms, %u flows back on the member, "
+            "%llu frames lost\n", "lag : member restored", elapsed * 1e3,
+            n_rebalanced, n_lost);
+    bench_lag_report_spread("lag : l4 hash, member restored", lag, n_tx_start);
+
+    comm_close_graph(graph);
+    return 0;
+}
+
+static unsigned int bench_ip_pkt_sizes[] = {64, 256, 512, 1024, 1500, 4000, 9000, 0};
+
+/* Benchmark : Goodput (IP payload bytes delivered per sec) against
+ * frame size, on a router chain with jumbo MTU on all the interfaces*/
+static int
+bench_goodput(int argc, char **argv){
+
+    unsigned int n_nodes = argc > 0 ? atoi(argv[0]) : 64;
+    unsigned int hops = argc > 1 ? atoi(argv[1]) : 8;
+    unsigned int rounds = argc > 2 ? atoi(argv[2]) : 200;
+    unsigned int i, s, n_flows, payload_size;
+    unsigned long long rx_start, rx_pkts;
+    double start, elapsed;
+    char node_name[NODE_NAME_SIZE];
+    char test_name[64];
+    node_t **nodes = calloc(n_nodes, sizeof(node_t *));
+    bench_flow_t *flows = calloc(n_nodes, sizeof(bench_flow_t));
+
+    if(hops == 0 || hops >= 64 || n_nodes <= hops){
+        fprintf(bench_out, "Error : hops must be in range [1-63] and "
+                "less than n-nodes\n");
+        return -1;
+    }
+
+    graph_t *graph = create_new_graph("goodput bench");
+    for(i = 0; i < n_nodes; i++){
+        snprintf(node_name, NODE_NAME_SIZE, "R%u", i);
+        nodes[i] = create_graph_node(graph, node_name);
+    }
+    n_flows = bench_build_router_chain(nodes, n_nodes, 0, hops, flows);
+
+    for(i = 0; i + 1 < n_nodes; i++){
+        node_set_intf_mtu(nodes[i], "eth0/1", IF_MAX_MTU);
+        node_set_intf_mtu(nodes[i + 1], "eth0/2", IF_MAX_MTU);
+    }
+
+    network_start_pkt_receiver_thread(graph);
+    /*Warm up : let ARP resolution complete on all flows*/
+    for(i = 0; i < n_flows; i++){
+        send_pkt_out(flows[i].frame, flows[i].frame_size, flows[i].oif);
+    }
+    bench_wait_rx(~0ULL);
+
+    for(s = 0; bench_ip_pkt_sizes[s]; s++){
+
+        payload_size = bench_ip_pkt_sizes[s] - sizeof(ip_hdr_t);
+
+        for(i = 0; i < n_flows; i++){
+            flows[i].frame_size = bench_prepare_ip_frame(flows[i].frame,
+                    flows[i].oif, flows[i].dst_ip, payload_size);
+        }
+
+        snprintf(test_name, sizeof(test_name), "goodput : %u B IP pkts",
+                bench_ip_pkt_sizes[s]);
+        rx_start = comm_get_rx_pkt_count();
+        start = bench_time_now();
+        bench_run_flows(test_name, flows, n_flows, hops, rounds);
+        elapsed = bench_time_now() - start;
+        rx_pkts = comm_get_rx_pkt_count() - rx_start;
+
+        /*Every frame delivers its payload once, after 'hops' receptions*/
+        fprintf(bench_out, "%-40s : %10.1f Mbit/s goodput\n", test_name,
+                (double)rx_pkts / hops * payload_size * 8 / elapsed / 1e6);
+    }
+    comm_close_graph(graph);
+    return 0;
+}
+
+/* Replicas of the 802.1Q tag and untag as they used to be : the hdr
+ * of the frame is saved in a local ethernet_hdr_t/vlan_ethernet_hdr_t,
+ * which are as large as a jumbo frame*/
+static ethernet_hdr_t *
+bench_legacy_tag_pkt_with_vlan_id(ethernet_hdr_t *ethernet_hdr,
+                                  unsigned int total_pkt_size,
+                                  int vlan_id,
+                                  unsigned int *new_pkt_size){
+
+    ethernet_hdr_t ethernet_hdr_old;
+    vlan_ethernet_hdr_t *vlan_ethernet_hdr;
+    unsigned int payload_size = total_pkt_size - ETH_HDR_SIZE_EXCL_PAYLOAD;
+
+    memcpy((char *)&ethernet_hdr_old, (char *)ethernet_hdr,
+                ETH_HDR_SIZE_EXCL_PAYLOAD - sizeof(ethernet_hdr_old.FCS));
+
+    vlan_ethernet_hdr = (vlan_ethernet_hdr_t *)
+        ((char *)ethernet_hdr - sizeof(vlan_8021q_hdr_t));
+
+    memset((char *)vlan_ethernet_hdr, 0,
+                VLAN_ETH_HDR_SIZE_EXCL_PAYLOAD - sizeof(vlan_ethernet_hdr->FCS));
+    memcpy(vlan_ethernet_hdr->dst_mac.mac, ethernet_hdr_old.dst_mac.mac, sizeof(mac_add_t));
+    memcpy(vlan_ethernet_hdr->src_mac.mac, ethernet_hdr_old.src_mac.mac, sizeof(mac_add_t));
+    vlan_ethernet_hdr->vlan_8021q_hdr.tpid = VLAN_8021Q_PROTO;
+    vlan_ethernet_hdr->vlan_8021q_hdr.tci_vid = (short)vlan_id;
+    vlan_ethernet_hdr->type = ethernet_hdr_old.type;
+
+    SET_COMMON_ETH_FCS((ethernet_hdr_t *)vlan_ethernet_hdr, payload_size, 0);
+    *new_pkt_size = total_pkt_size + sizeof(vlan_8021q_hdr_t);
+    return (ethernet_hdr_t *)vlan_ethernet_hdr;
+}
+
+static ethernet_hdr_t *
+bench_legacy_untag_pkt_with_vlan_id(ethernet_hdr_t *ethernet_hdr,
+                                    unsigned int total_pkt_size,
+                                    unsigned int *new_pkt_size){
+
+    vlan_ethernet_hdr_t vlan_ethernet_hdr_old;
+    unsigned int payload_size = total_pkt_size - VLAN_ETH_HDR_SIZE_EXCL_PAYLOAD;
+
+    memcpy((char *)&vlan_ethernet_hdr_old, (char *)ethernet_hdr,
+                VLAN_ETH_HDR_SIZE_EXCL_PAYLOAD - sizeof(vlan_ethernet_hdr_old.FCS));
+
+    ethernet_hdr = (ethernet_hdr_t *)((char *)ethernet_hdr + sizeof(vlan_8021q_hdr_t));
+    memcpy(ethernet_hdr->dst_mac.mac, vlan_ethernet_hdr_old.dst_mac.mac, sizeof(mac_add_t));
+    memcpy(ethernet_hdr->src_mac.mac, vlan_ethernet_hdr_old.src_mac.mac, sizeof(mac_add_t));
+    ethernet_hdr->type = vlan_ethernet_hdr_old.type;
+
+    SET_COMMON_ETH_FCS(ethernet_hdr, payload_size, 0);
+    *new_pkt_size = total_pkt_size - sizeof(vlan_8021q_hdr_t);
+    return ethernet_hdr;
+}
+
+static unsigned int bench_vlan_tag_frame_sizes[] = {64, 1500, 9000, 0};
+
+/* Runs 'n_iters' times the untag of a frame received on a trunk and
+ * sent out of an access port, followed by the tag of the frame coming
+ * back on the access port. Returns the ns per untag + tag, '*frame_ok'
+ * tells whether the frame came out of the loop as it went in*/
+static double
+bench_vlan_tag_run(pkt_buffer_t *pkt_buf, unsigned int n_iters,
+                   bool_t legacy, bool_t *frame_ok){
+
+    static char frame_ref[MAX_JUMBO_PACKET_BUFFER_SIZE];
+    ethernet_hdr_t *eth_hdr = (ethernet_hdr_t *)pkt_buf->data;
+    unsigned int i, pkt_size = pkt_buf->len;
+    double start, elapsed;
+
+    memcpy(frame_ref, pkt_buf->data, pkt_buf->len);
+
+    start = bench_time_now();
+    for(i = 0; i < n_iters; i++){
+        if(legacy){
+            eth_hdr = bench_legacy_untag_pkt_with_vlan_id(eth_hdr, pkt_size, &pkt_size);
+            eth_hdr = bench_legacy_tag_pkt_with_vlan_id(eth_hdr, pkt_size, 10, &pkt_size);
+        }
+        else{
+            eth_hdr = untag_pkt_with_vlan_id(eth_hdr, pkt_size, &pkt_size);
+            eth_hdr = tag_pkt_with_vlan_id(eth_hdr, pkt_size, 10, &pkt_size);
+        }
+    }
+    elapsed = bench_time_now() - start;
+
+    /*FCS is checked apart, it is zero unless enabled*/
+    *frame_ok = (char *)eth_hdr == pkt_buf->data && pkt_size == pkt_buf->len &&
+        memcmp(frame_ref, pkt_buf->data, pkt_size - sizeof(eth_hdr->FCS)) == 0;
+    if(l2_fcs_enabled && !legacy)
+        *frame_ok = *frame_ok && GET_COMMON_ETH_FCS(eth_hdr,
+                        pkt_size - VLAN_ETH_HDR_SIZE_EXCL_PAYLOAD) ==
+                    ethernet_fcs_compute(pkt_buf->data, pkt_size - sizeof(eth_hdr->FCS));
+    return elapsed * 1e9 / n_iters;
+}
+
+/* Benchmark : 802.1Q untag of the frames a switch sends from a trunk
+ * out of an access port, and tag of the frames received on the access
+ * port, per frame size. The FCS is recomputed only when enabled*/
+static int
+bench_vlan_tag(int argc, char **argv){
+
+    unsigned int n_iters = argc > 0 ? atoi(argv[0]) : 10000000;
+    unsigned int s, frame_size, pkt_size;
+    double ns_legacy, ns_new, ns_fcs;
+    bool_t ok_legacy, ok_new, ok_fcs;
+    char test_name[64];
+    ethernet_hdr_t *eth_hdr;
+    pkt_buffer_t *pkt_buf;
+
+    if(n_iters < 100){
+        fprintf(bench_out, "Error : n-iters must be at least 100\n");
+        return -1;
+    }
+
+    for(s = 0; bench_vlan_tag_frame_sizes[s]; s++){
+
+        frame_size = bench_vlan_tag_frame_sizes[s];
+        pkt_buf = pkt_buffer_alloc(frame_size + sizeof(vlan_8021q_hdr_t));
+
+        /*Untagged frame from the access port, tagged as on the trunk*/
+        eth_hdr = (ethernet_hdr_t *)pkt_buffer_put(pkt_buf, frame_size);
+        memset((char *)eth_hdr, 0xA5, frame_size);
+        bench_mac(2 * s, eth_hdr->dst_mac.mac);
+        bench_mac(2 * s + 1, eth_hdr->src_mac.mac);
+        eth_hdr->type = ETH_IP;
+        eth_hdr = tag_pkt_with_vlan_id(eth_hdr, frame_size, 10, &pkt_size);
+        pkt_buffer_set_data(pkt_buf, (char *)eth_hdr, pkt_size);
+
+        ns_legacy = bench_vlan_tag_run(pkt_buf, n_iters, TRUE, &ok_legacy);
+        ns_new = bench_vlan_tag_run(pkt_buf, n_iters, FALSE, &ok_new);
+        /*CRC of the whole frame twice per iteration, fewer iterations*/
+        l2_fcs_enabled = TRUE;
+        ns_fcs = bench_vlan_tag_run(pkt_buf, n_iters / 100, FALSE, &ok_fcs);
+        l2_fcs_enabled = FALSE;
+
+        snprintf(test_name, sizeof(test_name), "vlan-tag : %u B frames", frame_size);
+        fprintf(bench_out, "%-40s : %8.1f ns legacy, %8.1f ns in place, "
+                "%10.1f ns in place + FCS per untag + tag, frames %s\n",
+                test_name, ns_legacy, ns_new, ns_fcs,
+                ok_legacy && ok_new && ok_fcs ? "intact" : "CORRUPTED");
+        pkt_buffer_free(pkt_buf);
+    }
+    return 0;
+}
+
+/* Benchmark : ARP suppression on a flat L2 domain of two switches
+ * joined by a trunk, 'n-hosts' hosts in vlan 10 spread over both. All
+ * the hosts resolve the first host, as they would their gateway, then
+ * every host resolves the host half way round the domain, once the
+ * first host resolved them all. Run with the ARP suppression of the
+ * switches disabled, then enabled*/
+#define BENCH_ARP_SUPPR_TIMEOUT 5   /*sec*/
+
+static void
+bench_arp_suppr_ip(unsigned int host, char *ip_addr){
+
+    snprintf(ip_addr, 16, "10.1.%u.%u", host / 250, host % 250 + 1);
+}
+
+/* Hosts 'requesters[i]' resolve the IP of host 'targets[i]', all at
+ * once. Returns the no of resolutions which timed out*/
+static unsigned int
+bench_arp_suppr_resolve(node_t **hosts, unsigned int *requesters,
+                        unsigned int *targets, unsigned int n_requests){
+
+    unsigned int i, n_pending = n_requests;
+    char ip_addr[16];
+    bool_t *resolved = calloc(n_requests, sizeof(bool_t));
+    double start = bench_time_now();
+
+    for(i = 0; i < n_requests; i++){
+        bench_arp_suppr_ip(targets[i], ip_addr);
+        send_arp_broadcast_request(hosts[requesters[i]],
+            get_node_if_by_name(hosts[requesters[i]], "eth0/0"), ip_addr);
+    }
+
+    while(n_pending && bench_time_now() - start < BENCH_ARP_SUPPR_TIMEOUT){
+        for(i = 0; i < n_requests; i++){
+            if(resolved[i]) continue;
+            bench_arp_suppr_ip(targets[i], ip_addr);
+            if(bench_stp_arp_resolved(hosts[requesters[i]],
+                    tcp_ip_covert_ip_p_to_n(ip_addr))){
+                resolved[i] = TRUE;
+                n_pending--;
+            }
+        }
+        usleep(100);
+    }
+    free(resolved);
+    return n_pending;
+}
+
+/*ARP requests answered by the switches so far*/
+static unsigned long long
+bench_arp_suppr_count(node_t **sws){
+
+    unsigned int s;
+    unsigned long long n_suppressed = 0;
+
+    for(s = 0; s < 2; s++){
+        if(NODE_ARP_SUPPR_TABLE(sws[s]))
+            n_suppressed += NODE_ARP_SUPPR_TABLE(sws[s])->n_suppressed;
+    }
+    return n_suppressed;
+}
+
+static int
+bench_arp_suppr(int argc, char **argv){
+
+    unsigned int n_hosts = argc > 0 ? atoi(argv[0]) : 64;
+    unsigned int i, s, n_requests, n_timeouts;
+    unsigned long long rx_start, bpdus_start, suppr_start, rx_pkts;
+    double start, elapsed;
+    char node_name[NODE_NAME_SIZE];
+    char if_name[IF_NAME_SIZE];
+    char ip_addr[16];
+    char test_name[64];
+    node_t *sws[2];
+    node_t **hosts;
+    unsigned int *requesters, *targets;
+    graph_t *graph;
+
+    if(n_hosts < 4 || n_hosts > 500){
+        fprintf(bench_out, "Error : n-hosts must be in range [4-500]\n");
+        return -1;
+    }
+
+    hosts = calloc(n_hosts, sizeof(node_t *));
+    requesters = calloc(n_hosts, sizeof(unsigned int));
+    targets = calloc(n_hosts, sizeof(unsigned int));
+
+    graph = create_new_graph("arp suppression bench");
+    sws[0] = create_graph_node(graph, "SW1");
+    sws[1] = create_graph_node(graph, "SW2");
+    insert_link_between_two_nodes(sws[0], sws[1], "trunk", "trunk", 1);
+
+    for(s = 0; s < 2; s++){
+        node_set_intf_l2_mode(sws[s], "trunk", TRUNK);
+        node_set_intf_vlan_membsership(sws[s], "trunk", 10);
+    }
+
+    /*Host i is on switch i % 2*/
+    for(i = 0; i < n_hosts; i++){
+        snprintf(node_name, NODE_NAME_SIZE, "H%u", i);
+        snprintf(if_name, IF_NAME_SIZE, "eth%u", i);
+        bench_arp_suppr_ip(i, ip_addr);
+        hosts[i] = create_graph_node(graph, node_name);
+        insert_link_between_two_nodes(hosts[i], sws[i % 2], "eth0/0", if_name, 1);
+        node_set_intf_ip_address(hosts[i], "eth0/0", ip_addr, 16);
+        node_set_intf_l2_mode(sws[i % 2], if_name, ACCESS);
+        node_set_intf_vlan_membsership(sws[i % 2], if_name, 10);
+    }
+
+    network_start_pkt_receiver_thread(graph);
+    bench_stp_wait_converged(graph, bench_time_now());
+
+    for(s = 0; s < 2; s++){
+
+        l2_switch_set_arp_suppression(sws[0], s == 1);
+        l2_switch_set_arp_suppression(sws[1], s == 1);
+        for(i = 0; i < n_hosts; i++)
+            clear_arp_table(NODE_ARP_TABLE(hosts[i]));
+
+        /*Gateway : H1 first, so that a switch snoops the reply*/
+        requesters[0] = 1;
+        targets[0] = 0;
+        n_timeouts = bench_arp_suppr_resolve(hosts, requesters, targets, 1);
+        bench_stp_wait_quiet();
+
+        for(n_requests = 0, i = 2; i < n_hosts; i++, n_requests++){
+            requesters[n_requests] = i;
+            targets[n_requests] = 0;
+        }
+
+        snprintf(test_name, sizeof(test_name), "arp-suppr : %s, %u hosts to gateway",
+                s ? "on" : "off", n_requests);
+        rx_start = comm_get_rx_pkt_count();
+        bpdus_start = bench_stp_bpdus(graph);
+        suppr_start = bench_arp_suppr_count(sws);
+        start = bench_time_now();
+        n_timeouts += bench_arp_suppr_resolve(hosts, requesters, targets, n_requests);
+        elapsed = bench_time_now() - start;
+        rx_pkts = bench_stp_wait_quiet() - rx_start -
+            (bench_stp_bpdus(graph) - bpdus_start);
+        fprintf(bench_out, "%-40s : %6.1f frames rx per resolution, %4llu floods suppressed, "
+                "%8.3f ms\n", test_name, (double)rx_pkts / n_requests,
+                bench_arp_suppr_count(sws) - suppr_start, elapsed * 1e3);
+
+        /*Any to any, once the gateway resolved all the hosts*/
+        for(n_requests = 0, i = 1; i < n_hosts; i++, n_requests++){
+            requesters[n_requests] = 0;
+            targets[n_requests] = i;
+        }
+        n_timeouts += bench_arp_suppr_resolve(hosts, requesters, targets, n_requests);
+        bench_stp_wait_quiet();
+
+        for(i = 1; i < n_hosts; i++){
+            requesters[i - 1] = i;
+            targets[i - 1] = (i + n_hosts / 2) % n_hosts;
+            if(!targets[i - 1])
+                targets[i - 1] = 1 + (i == 1);
+        }
+
+        snprintf(test_name, sizeof(test_name), "arp-suppr : %s, %u hosts any to any",
+                s ? "on" : "off", n_requests);
+        rx_start = comm_get_rx_pkt_count();
+        bpdus_start = bench_stp_bpdus(graph);
+        suppr_start = bench_arp_suppr_count(sws);
+        start = bench_time_now();
+        n_timeouts += bench_arp_suppr_resolve(hosts, requesters, targets, n_requests);
+        elapsed = bench_time_now() - start;
+        rx_pkts = bench_stp_wait_quiet() - rx_start -
+            (bench_stp_bpdus(graph) - bpdus_start);
+        fprintf(bench_out, "%-40s : %6.1f frames rx per resolution, %4llu floods suppressed, "
+                "%8.3f ms\n", test_name, (double)rx_pkts / n_requests,
+                bench_arp_suppr_count(sws) - suppr_start, elapsed * 1e3);
+
+        if(n_timeouts)
+            fprintf(bench_out, "arp-suppr : %s, %u resolutions timed out\n",
+                    s ? "on" : "off", n_timeouts);
+    }
+
+    comm_close_graph(graph);
+    free(hosts);
+    free(requesters);
+    free(targets);
+    return 0;
+}
+
+typedef struct bench_{
+
+    char *name;
+    int (*bench_fn)(int argc, char **argv);
+    char *help;
+} bench_t;
+
+static bench_t benchmarks[] = {
+
+    {"tx", bench_tx, "[n-pkts] : send_pkt_out() frames per sec"},
+    {"rx-scale", bench_rx_scale, "[n-nodes] [rounds] : receiver thread throughput on large topology"},
+    {"scale", bench_scale, "[n-nodes] [hops] [rounds] : forwarding throughput with 1, 2, 4, 8 rx threads"},
+    {"build", bench_build, "[n-nodes] : topology build time, nodes looked up by name"},
+    {"ports", bench_ports, "[n-ports] [rounds] : unicast switching on a switch with n-ports hosts"},
+    {"vlan-flood", bench_vlan_flood, "[n-ports] [n-vlans] [rounds] : broadcast flooding on a switch with n-ports hosts in n-vlans vlans"},
+    {"mac-table", bench_mac_table, "[n-macs] : MAC table learn, refresh, lookup and delete"},
+    {"mac-aging", bench_mac_aging, "[n-macs] [aging-time] : MAC aging sweep cost per timer tick"},
+    {"arp-table", bench_arp_table, "[n-entries] : ARP table add, lookup and delete"},
+    {"transports", bench_transports, "[n-nodes] [hops] [rounds] : forwarding throughput with every transport"},
+    {"goodput", bench_goodput, "[n-nodes] [hops] [rounds] : goodput against frame size, jumbo MTU"},
+    {"vlans", bench_vlans, "[n-vlans] [rounds] : switching over trunks carrying n-vlans vlans"},
+    {"flood", bench_flood, "[rounds] [payload-size] : broadcast flooding on dual switch topology, and ARP storm on the looped one"},
+    {"stp", bench_stp, ": spanning tree convergence on the looped topology, link shut and restored"},
+    {"lag", bench_lag, "[rounds] [n-pkts] : flow spread over the members of a LAG per hash mode, member failover"},
+    {"arp-suppr", bench_arp_suppr, "[n-hosts] : ARP requests flooded and answered by the switches, ARP suppression off and on"},
+    {"vlan-tag", bench_vlan_tag, "[n-iters] : 802.1Q untag trunk to access + tag, legacy vs in place, with FCS"},
+    {0, 0, 0}
+};
+
+int
+main(int argc, char **argv){
+
+    bench_t *bench;
+    char *prog_name = argv[0];
+
+    bench_out = fdopen(dup(1), "w");
+    setvbuf(bench_out, NULL, _IOLBF, 0);
+    freopen("/dev/null", "w", stdout);
+
+    if(argc > 2 && strcmp(argv[1], "-t") == 0){
+        if(comm_set_transport(argv[2]) < 0){
+            fprintf(bench_out, "Error : Unknown transport %s\n", argv[2]);
+            return -1;
+        }
+        argc -= 2;
+        argv += 2;
+    }
+
+    if(argc < 2){
+        fprintf(bench_out, "Usage : %s [-t <udp|unix|shm|uring>] <benchmark> [args]\n", prog_name);
+        for(bench = benchmarks; bench->name; bench++){
+            fprintf(bench_out, "\t%-12s %s\n", bench->name, bench->help);
+        }
+        return 0;
+    }
+
+    for(bench = benchmarks; bench->name; bench++){
+        if(strcmp(bench->name, argv[1]) == 0)
+            return bench->bench_fn(argc - 2, argv + 2);
+    }
+
+    fprintf(bench_out, "Error : Unknown benchmark %s\n", argv[1]);
+    return -1;
+}
@@ -44,4 +44,17 @@
 #define CMDCODE_SHOW_NODE_RT_TABLE  9   /*show node <node-name> rt*/
 #define CMDCODE_CONF_NODE_L3ROUTE   10  /*config node <node-name> route <ip-address> <mask> [<gw-ip> <oif>]*/
 #define CMDCODE_ERO_PING            11  /*run <node-name> ping <ip-address> ero <ero-ip-address>*/
+#define CMDCODE_SHOW_COMM_STATS     12  /*show comm statistics*/
+#define CMDCODE_CONF_COMM_RX_BATCH  13  /*config comm rx-batch-size <batch-size>*/
+#define CMDCODE_CONF_COMM_RX_THREADS 14 /*config comm rx-threads <n-threads>*/
+#define CMDCODE_SHOW_COMM_PKT_BUFFERS 15 /*show comm pkt-buffers*/
+#define CMDCODE_INTF_CONFIG_MTU     16  /*config node <node-name> interface <intf-name> mtu <mtu>*/
+#define CMDCODE_CONF_NODE_MAC_AGING 17  /*config node <node-name> mac-aging <aging-time>*/
+#define CMDCODE_INTF_CONFIG_SHUTDOWN 18 /*config node <node-name> interface <intf-name> shutdown*/
+#define CMDCODE_SHOW_NODE_STP       19  /*show node <node-name> stp*/
+#define CMDCODE_CONF_NODE_STP_PRIORITY 20 /*config node <node-name> stp priority <priority>*/
+#define CMDCODE_INTF_CONFIG_LAG_HASH 21 /*config node <node-name> interface <lag-name> lag-hash <l2|l3|l4>*/
+#define CMDCODE_INTF_CONFIG_LAG     22  /*config node <node-name> interface <intf-name> channel-group <lag-name>*/
+#define CMDCODE_SHOW_NODE_ARP_SUPPR 23  /*show node <node-name> proxy-arp*/
+#define CMDCODE_CONF_NODE_ARP_SUPPR 24  /*config node <node-name> proxy-arp*/
 #endif /* __CMDCODES__ */
@@ -30,202 +30,672 @@
  * =====================================================================================
  */
 
-#include "comm.h"
-#include "graph.h"
+#define _GNU_SOURCE /*for recvmmsg*/
+#include "comm_transport.h"
 #include <sys/socket.h>
 #include <pthread.h>
-#include <netinet/in.h>
 #include <memory.h>
+#include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
-#include <netdb.h> /*for struct hostent*/
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h> /*for setrlimit*/
 #include "net.h"
+#include "pkt_buffer.h"
 #include <unistd.h> // for close
 
-static int
-_send_pkt_out(int sock_fd, char *pkt_data, unsigned int pkt_size, 
-                unsigned int dst_udp_port_no){
+/*Transports the topologies can be built with, first one is default*/
+static comm_transport_t *comm_transports[] = {
 
-    int rc;
-    struct sockaddr_in dest_addr;
-   
-    struct hostent *host = (struct hostent *) gethostbyname("127.0.0.1"); 
-    dest_addr.sin_family = AF_INET;
-    dest_addr.sin_port = dst_udp_port_no;
-    dest_addr.sin_addr = *((struct in_addr *)host->h_addr);
+    &udp_transport,
+    &unix_transport,
+    &shm_transport,
+    &uring_transport,
+    NULL
+};
 
-    rc = sendto(sock_fd, pkt_data, pkt_size, 0, 
-            (struct sockaddr *)&dest_addr, sizeof(struct sockaddr));
-    
-    return rc;
+/*Transport of the topologies created from now on*/
+static comm_transport_t *default_transport = &udp_transport;
+
+static comm_transport_t *
+comm_get_transport_by_name(char *transport_name){
+
+    unsigned int i;
+
+    for(i = 0; comm_transports[i]; i++){
+
+        if(strcmp(comm_transports[i]->name, transport_name))
+            continue;
+
+        if(comm_transports[i]->available &&
+            !comm_transports[i]->available()){
+            printf("Info : Transport %s not available on this host, using %s\n",
+                    transport_name, comm_transports[0]->name);
+            return comm_transports[0];
+        }
+        return comm_transports[i];
+    }
+
+    printf("Error : Unknown transport %s, supported :", transport_name);
+    for(i = 0; comm_transports[i]; i++)
+        printf(" %s", comm_transports[i]->name);
+    printf("\n");
+    return NULL;
 }
 
+int
+comm_set_transport(char *transport_name){
 
-static unsigned int udp_port_number = 40000;
+    comm_transport_t *transport = comm_get_transport_by_name(transport_name);
 
-static unsigned int 
-get_next_udp_port_number(){
-    
-    return udp_port_number++;
+    if(!transport)
+        return -1;
+    default_transport = transport;
+    return 0;
+}
+
+int
+comm_set_graph_transport(graph_t *graph, char *transport_name){
+
+    comm_transport_t *transport = comm_get_transport_by_name(transport_name);
+
+    if(!transport)
+        return -1;
+
+    if(!IS_GLTHREAD_LIST_EMPTY(&graph->node_list)){
+        printf("Error : Transport of topology %s must be selected before adding nodes\n",
+                graph->topology_name);
+        return -1;
+    }
+    graph->transport = transport;
+    return 0;
 }
 
 void
-init_udp_socket(node_t *node){
+init_graph_comm(graph_t *graph){
+
+    graph->transport = default_transport;
+}
+
+void
+init_node_comm(graph_t *graph, node_t *node){
+
+    init_glthread(&node->rx_pending_glue);
+    node->transport = graph->transport;
+    node->transport->init_node(node);
+}
 
-    if(node->udp_port_number)
+void
+init_link_comm(link_t *link){
+
+    node_t *node1 = link->intf1.att_node;
+    node_t *node2 = link->intf2.att_node;
+
+    link->intf1.tx_sock_fd = -1;
+    link->intf2.tx_sock_fd = -1;
+
+    if(node1->transport != node2->transport){
+        printf("Error : Nodes %s and %s use different transports, link not usable\n",
+                node1->node_name, node2->node_name);
         return;
-    
-    node->udp_port_number = get_next_udp_port_number();
-     
-    int udp_sock_fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP );
-    
-    if(udp_sock_fd == -1){
-        printf("Socket Creation Failed for node %s\n", node->node_name);
-        return;   
     }
+    node1->transport->init_link(link);
+}
 
-    struct sockaddr_in node_addr;
-    node_addr.sin_family      = AF_INET;
-    node_addr.sin_port        = node->udp_port_number;
-    node_addr.sin_addr.s_addr = INADDR_ANY;
-    if (bind(udp_sock_fd, (struct sockaddr *)&node_addr, sizeof(struct sockaddr)) == -1) {
-        printf("Error : socket bind failed for Node %s\n", node->node_name);
+/* Every node owns a socket, large topologies need more descriptors
+ * than the default soft limit of the process allows*/
+void
+comm_raise_fd_limit(){
+
+    static bool_t fd_limit_raised = FALSE;
+    struct rlimit rlim;
+
+    if(fd_limit_raised)
         return;
-    }
 
-    node->udp_sock_fd = udp_sock_fd;
+    fd_limit_raised = TRUE;
+
+    if(getrlimit(RLIMIT_NOFILE, &rlim) == 0 &&
+        rlim.rlim_cur < rlim.rlim_max){
+        rlim.rlim_cur = rlim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rlim);
+    }
 }
 
-static char recv_buffer[MAX_PACKET_BUFFER_SIZE];
-static char send_buffer[MAX_PACKET_BUFFER_SIZE];
+/* Receiver threads drain up to comm_rx_batch_size frames of a node in
+ * one go*/
+unsigned int comm_rx_batch_size = DEFAULT_RX_BATCH_SIZE;
+
+static comm_worker_t comm_workers[MAX_RX_THREADS];
+static unsigned int n_rx_threads = DEFAULT_RX_THREADS;
+static unsigned int n_running_rx_threads = 0;
+/*Rx stats of the threads stopped so far*/
+static rx_stats_t rx_stats_history;
+/*Frames dropped as their payload exceeds the MTU of the interface*/
+static unsigned long long comm_n_tx_mtu_drops = 0;
+static unsigned long long comm_n_rx_mtu_drops = 0;
+/*Topology being served by the receiver threads*/
+static graph_t *comm_topo = NULL;
+static __thread comm_worker_t *comm_self_worker = NULL;
+
+void
+comm_rx_stats_update(comm_worker_t *worker, unsigned int n_msgs){
+
+    unsigned int bucket = 0;
+    rx_stats_t *rx_stats = &worker->rx_stats;
+
+    rx_stats->n_recv_calls++;
+    rx_stats->n_pkts += n_msgs;
+    if(n_msgs > rx_stats->max_batch)
+        rx_stats->max_batch = n_msgs;
+
+    while((n_msgs >>= 1) && bucket < RX_BATCH_HIST_BUCKETS - 1)
+        bucket++;
+    rx_stats->batch_hist[bucket]++;
+}
 
 static void
-_pkt_receive(node_t *receving_node, 
-            char *pkt_with_aux_data, 
-            unsigned int pkt_size){
+rx_stats_merge(rx_stats_t *dst, rx_stats_t *src){
+
+    unsigned int i;
+
+    dst->n_recv_calls += src->n_recv_calls;
+    dst->n_pkts += src->n_pkts;
+    if(src->max_batch > dst->max_batch)
+        dst->max_batch = src->max_batch;
+    for(i = 0; i < RX_BATCH_HIST_BUCKETS; i++)
+        dst->batch_hist[i] += src->batch_hist[i];
+}
 
-    char *recv_intf_name = pkt_with_aux_data;
-    interface_t *recv_intf = get_node_if_by_name(receving_node, recv_intf_name);
+void
+comm_set_rx_batch_size(unsigned int batch_size){
 
-    if(!recv_intf){
-        printf("Error : Pkt recvd on unknown interface %s on node %s\n", 
-                    recv_intf->if_name, receving_node->node_name);
+    if(batch_size == 0 || batch_size > MAX_RX_BATCH_SIZE){
+        printf("Error : rx batch size must be in range [1-%u]\n",
+                MAX_RX_BATCH_SIZE);
         return;
     }
+    comm_rx_batch_size = batch_size;
+}
+
+unsigned long long
+comm_get_rx_pkt_count(){
+
+    unsigned int i;
+    unsigned long long n_pkts = rx_stats_history.n_pkts;
+
+    for(i = 0; i < n_running_rx_threads; i++)
+        n_pkts += comm_workers[i].rx_stats.n_pkts;
+    return n_pkts;
+}
+
+void
+dump_comm_stats(){
+
+    unsigned int i;
+    rx_stats_t rx_stats = rx_stats_history;
+
+    printf("Transport : %s\n", comm_topo ? comm_topo->transport->name :
+            default_transport->name);
+    if(comm_topo && comm_topo->transport->dump_stats)
+        comm_topo->transport->dump_stats(comm_topo);
+    printf("Rx threads (configured) : %u, running : %u\n",
+            n_rx_threads, n_running_rx_threads);
+    for(i = 0; i < n_running_rx_threads; i++){
+        printf("\tRx thread %u : nodes : %u, Rx pkts : %llu\n", i,
+                comm_workers[i].n_nodes, comm_workers[i].rx_stats.n_pkts);
+        rx_stats_merge(&rx_stats, &comm_workers[i].rx_stats);
+    }
+    printf("Rx batch size (configured) : %u\n", comm_rx_batch_size);
+    printf("Frames dropped, MTU exceeded : Tx : %llu, Rx : %llu\n",
+            comm_n_tx_mtu_drops, comm_n_rx_mtu_drops);
+    printf("Rx calls : %llu, Rx pkts : %llu, Avg batch : %.2f, Max batch : %u\n",
+            rx_stats.n_recv_calls, rx_stats.n_pkts,
+            rx_stats.n_recv_calls ? 
+                (double)rx_stats.n_pkts / rx_stats.n_recv_calls : 0,
+            rx_stats.max_batch);
+    printf("Rx batch size histogram :\n");
+    for(i = 0; i < RX_BATCH_HIST_BUCKETS; i++){
+        if(i == RX_BATCH_HIST_BUCKETS - 1)
+            printf("\t%4u+       : %llu\n", 1 << i, rx_stats.batch_hist[i]);
+        else
+            printf("\t%4u - %-4u : %llu\n", 1 << i, (2 << i) - 1,
+                    rx_stats.batch_hist[i]);
+    }
+}
+
+static void
+init_rx_buffer_ring(comm_worker_t *worker){
+
+    unsigned int i;
 
-    pkt_receive(receving_node, recv_intf, pkt_with_aux_data + IF_NAME_SIZE, 
-                pkt_size - IF_NAME_SIZE);
+    for(i = 0; i < MAX_RX_BATCH_SIZE; i++){
+
+        char *buffer = worker->rx_buffers + i * worker->rx_buffer_size;
+
+        pkt_buffer_init(&worker->rx_pkt_bufs[i], buffer, worker->rx_buffer_size);
+        worker->rx_iovecs[i].iov_base = buffer + COMM_RX_DATA_OFFSET;
+        worker->rx_iovecs[i].iov_len = worker->rx_buffer_size - COMM_RX_DATA_OFFSET;
+        memset(&worker->rx_msgs[i], 0, sizeof(struct mmsghdr));
+        worker->rx_msgs[i].msg_hdr.msg_iov = &worker->rx_iovecs[i];
+        worker->rx_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
 }
 
+void
+comm_worker_watch_fd(comm_worker_t *worker, int fd, node_t *node){
+
+    struct epoll_event ev;
+
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = node;
+
+    if(epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0){
+        printf("Error : Node %s socket could not be added to epoll set, errno = %d\n",
+                node->node_name, errno);
+    }
+}
+
+void
+comm_worker_watch_transport_fd(comm_worker_t *worker, int fd){
+
+    struct epoll_event ev;
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = worker;
+
+    if(epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0){
+        printf("Error : rx thread %u transport fd could not be added to epoll set, "
+                "errno = %d\n", worker->worker_id, errno);
+    }
+}
+
+comm_worker_t *
+comm_current_worker(){
+
+    return comm_self_worker;
+}
+
+/* Push the node on the ready stack of its receiver thread, unless it
+ * is already scheduled. The thread is woken up only if it is blocked
+ * in epoll_wait()*/
+void
+comm_schedule_node(node_t *node){
+
+    comm_worker_t *worker = node->rx_worker;
+
+    if(__atomic_exchange_n(&node->rx_scheduled, 1, __ATOMIC_SEQ_CST))
+        return;
+
+    /*Receiver threads not started yet, nodes are scheduled when started*/
+    if(!worker)
+        return;
+
+    node->rx_ready_next = __atomic_load_n(&worker->rx_ready_stack, __ATOMIC_RELAXED);
+    while(!__atomic_compare_exchange_n(&worker->rx_ready_stack,
+                &node->rx_ready_next, node, TRUE,
+                __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+
+    if(__atomic_load_n(&worker->sleeping, __ATOMIC_SEQ_CST)){
+        uint64_t wakeup = 1;
+        if(write(worker->wakeup_fd, &wakeup, sizeof(wakeup)) < 0){
+            printf("Error : Could not wakeup rx thread %u, errno = %d\n",
+                    worker->worker_id, errno);
+        }
+    }
+}
+
+#define MAX_EPOLL_EVENTS    256
+
+/* Receiver thread waits on an edge triggered epoll set of the rx
+ * endpoints of the nodes sharded to it, the work done per wakeup is
+ * proportional to the no of ready nodes only. Since edge triggered
+ * readiness is reported only once, a node which still has pkts queued
+ * after a batch is drained stays in the rx pending list, and is served
+ * again (round robin with other ready nodes) until it has been drained
+ * completely. Nodes of transports without descriptors are scheduled
+ * through the ready stack of the thread instead, and transports which
+ * complete the receives by themselves (io_uring) are polled when their
+ * own descriptor is readable*/
 static void *
 _network_start_pkt_receiver_thread(void *arg){
 
-    node_t *node;
+    node_t *node, *next_node;
     glthread_t *curr;
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    int i, n_events, timeout;
+    uint64_t wakeup;
     
-    fd_set active_sock_fd_set,
-           backup_sock_fd_set;
-    
-    int sock_max_fd = 0;
-    int bytes_recvd = 0;
-    
-    graph_t *topo = (void *)arg;
+    comm_worker_t *worker = (comm_worker_t *)arg;
 
-    int addr_len = sizeof(struct sockaddr);
+    comm_self_worker = worker;
 
-    FD_ZERO(&active_sock_fd_set);
-    FD_ZERO(&backup_sock_fd_set);
-    
-    struct sockaddr_in sender_addr;
+    while(!worker->stop){
+
+        /*Do not block if some nodes are still not drained*/
+        timeout = IS_GLTHREAD_LIST_EMPTY(&worker->rx_pending_list) ? -1 : 0;
+
+        /*Announce the sleep before checking the ready stack for the
+         * last time, producers check the flag after pushing a node*/
+        if(timeout){
+            __atomic_store_n(&worker->sleeping, 1, __ATOMIC_SEQ_CST);
+            if(__atomic_load_n(&worker->rx_ready_stack, __ATOMIC_SEQ_CST))
+                timeout = 0;
+        }
+
+        n_events = epoll_wait(worker->epoll_fd, events, MAX_EPOLL_EVENTS, timeout);
+
+        __atomic_store_n(&worker->sleeping, 0, __ATOMIC_RELAXED);
+
+        for(i = 0; i < n_events; i++){
+
+            node = (node_t *)events[i].data.ptr;
+
+            /*Transport serving the nodes of the thread by itself*/
+            if(events[i].data.ptr == worker){
+                worker->transport->worker_poll(worker);
+                continue;
+            }
+
+            /*Wakeup to stop the thread or to serve the ready stack*/
+            if(!node){
+                if(read(worker->wakeup_fd, &wakeup, sizeof(wakeup)) < 0 &&
+                    errno != EAGAIN){
+                    printf("Error : rx thread %u wakeup read failed, errno = %d\n",
+                            worker->worker_id, errno);
+                }
+                continue;
+            }
+
+            if(IS_GLTHREAD_LIST_EMPTY(&node->rx_pending_glue)){
+                glthread_add_next(&worker->rx_pending_list, &node->rx_pending_glue);
+            }
+        }
+
+        node = __atomic_exchange_n(&worker->rx_ready_stack, NULL, __ATOMIC_ACQUIRE);
+        for( ; node; node = next_node){
+
+            next_node = node->rx_ready_next;
+            if(IS_GLTHREAD_LIST_EMPTY(&node->rx_pending_glue)){
+                glthread_add_next(&worker->rx_pending_list, &node->rx_pending_glue);
+            }
+        }
+
+        ITERATE_GLTHREAD_BEGIN(&worker->rx_pending_list, curr){
+
+            node = rx_pending_glue_to_node(curr);
+
+            /*Short batch means node is drained, wait for next edge*/
+            if(node->transport->recv(worker, node) >= comm_rx_batch_size)
+                continue;
+
+            if(!node->transport->rx_ready){
+                remove_glthread(&node->rx_pending_glue);
+                continue;
+            }
+
+            /* Unschedule the node. A frame queued concurrently either
+             * sees the node unscheduled and pushes it on the ready stack
+             * again, or is caught below*/
+            __atomic_store_n(&node->rx_scheduled, 0, __ATOMIC_SEQ_CST);
+            if(!node->transport->rx_ready(node) ||
+                __atomic_exchange_n(&node->rx_scheduled, 1, __ATOMIC_SEQ_CST)){
+                remove_glthread(&node->rx_pending_glue);
+            }
+        } ITERATE_GLTHREAD_END(&worker->rx_pending_list, curr);
+    }
+
+    /*Pkts left queued will be picked up by the next set of threads,
+     * epoll reports the sockets readable when added and the nodes of
+     * other transports are scheduled when the threads start*/
+    ITERATE_GLTHREAD_BEGIN(&worker->rx_pending_list, curr){
+        remove_glthread(curr);
+    } ITERATE_GLTHREAD_END(&worker->rx_pending_list, curr);
+    return NULL;
+}
+
+static bool_t
+comm_worker_init(comm_worker_t *worker, unsigned int worker_id,
+                 comm_transport_t *transport, unsigned int rx_buffer_size){
+
+    struct epoll_event ev;
+
+    memset(worker, 0, sizeof(comm_worker_t));
+    worker->worker_id = worker_id;
+    init_glthread(&worker->rx_pending_list);
+
+    worker->epoll_fd = epoll_create1(0);
+    if(worker->epoll_fd < 0){
+        printf("Error : epoll instance creation failed, errno = %d\n", errno);
+        return FALSE;
+    }
+
+    worker->wakeup_fd = eventfd(0, EFD_NONBLOCK);
+    if(worker->wakeup_fd < 0){
+        printf("Error : eventfd creation failed, errno = %d\n", errno);
+        close(worker->epoll_fd);
+        return FALSE;
+    }
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->wakeup_fd, &ev);
+
+    worker->rx_buffer_size = rx_buffer_size;
+    worker->rx_buffers = calloc(MAX_RX_BATCH_SIZE, rx_buffer_size);
+    init_rx_buffer_ring(worker);
+
+    worker->transport = transport;
+    if(transport->worker_init)
+        transport->worker_init(worker);
+    return TRUE;
+}
+
+static void
+comm_worker_deinit(comm_worker_t *worker){
+
+    if(worker->transport->worker_deinit)
+        worker->transport->worker_deinit(worker);
+    rx_stats_merge(&rx_stats_history, &worker->rx_stats);
+    close(worker->wakeup_fd);
+    close(worker->epoll_fd);
+    free(worker->rx_buffers);
+    worker->rx_buffers = NULL;
+}
+
+/*Size of the buffers fitting the largest frame of the topology*/
+static unsigned int
+comm_graph_buffer_size(graph_t *topo){
+
+    node_t *node;
+    glthread_t *curr;
+    unsigned int i, max_mtu = IF_DEFAULT_MTU;
 
     ITERATE_GLTHREAD_BEGIN(&topo->node_list, curr){
 
         node = graph_glue_to_node(curr);
-        
-        if(!node->udp_sock_fd) 
-            continue;
+        for(i = 0; i < node->n_intf; i++){
+            if(!node->intf[i]) break;
+            if(IF_MTU(node->intf[i]) > max_mtu)
+                max_mtu = IF_MTU(node->intf[i]);
+        }
+    } ITERATE_GLTHREAD_END(&topo->node_list, curr);
+
+    return pkt_buffer_size_for(ETH_MAX_FRAME_SIZE(max_mtu));
+}
+
+/* Start n_rx_threads receiver threads and shard the nodes of the
+ * topology across them. Nodes are assigned in contiguous blocks in
+ * the order of the node list, so that nbr nodes of chain like
+ * topologies mostly end up on the same thread*/
+static void
+comm_start_workers(graph_t *topo){
+
+    node_t *node;
+    glthread_t *curr;
+    comm_worker_t *worker;
+    unsigned int i, n_workers = 0, n_nodes = 0, node_index = 0;
+    unsigned int rx_buffer_size = comm_graph_buffer_size(topo);
+
+    for(i = 0; i < n_rx_threads; i++){
+        if(!comm_worker_init(&comm_workers[i], i, topo->transport,
+                             rx_buffer_size))
+            break;
+        n_workers++;
+    }
 
-        if(node->udp_sock_fd > sock_max_fd)
-            sock_max_fd = node->udp_sock_fd;
+    if(!n_workers) return;
 
-        FD_SET(node->udp_sock_fd, &backup_sock_fd_set);
-            
+    ITERATE_GLTHREAD_BEGIN(&topo->node_list, curr){
+        n_nodes++;
     } ITERATE_GLTHREAD_END(&topo->node_list, curr);
 
-    while(1){
+    ITERATE_GLTHREAD_BEGIN(&topo->node_list, curr){
+
+        node = graph_glue_to_node(curr);
+        worker = &comm_workers[(unsigned long long)node_index * n_workers / n_nodes];
+
+        node->rx_worker = worker;
+        worker->n_nodes++;
+        node->transport->poll_add(worker, node);
+        node_index++;
+    } ITERATE_GLTHREAD_END(&topo->node_list, curr);
 
-        memcpy(&active_sock_fd_set, &backup_sock_fd_set, sizeof(fd_set));
+    for(i = 0; i < n_workers; i++){
+        pthread_create(&comm_workers[i].thread, NULL, 
+                    _network_start_pkt_receiver_thread, 
+                    (void *)&comm_workers[i]);
+    }
+    n_running_rx_threads = n_workers;
+}
 
-        select(sock_max_fd + 1, &active_sock_fd_set, NULL, NULL, NULL);
+static void
+comm_stop_workers(){
 
-        ITERATE_GLTHREAD_BEGIN(&topo->node_list, curr){
+    unsigned int i;
+    node_t *node;
+    glthread_t *curr;
+    uint64_t wakeup = 1;
 
-            node = graph_glue_to_node(curr);
+    for(i = 0; i < n_running_rx_threads; i++){
+        comm_workers[i].stop = TRUE;
+        if(write(comm_workers[i].wakeup_fd, &wakeup, sizeof(wakeup)) < 0){
+            printf("Error : Could not wakeup rx thread %u, errno = %d\n", i, errno);
+        }
+    }
 
-            if(FD_ISSET(node->udp_sock_fd, &active_sock_fd_set)){
-    
-                memset(recv_buffer, 0, MAX_PACKET_BUFFER_SIZE);
-                bytes_recvd = recvfrom(node->udp_sock_fd, (char *)recv_buffer, 
-                        MAX_PACKET_BUFFER_SIZE, 0, (struct sockaddr *)&sender_addr, &addr_len);
-                
-                _pkt_receive(node, recv_buffer, bytes_recvd);
-            }
-            
-        } ITERATE_GLTHREAD_END(&topo->node_list, curr);
+    for(i = 0; i < n_running_rx_threads; i++){
+        pthread_join(comm_workers[i].thread, NULL);
+        comm_worker_deinit(&comm_workers[i]);
     }
+    n_running_rx_threads = 0;
+
+    ITERATE_GLTHREAD_BEGIN(&comm_topo->node_list, curr){
+        node = graph_glue_to_node(curr);
+        node->rx_worker = NULL;
+    } ITERATE_GLTHREAD_END(&comm_topo->node_list, curr);
 }
 
+void
+comm_set_rx_threads(unsigned int n_threads){
+
+    if(n_threads == 0 || n_threads > MAX_RX_THREADS){
+        printf("Error : no of rx threads must be in range [1-%u]\n",
+                MAX_RX_THREADS);
+        return;
+    }
+
+    n_rx_threads = n_threads;
+
+    /*Reshard the nodes if receiver threads are already running*/
+    if(comm_topo){
+        comm_stop_workers();
+        comm_start_workers(comm_topo);
+    }
+}
 
 void
-network_start_pkt_receiver_thread(graph_t *topo){
+comm_intf_mtu_changed(interface_t *interface){
 
-    pthread_attr_t attr;
-    pthread_t recv_pkt_thread;
+    if(!comm_topo || !n_running_rx_threads)
+        return;
 
-    pthread_attr_init(&attr);
-    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    /*Restart the threads with rx buffers fitting the new MTU*/
+    if(pkt_buffer_size_for(ETH_MAX_FRAME_SIZE(IF_MTU(interface))) >
+            comm_workers[0].rx_buffer_size){
+        comm_stop_workers();
+        comm_start_workers(comm_topo);
+    }
+}
 
-    pthread_create(&recv_pkt_thread, &attr, 
-                    _network_start_pkt_receiver_thread, 
-                    (void *)topo);
+void
+network_start_pkt_receiver_thread(graph_t *topo){
+
+    if(comm_topo){
+        printf("Error : Receiver threads are already running\n");
+        return;
+    }
+    comm_topo = topo;
+    comm_start_workers(topo);
 }
 
-int
-send_pkt_to_self(char *pkt, unsigned int pkt_size,
-                interface_t *interface){
+void
+comm_close_graph(graph_t *graph){
 
-    int rc = 0;    
-    node_t *sending_node = interface->att_node;
-    node_t *nbr_node = sending_node;
-    
-    unsigned int dst_udp_port_no = nbr_node->udp_port_number;
-    
-    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+    node_t *node;
+    glthread_t *curr;
+    unsigned int i;
+    interface_t *intf;
 
-    if(sock < 0){
-        printf("Error : Sending socket Creation failed , errno = %d", errno);
-        return -1;
+    if(comm_topo == graph){
+        comm_stop_workers();
+        comm_topo = NULL;
     }
-    
-    interface_t *other_interface =  interface;
 
-    memset(send_buffer, 0, MAX_PACKET_BUFFER_SIZE);
+    ITERATE_GLTHREAD_BEGIN(&graph->node_list, curr){
+
+        node = graph_glue_to_node(curr);
 
-    char *pkt_with_aux_data = send_buffer;
+        for(i = 0; i < node->n_intf; i++){
+            intf = node->intf[i];
+            if(!intf) break;
+            /*Close every link once, from the node owning intf1*/
+            if(intf->link && intf == &intf->link->intf1)
+                node->transport->close_link(intf->link);
+        }
+    } ITERATE_GLTHREAD_END(&graph->node_list, curr);
 
-    strncpy(pkt_with_aux_data, other_interface->if_name, IF_NAME_SIZE);
+    ITERATE_GLTHREAD_BEGIN(&graph->node_list, curr){
+        node = graph_glue_to_node(curr);
+        node->transport->close_node(node);
+    } ITERATE_GLTHREAD_END(&graph->node_list, curr);
+}
 
-    pkt_with_aux_data[IF_NAME_SIZE - 1] = '\0';
+static bool_t
+comm_pkt_size_ok(interface_t *interface, unsigned int pkt_size){
 
-    memcpy(pkt_with_aux_data + IF_NAME_SIZE, pkt, pkt_size);
+    if(pkt_size > ETH_MAX_FRAME_SIZE(IF_MTU(interface))){
+        printf("Error : Node :%s, Pkt Size exceeded MTU %u of interface %s\n",
+                interface->att_node->node_name, IF_MTU(interface),
+                interface->if_name);
+        __atomic_fetch_add(&comm_n_tx_mtu_drops, 1, __ATOMIC_RELAXED);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+int
+send_pkt_to_self(char *pkt, unsigned int pkt_size,
+                interface_t *interface){
 
-    rc = _send_pkt_out(sock, pkt_with_aux_data, pkt_size + IF_NAME_SIZE, 
-                        dst_udp_port_no);
+    if(!interface->link || !comm_pkt_size_ok(interface, pkt_size))
+        return -1;
 
-    close(sock);
-    return rc; 
-       
+    return interface->att_node->transport->send_to_self(interface,
+                pkt, pkt_size);
 }
 
 /*Public APIs to be used by the other modules*/
@@ -233,64 +703,77 @@ int
 send_pkt_out(char *pkt, unsigned int pkt_size, 
              interface_t *interface){
 
-    int rc = 0;
-
-    node_t *sending_node = interface->att_node;
-    node_t *nbr_node = get_nbr_node(interface);
-    
-    if(!nbr_node)
+    if(!IF_IS_UP(interface) || !comm_pkt_size_ok(interface, pkt_size))
         return -1;
 
-    if(pkt_size + IF_NAME_SIZE > MAX_PACKET_BUFFER_SIZE){
-        printf("Error : Node :%s, Pkt Size exceeded\n", sending_node->node_name);
-        return -1;
+    /*Frame leaves the LAG through the member its flow hashes to*/
+    if(IF_LAG(interface)){
+        interface = lag_select_member(interface, pkt, pkt_size);
+        if(!interface)
+            return -1;
     }
 
-    unsigned int dst_udp_port_no = nbr_node->udp_port_number;
-    
-    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP );
-
-    if(sock < 0){
-        printf("Error : Sending socket Creation failed , errno = %d", errno);
+    if(!interface->link)
         return -1;
-    }
-    
-    interface_t *other_interface = &interface->link->intf1 == interface ? \
-                                    &interface->link->intf2 : &interface->link->intf1;
-
-    memset(send_buffer, 0, MAX_PACKET_BUFFER_SIZE);
 
-    char *pkt_with_aux_data = send_buffer;
-
-    strncpy(pkt_with_aux_data, other_interface->if_name, IF_NAME_SIZE);
+    return interface->att_node->transport->send(interface, pkt, pkt_size);
+}
 
-    pkt_with_aux_data[IF_NAME_SIZE - 1] = '\0';
+int
+send_pkt_out_batch(char **pkts, unsigned int *pkt_sizes,
+                   unsigned int n_pkts, interface_t *interface){
+
+    unsigned int i;
+    int n_sent = 0;
+
+    /*Pkts of the batch may hash to different members of the LAG*/
+    if(IF_LAG(interface)){
+        for(i = 0; i < n_pkts; i++){
+            if(send_pkt_out(pkts[i], pkt_sizes[i], interface) > 0)
+                n_sent++;
+        }
+        return n_sent;
+    }
 
-    memcpy(pkt_with_aux_data + IF_NAME_SIZE, pkt, pkt_size);
+    if(!interface->link || !IF_IS_UP(interface))
+        return -1;
 
-    rc = _send_pkt_out(sock, pkt_with_aux_data, pkt_size + IF_NAME_SIZE, 
-                        dst_udp_port_no);
+    for(i = 0; i < n_pkts; i++){
+        if(!comm_pkt_size_ok(interface, pkt_sizes[i]))
+            return -1;
+    }
 
-    close(sock);
-    return rc; 
+    return interface->att_node->transport->send_batch(interface,
+                pkts, pkt_sizes, n_pkts);
 }
 
 extern void
 layer2_frame_recv(node_t *node, interface_t *interface,
-                     char *pkt, unsigned int pkt_size);
+                  pkt_buffer_t *pkt_buf);
 
 int
 pkt_receive(node_t *node, interface_t *interface,
-            char *pkt, unsigned int pkt_size){
+            pkt_buffer_t *pkt_buf){
+
+    /*Frames in flight when the interface was shut*/
+    if(!IF_IS_UP(interface))
+        return 0;
 
-    /*Make room in the packet buffer by shifting the data towards
-      right so that tcp/ip stack can append more hdrs to the packet 
-      as required */
-    pkt = pkt_buffer_shift_right(pkt, pkt_size, 
-            MAX_PACKET_BUFFER_SIZE - IF_NAME_SIZE);
+    /*Frame received on a member of a LAG is received on the LAG*/
+    if(IF_LAG_PARENT(interface)){
+        interface = IF_LAG_PARENT(interface);
+        if(!IF_IS_UP(interface))
+            return 0;
+    }
+
+    if(pkt_buf->len > ETH_MAX_FRAME_SIZE(IF_MTU(interface))){
+        __atomic_fetch_add(&comm_n_rx_mtu_drops, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
 
-    /*Do further processing of the pkt here*/
-    layer2_frame_recv(node, interface, pkt, pkt_size );
+    /*Transports receive the frame after the headroom of the buffer,
+     * tcp/ip stack prepends the hdrs in place as required*/
+    layer2_frame_recv(node, interface, pkt_buf);
     return 0;
 }
 
@@ -301,12 +784,12 @@ send_pkt_flood(node_t *node, interface_t *exempted_intf,
     unsigned int i = 0;
     interface_t *intf; 
 
-    for( ; i < MAX_INTF_PER_NODE; i++){
+    for( ; i < node->n_intf; i++){
 
         intf = node->intf[i];
         if(!intf) return 0;
 
-        if(intf == exempted_intf)
+        if(intf == exempted_intf || IF_LAG_PARENT(intf))
             continue;
 
         send_pkt_out(pkt, pkt_size, intf);
@@ -322,12 +805,12 @@ send_pkt_flood_l2_intf_only(node_t *node,
     unsigned int i = 0;
     interface_t *intf;
 
-    for( ; i < MAX_INTF_PER_NODE; i++){
+    for( ; i < node->n_intf; i++){
 
         intf = node->intf[i];
         if(!intf) return 0;
 
-        if(intf == exempted_intf || 
+        if(intf == exempted_intf || IF_LAG_PARENT(intf) ||
             !IF_L2_MODE(intf))
             continue;
 
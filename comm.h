@@ -34,11 +34,66 @@
 #ifndef __COMM__
 #define __COMM__
 
-#define MAX_PACKET_BUFFER_SIZE   2048
+#include <stdint.h>
+
+/* Pkt buffers come in two sizes : buffers for frames up to the
+ * default MTU, and buffers for jumbo frames up to IF_MAX_MTU*/
+#define MAX_PACKET_BUFFER_SIZE          2048
+#define MAX_JUMBO_PACKET_BUFFER_SIZE    9216
+
+/*Max no of pkts drained from a socket in one go by receiver thread*/
+#define MAX_RX_BATCH_SIZE        64
+#define DEFAULT_RX_BATCH_SIZE    32
+
+/*Max no of receiver threads the nodes of the topology are sharded across*/
+#define MAX_RX_THREADS           16
+#define DEFAULT_RX_THREADS       1
+
+/* Hdr the udp transports (udp, uring) put in front of every frame
+ * sent between the nodes. Both ends of a link live on the same host,
+ * fields are in host byte order*/
+#define COMM_WIRE_HDR_VERSION   1
+#define COMM_WIRE_F_SELF        0x1     /*Sent to self, out of the link's sequence*/
+
+typedef struct comm_wire_hdr_{
+
+    uint8_t version;
+    uint8_t flags;
+    uint16_t ifindex;       /*Receiving interface, slot in node->intf[]*/
+    uint32_t seq;           /*Per direction of the link*/
+    uint64_t tx_time_ns;    /*CLOCK_MONOTONIC, when the frame was sent*/
+} comm_wire_hdr_t;
 
 typedef struct node_ node_t;
 typedef struct interface_ interface_t;
+typedef struct link_ link_t;
+typedef struct graph_ graph_t;
+typedef struct pkt_buffer_ pkt_buffer_t;
+
+/* Select the transport (udp|unix|shm|uring) of the topologies created from
+ * now on, UDP if never called*/
+int
+comm_set_transport(char *transport_name);
+
+/* Select the transport of the topology, must be called before any
+ * node is added to the topology*/
+int
+comm_set_graph_transport(graph_t *graph, char *transport_name);
 
+/*Set up the communication endpoints of a new topology/node/link*/
+void
+init_graph_comm(graph_t *graph);
+
+void
+init_node_comm(graph_t *graph, node_t *node);
+
+void
+init_link_comm(link_t *link);
+
+/* Stop the receiver threads if they serve the topology, and release
+ * the endpoints of all the nodes and links of the topology*/
+void
+comm_close_graph(graph_t *graph);
 
 int
 send_pkt_to_self(char *pkt, unsigned int pkt_size, interface_t *interface);
@@ -49,10 +104,17 @@ send_pkt_to_self(char *pkt, unsigned int pkt_size, interface_t *interface);
 int
 send_pkt_out(char *pkt, unsigned int pkt_size, interface_t *interface);
 
-/*API to recv packet from interface*/
+/* API to send a batch of packets out of the interface in one go.
+ * Returns the no of packets sent*/
+int
+send_pkt_out_batch(char **pkts, unsigned int *pkt_sizes,
+                   unsigned int n_pkts, interface_t *interface);
+
+/* API to recv packet from interface. The frame must be in a pkt
+ * buffer with PKT_BUFFER_HEADROOM bytes of room in front of it*/
 int
 pkt_receive(node_t *node, interface_t *interface, 
-            char *pkt, unsigned int pkt_size);
+            pkt_buffer_t *pkt_buf);
 
 /* API to flood the packet out of all interfaces
  * of the node*/
@@ -67,4 +129,27 @@ send_pkt_flood_l2_intf_only(node_t *node,
                             interface_t *exempted_intf,
                             char *pkt, unsigned int pkt_size);
 
+/*Set the no of pkts receiver thread drains from a socket
+ * in one go, 1 means no batching*/
+void
+comm_set_rx_batch_size(unsigned int batch_size);
+
+/* MTU of the interface has changed, receive buffers of the running
+ * receiver threads grow if they no longer fit the largest frame*/
+void
+comm_intf_mtu_changed(interface_t *interface);
+
+/*Set the no of receiver threads, nodes are resharded across
+ * the new set of threads if the threads are already running*/
+void
+comm_set_rx_threads(unsigned int n_threads);
+
+/*Total no of pkts received by the receiver threads so far*/
+unsigned long long
+comm_get_rx_pkt_count();
+
+/*Dump receive statistics of the receiver threads*/
+void
+dump_comm_stats();
+
 #endif /* __COMM__ */
@@ -0,0 +1,292 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  comm_shm.c
+ *
+ *    Description:  This file implements the in-process transport : every direction of
+ *    every link is a single producer, single consumer ring of buffer descriptors,
+ *    frames are handed over to the receiver thread of the nbr node without syscalls.
+ *
+ *        Version:  1.0
+ *        Created:  10/16/2026 04:38:02 PM
+ *       Revision:  1.0
+ *       Compiler:  gcc
+ *
+ *        This file is part of the NetworkGraph distribution (https://github.com/sachinites).
+ *        Copyright (c) 2017 Abhishek Sagar.
+ *        This program is free software: you can redistribute it and/or modify
+ *        it under the terms of the GNU General Public License as published by
+ *        the Free Software Foundation, version 3.
+ *
+ *        This program is distributed in the hope that it will be useful, but
+ *        WITHOUT ANY WARRANTY; without even the implied warranty of
+ *        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *        General Public License for more details.
+ *
+ *        You should have received a copy of the GNU General Public License
+ *        along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =====================================================================================
+ */
+
+#define _GNU_SOURCE
+#include <memory.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "comm_transport.h"
+
+/* Both ends of every link live in this process, so every direction of
+ * a link gets a single producer, single consumer ring of buffer
+ * descriptors. Sending a frame enqueues it into the ring of the
+ * receiving interface, and the receiver thread of the nbr node
+ * dequeues it, no syscalls on the data path. Besides the receiver
+ * thread of the sending node, the CLI thread may also originate pkts
+ * out of an interface, so producers of a ring serialize on a spin lock
+ * which is practically never contended, consumer side is lock free*/
+#define SHM_RING_SIZE   256     /*Must be power of 2*/
+
+typedef struct shm_ring_desc_{
+
+    pkt_buffer_t *pkt_buf;
+} shm_ring_desc_t;
+
+typedef struct shm_ring_{
+
+    /*Producer and consumer indexes on separate cache lines*/
+    unsigned int tail __attribute__((aligned(64)));
+    pthread_spinlock_t producer_lock;
+    unsigned long long n_drops;     /*Frames dropped due to ring full*/
+    unsigned int head __attribute__((aligned(64)));
+    shm_ring_desc_t desc[SHM_RING_SIZE] __attribute__((aligned(64)));
+} shm_ring_t;
+
+static shm_ring_t *
+shm_ring_create(){
+
+    shm_ring_t *ring = NULL;
+
+    if(posix_memalign((void **)&ring, 64, sizeof(shm_ring_t)))
+        return NULL;
+    memset(ring, 0, sizeof(shm_ring_t));
+    pthread_spin_init(&ring->producer_lock, PTHREAD_PROCESS_PRIVATE);
+    return ring;
+}
+
+static void
+shm_ring_free(shm_ring_t *ring){
+
+    unsigned int head;
+
+    if(!ring) return;
+
+    for(head = ring->head; head != ring->tail; head++)
+        pkt_buffer_free(ring->desc[head & (SHM_RING_SIZE - 1)].pkt_buf);
+
+    pthread_spin_destroy(&ring->producer_lock);
+    free(ring);
+}
+
+static bool_t
+shm_ring_empty(shm_ring_t *ring){
+
+    return ring->head == __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+}
+
+static void
+shm_init_node(node_t *node){
+
+    /*Rings belong to the links*/
+}
+
+static void
+shm_init_link(link_t *link){
+
+    link->intf1.tx_sock_fd = -1;
+    link->intf2.tx_sock_fd = -1;
+    link->intf1.rx_ring = shm_ring_create();
+    link->intf2.rx_ring = shm_ring_create();
+
+    if(!link->intf1.rx_ring || !link->intf2.rx_ring){
+        printf("Error : rx ring allocation failed for link %s(%s) - %s(%s)\n",
+                link->intf1.att_node->node_name, link->intf1.if_name,
+                link->intf2.att_node->node_name, link->intf2.if_name);
+    }
+}
+
+/* Enqueue copies of the frames into the rx ring of 'recv_intf', the
+ * producer lock is taken once for the whole batch. Returns the no of
+ * frames enqueued, frames which do not fit in the ring are dropped*/
+static int
+shm_enqueue(interface_t *recv_intf, char **pkts,
+            unsigned int *pkt_sizes, unsigned int n_pkts){
+
+    unsigned int i, tail, n_free;
+    pkt_buffer_t *pkt_buf;
+    shm_ring_t *ring = recv_intf->rx_ring;
+
+    if(!ring)
+        return -1;
+
+    pthread_spin_lock(&ring->producer_lock);
+
+    tail = ring->tail;
+    n_free = SHM_RING_SIZE - (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE));
+
+    for(i = 0; i < n_pkts && i < n_free; i++){
+
+        /*Stack of the receiving node prepends hdrs in the headroom*/
+        pkt_buf = pkt_buffer_alloc(pkt_sizes[i]);
+        if(!pkt_buf) break;
+
+        pkt_buffer_copy(pkt_buffer_put(pkt_buf, pkt_sizes[i]), pkts[i], pkt_sizes[i]);
+        ring->desc[tail & (SHM_RING_SIZE - 1)].pkt_buf = pkt_buf;
+        tail++;
+    }
+
+    ring->n_drops += n_pkts - i;
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+
+    pthread_spin_unlock(&ring->producer_lock);
+
+    if(i)
+        comm_schedule_node(recv_intf->att_node);
+    return i;
+}
+
+static int
+shm_send(interface_t *interface, char *pkt, unsigned int pkt_size){
+
+    if(shm_enqueue(get_nbr_interface(interface), &pkt, &pkt_size, 1) != 1)
+        return -1;
+    return pkt_size;
+}
+
+static int
+shm_send_batch(interface_t *interface, char **pkts,
+               unsigned int *pkt_sizes, unsigned int n_pkts){
+
+    return shm_enqueue(get_nbr_interface(interface), pkts, pkt_sizes, n_pkts);
+}
+
+static int
+shm_send_to_self(interface_t *interface, char *pkt, unsigned int pkt_size){
+
+    if(shm_enqueue(interface, &pkt, &pkt_size, 1) != 1)
+        return -1;
+    return pkt_size;
+}
+
+static void
+shm_poll_add(comm_worker_t *worker, node_t *node){
+
+    /*Frames may have been queued while no thread was serving the node*/
+    node->rx_scheduled = 0;
+    comm_schedule_node(node);
+}
+
+static bool_t
+shm_rx_ready(node_t *node){
+
+    unsigned int i;
+    interface_t *intf;
+
+    for(i = 0; i < node->n_intf; i++){
+        intf = node->intf[i];
+        if(!intf) break;
+        if(intf->rx_ring && !shm_ring_empty(intf->rx_ring))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/* Dequeue up to comm_rx_batch_size frames from the rx rings of all the
+ * interfaces of the node and feed them to the TCP/IP stack. Returns
+ * the no of pkts received*/
+static int
+shm_recv(comm_worker_t *worker, node_t *node){
+
+    unsigned int i, head, n_pkts = 0;
+    interface_t *intf;
+    shm_ring_t *ring;
+    shm_ring_desc_t desc;
+
+    for(i = 0; i < node->n_intf && n_pkts < comm_rx_batch_size; i++){
+
+        intf = node->intf[i];
+        if(!intf) break;
+
+        ring = intf->rx_ring;
+        if(!ring) continue;
+
+        head = ring->head;
+        while(n_pkts < comm_rx_batch_size &&
+              head != __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)){
+
+            desc = ring->desc[head & (SHM_RING_SIZE - 1)];
+            /*Release the slot to the producer before processing*/
+            __atomic_store_n(&ring->head, ++head, __ATOMIC_RELEASE);
+            pkt_receive(node, intf, desc.pkt_buf);
+            pkt_buffer_free(desc.pkt_buf);
+            n_pkts++;
+        }
+    }
+
+    if(n_pkts)
+        comm_rx_stats_update(worker, n_pkts);
+    return n_pkts;
+}
+
+static void
+shm_close_link(link_t *link){
+
+    shm_ring_free(link->intf1.rx_ring);
+    shm_ring_free(link->intf2.rx_ring);
+    link->intf1.rx_ring = NULL;
+    link->intf2.rx_ring = NULL;
+}
+
+static void
+shm_close_node(node_t *node){
+
+}
+
+static void
+shm_dump_stats(graph_t *topo){
+
+    node_t *node;
+    glthread_t *curr;
+    unsigned int i;
+    unsigned long long n_drops = 0;
+
+    ITERATE_GLTHREAD_BEGIN(&topo->node_list, curr){
+
+        node = graph_glue_to_node(curr);
+        for(i = 0; i < node->n_intf; i++){
+            if(!node->intf[i]) break;
+            if(node->intf[i]->rx_ring)
+                n_drops += node->intf[i]->rx_ring->n_drops;
+        }
+    } ITERATE_GLTHREAD_END(&topo->node_list, curr);
+
+    printf("Frames dropped, rx ring full : %llu\n", n_drops);
+}
+
+comm_transport_t shm_transport = {
+
+    .name = "shm",
+    .available = NULL,
+    .init_node = shm_init_node,
+    .init_link = shm_init_link,
+    .send = shm_send,
+    .send_batch = shm_send_batch,
+    .send_to_self = shm_send_to_self,
+    .poll_add = shm_poll_add,
+    .recv = shm_recv,
+    .rx_ready = shm_rx_ready,
+    .close_link = shm_close_link,
+    .close_node = shm_close_node,
+    .worker_init = NULL,
+    .worker_deinit = NULL,
+    .worker_poll = NULL,
+    .dump_stats = shm_dump_stats
+};
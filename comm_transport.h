@@ -0,0 +1,194 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  comm_transport.h
+ *
+ *    Description:  This file defines the interface between the communication layer
+ *    (receiver threads, send APIs) and the transports which carry the frames
+ *    between the nodes of the topology. Layer 2 and above never see this file.
+ *
+ *        Version:  1.0
+ *        Created:  10/16/2026 04:05:12 PM
+ *       Revision:  1.0
+ *       Compiler:  gcc
+ *
+ *        This file is part of the NetworkGraph distribution (https://github.com/sachinites).
+ *        Copyright (c) 2017 Abhishek Sagar.
+ *        This program is free software: you can redistribute it and/or modify
+ *        it under the terms of the GNU General Public License as published by
+ *        the Free Software Foundation, version 3.
+ *
+ *        This program is distributed in the hope that it will be useful, but
+ *        WITHOUT ANY WARRANTY; without even the implied warranty of
+ *        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *        General Public License for more details.
+ *
+ *        You should have received a copy of the GNU General Public License
+ *        along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =====================================================================================
+ */
+
+#ifndef __COMM_TRANSPORT__
+#define __COMM_TRANSPORT__
+
+/*Transports use recvmmsg()/sendmmsg(), define _GNU_SOURCE before
+ * including any system header*/
+#include <sys/socket.h>
+#include <pthread.h>
+#include <time.h>
+#include "comm.h"
+#include "graph.h"
+#include "pkt_buffer.h"
+
+/* Transports receive the datagrams (wire hdr if any, followed by the
+ * frame) at this offset of the rx buffers, so that the frame starts
+ * after the headroom of the buffer*/
+#define COMM_RX_DATA_OFFSET     (PKT_BUFFER_HEADROOM - sizeof(comm_wire_hdr_t))
+
+/*Receive batch size statistics*/
+#define RX_BATCH_HIST_BUCKETS   7  /*1, 2-3, 4-7, ... 32-63, 64+*/
+
+typedef struct rx_stats_{
+
+    unsigned long long n_recv_calls;    /*Receive calls returning data*/
+    unsigned long long n_pkts;          /*Frames received*/
+    unsigned int max_batch;             /*Largest batch seen so far*/
+    unsigned long long batch_hist[RX_BATCH_HIST_BUCKETS];
+} rx_stats_t;
+
+/* The nodes of the topology are sharded across the receiver threads,
+ * every node is served by exactly one thread, so pkts of a node are
+ * always processed in order and by one thread at a time. Independent
+ * parts of the topology forward in parallel*/
+typedef struct comm_worker_{
+
+    unsigned int worker_id;
+    pthread_t thread;
+    int epoll_fd;
+    int wakeup_fd;          /*eventfd to stop or wakeup the thread*/
+    volatile bool_t stop;
+    unsigned int n_nodes;   /*No of nodes sharded to this thread*/
+    glthread_t rx_pending_list;
+    /*Nodes scheduled for rx by other threads, see comm_schedule_node()*/
+    node_t *rx_ready_stack;
+    int sleeping;           /*Thread is blocked in epoll_wait()*/
+    /* Size of the rx buffers of the thread, fits the largest frame of
+     * the topology served, see comm_intf_mtu_changed()*/
+    unsigned int rx_buffer_size;
+    /*Receive ring of the thread, used by socket based transports*/
+    char *rx_buffers;
+    pkt_buffer_t rx_pkt_bufs[MAX_RX_BATCH_SIZE];
+    struct iovec rx_iovecs[MAX_RX_BATCH_SIZE];
+    struct mmsghdr rx_msgs[MAX_RX_BATCH_SIZE];
+    rx_stats_t rx_stats;
+    /*Transport of the topology served, and its per thread state*/
+    struct comm_transport_ *transport;
+    void *transport_ctx;
+} comm_worker_t;
+
+/* Operations every transport implements. Nodes of a topology all use
+ * the transport of the topology, so the ops are reached through
+ * node->transport on the data path*/
+typedef struct comm_transport_{
+
+    char *name;
+
+    /*Optional : Tell if the transport can be used on this host*/
+    bool_t (*available)();
+
+    /*Set up the endpoints of a new node, and of a new link between
+     * two nodes already set up*/
+    void (*init_node)(node_t *node);
+    void (*init_link)(link_t *link);
+
+    /*Send the frame(s) out of the interface to the nbr node on the
+     * other end of the link. send returns the no of bytes sent, and
+     * send_batch the no of frames sent, -1 on error*/
+    int (*send)(interface_t *interface, char *pkt, unsigned int pkt_size);
+    int (*send_batch)(interface_t *interface, char **pkts,
+                      unsigned int *pkt_sizes, unsigned int n_pkts);
+
+    /*Deliver the frame to own node as if received on the interface*/
+    int (*send_to_self)(interface_t *interface, char *pkt, unsigned int pkt_size);
+
+    /*Make the receiver thread watch the rx endpoints of the node*/
+    void (*poll_add)(comm_worker_t *worker, node_t *node);
+
+    /*Receive up to comm_rx_batch_size frames queued for the node and
+     * feed them to the TCP/IP stack. Returns the no of frames received,
+     * fewer than the batch size means nothing is left queued*/
+    int (*recv)(comm_worker_t *worker, node_t *node);
+
+    /*Optional : Transports scheduling the nodes with
+     * comm_schedule_node() tell if frames are queued for the node*/
+    bool_t (*rx_ready)(node_t *node);
+
+    /*Release the endpoints of the link/node*/
+    void (*close_link)(link_t *link);
+    void (*close_node)(node_t *node);
+
+    /*Optional : Set up/release per receiver thread state. worker_poll
+     * is called by the receiver thread when the descriptor it watches
+     * with comm_worker_watch_transport_fd() is readable*/
+    void (*worker_init)(comm_worker_t *worker);
+    void (*worker_deinit)(comm_worker_t *worker);
+    void (*worker_poll)(comm_worker_t *worker);
+
+    /*Optional : transport specific statistics*/
+    void (*dump_stats)(graph_t *topo);
+} comm_transport_t;
+
+extern comm_transport_t udp_transport;
+extern comm_transport_t unix_transport;
+extern comm_transport_t shm_transport;
+extern comm_transport_t uring_transport;
+
+/*Helpers provided by comm.c to the transports*/
+extern unsigned int comm_rx_batch_size;
+
+void
+comm_rx_stats_update(comm_worker_t *worker, unsigned int n_pkts);
+
+/*Watch fd for the node, edge triggered*/
+void
+comm_worker_watch_fd(comm_worker_t *worker, int fd, node_t *node);
+
+/*Watch fd for the transport of the thread, level triggered*/
+void
+comm_worker_watch_transport_fd(comm_worker_t *worker, int fd);
+
+/*Receiver thread the caller runs in, NULL for other threads*/
+comm_worker_t *
+comm_current_worker();
+
+/* Schedule the node on its receiver thread, for transports without
+ * a descriptor to watch. Safe to be called from any thread*/
+void
+comm_schedule_node(node_t *node);
+
+/*Raise the process descriptor limit to the hard limit*/
+void
+comm_raise_fd_limit();
+
+/*Send time of the frames, see comm_wire_hdr_t*/
+static inline uint64_t
+comm_time_ns(){
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*Helpers of the UDP transport, shared with transports using the
+ * same sockets and datagram format*/
+void
+udp_prepare_msg(struct msghdr *msg, struct iovec iov[2],
+                comm_wire_hdr_t *hdr, interface_t *oif,
+                interface_t *recv_intf, char *pkt, unsigned int pkt_size,
+                struct sockaddr_in *dest_addr);
+
+void
+udp_pkt_receive(node_t *receving_node, pkt_buffer_t *pkt_buf);
+
+#endif /* __COMM_TRANSPORT__ */
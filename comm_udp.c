@@ -0,0 +1,375 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  comm_udp.c
+ *
+ *    Description:  This file implements the UDP transport : every node owns a UDP
+ *    socket bound to a loopback port, a frame is sent to the nbr node's port as a
+ *    datagram prefixed with a wire hdr carrying the ifindex of the receiving
+ *    interface.
+ *
+ *        Version:  1.0
+ *        Created:  10/16/2026 04:11:37 PM
+ *       Revision:  1.0
+ *       Compiler:  gcc
+ *
+ *        This file is part of the NetworkGraph distribution (https://github.com/sachinites).
+ *        Copyright (c) 2017 Abhishek Sagar.
+ *        This program is free software: you can redistribute it and/or modify
+ *        it under the terms of the GNU General Public License as published by
+ *        the Free Software Foundation, version 3.
+ *
+ *        This program is distributed in the hope that it will be useful, but
+ *        WITHOUT ANY WARRANTY; without even the implied warranty of
+ *        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *        General Public License for more details.
+ *
+ *        You should have received a copy of the GNU General Public License
+ *        along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =====================================================================================
+ */
+
+#define _GNU_SOURCE /*for recvmmsg, sendmmsg*/
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h> /*for htonl*/
+#include <memory.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h> // for close
+#include "comm_transport.h"
+
+static void
+init_loopback_addr(struct sockaddr_in *addr,
+                   unsigned int udp_port_no){
+
+    memset(addr, 0, sizeof(struct sockaddr_in));
+    addr->sin_family = AF_INET;
+    addr->sin_port = udp_port_no;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+}
+
+static unsigned int udp_port_number = 40000;
+
+static unsigned int
+get_next_udp_port_number(){
+
+    return udp_port_number++;
+}
+
+static void
+init_udp_socket(node_t *node){
+
+    if(node->udp_port_number)
+        return;
+
+    comm_raise_fd_limit();
+
+    node->udp_port_number = get_next_udp_port_number();
+
+    /*Non-blocking, receiver thread drains the socket until EAGAIN*/
+    int udp_sock_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, IPPROTO_UDP );
+
+    if(udp_sock_fd == -1){
+        printf("Socket Creation Failed for node %s\n", node->node_name);
+        return;
+    }
+
+    struct sockaddr_in node_addr;
+    node_addr.sin_family      = AF_INET;
+    node_addr.sin_port        = node->udp_port_number;
+    node_addr.sin_addr.s_addr = INADDR_ANY;
+    if (bind(udp_sock_fd, (struct sockaddr *)&node_addr, sizeof(struct sockaddr)) == -1) {
+        printf("Error : socket bind failed for Node %s\n", node->node_name);
+        close(udp_sock_fd);
+        return;
+    }
+
+    node->udp_sock_fd = udp_sock_fd;
+}
+
+/* Every interface transmits the frames through the socket of its
+ * node, and caches the address of the nbr node on the other end of
+ * the link. Sharing the node's socket keeps the no of descriptors
+ * equal to the no of nodes, so that topologies with tens of thousands
+ * of nodes fit in the process descriptor limit. Both nodes of the
+ * link must have been assigned the udp port numbers before this fn
+ * is called*/
+static void
+init_intf_tx_socket(interface_t *interface){
+
+    node_t *node = interface->att_node;
+    node_t *nbr_node = get_nbr_node(interface);
+
+    if(!node->udp_sock_fd){
+        printf("Error : No socket to transmit out of interface %s of node %s\n",
+                interface->if_name, node->node_name);
+        interface->tx_sock_fd = -1;
+        return;
+    }
+
+    interface->tx_sock_fd = node->udp_sock_fd;
+    init_loopback_addr(&interface->nbr_addr, nbr_node->udp_port_number);
+}
+
+static void
+udp_init_link(link_t *link){
+
+    init_intf_tx_socket(&link->intf1);
+    init_intf_tx_socket(&link->intf2);
+}
+
+/* Prepare the datagram without copying the frame : the wire hdr
+ * telling the nbr node which of its interfaces receives the frame,
+ * in 'hdr' provided by the caller, followed by the frame from wherever
+ * the caller keeps it. Frames sent to self carry no link sequence no*/
+void
+udp_prepare_msg(struct msghdr *msg, struct iovec iov[2],
+                comm_wire_hdr_t *hdr, interface_t *oif,
+                interface_t *recv_intf, char *pkt, unsigned int pkt_size,
+                struct sockaddr_in *dest_addr){
+
+    hdr->version = COMM_WIRE_HDR_VERSION;
+    hdr->ifindex = recv_intf->ifindex;
+    if(oif == recv_intf){
+        hdr->flags = COMM_WIRE_F_SELF;
+        hdr->seq = 0;
+    }
+    else{
+        hdr->flags = 0;
+        hdr->seq = __atomic_fetch_add(&oif->tx_seq, 1, __ATOMIC_RELAXED);
+    }
+    hdr->tx_time_ns = comm_time_ns();
+
+    iov[0].iov_base = hdr;
+    iov[0].iov_len = sizeof(comm_wire_hdr_t);
+    iov[1].iov_base = pkt;
+    iov[1].iov_len = pkt_size;
+
+    memset(msg, 0, sizeof(struct msghdr));
+    msg->msg_name = dest_addr;
+    msg->msg_namelen = sizeof(struct sockaddr_in);
+    msg->msg_iov = iov;
+    msg->msg_iovlen = 2;
+}
+
+static int
+udp_send(interface_t *interface, char *pkt, unsigned int pkt_size){
+
+    struct msghdr msg;
+    struct iovec iov[2];
+    comm_wire_hdr_t hdr;
+
+    if(interface->tx_sock_fd < 0)
+        return -1;
+
+    udp_prepare_msg(&msg, iov, &hdr, interface, get_nbr_interface(interface),
+                    pkt, pkt_size, &interface->nbr_addr);
+
+    return sendmsg(interface->tx_sock_fd, &msg, 0);
+}
+
+/*Send up to MAX_RX_BATCH_SIZE frames with a single sendmmsg()*/
+static int
+udp_send_batch(interface_t *interface, char **pkts,
+               unsigned int *pkt_sizes, unsigned int n_pkts){
+
+    unsigned int i;
+    struct iovec iovecs[MAX_RX_BATCH_SIZE][2];
+    struct mmsghdr msgs[MAX_RX_BATCH_SIZE];
+    comm_wire_hdr_t hdrs[MAX_RX_BATCH_SIZE];
+    interface_t *nbr_intf = get_nbr_interface(interface);
+
+    if(interface->tx_sock_fd < 0)
+        return -1;
+
+    if(n_pkts > MAX_RX_BATCH_SIZE)
+        n_pkts = MAX_RX_BATCH_SIZE;
+
+    for(i = 0; i < n_pkts; i++){
+        udp_prepare_msg(&msgs[i].msg_hdr, iovecs[i], &hdrs[i], interface, nbr_intf,
+                        pkts[i], pkt_sizes[i], &interface->nbr_addr);
+        msgs[i].msg_len = 0;
+    }
+
+    return sendmmsg(interface->tx_sock_fd, msgs, n_pkts, 0);
+}
+
+static int
+udp_send_to_self(interface_t *interface, char *pkt, unsigned int pkt_size){
+
+    struct msghdr msg;
+    struct iovec iov[2];
+    comm_wire_hdr_t hdr;
+    struct sockaddr_in self_addr;
+    node_t *sending_node = interface->att_node;
+
+    if(interface->tx_sock_fd < 0)
+        return -1;
+
+    init_loopback_addr(&self_addr, sending_node->udp_port_number);
+
+    udp_prepare_msg(&msg, iov, &hdr, interface, interface,
+                    pkt, pkt_size, &self_addr);
+
+    return sendmsg(interface->tx_sock_fd, &msg, 0);
+}
+
+static void
+udp_poll_add(comm_worker_t *worker, node_t *node){
+
+    if(node->udp_sock_fd)
+        comm_worker_watch_fd(worker, node->udp_sock_fd, node);
+}
+
+/* Loss and reordering of the frames arriving on the interface, from
+ * the gaps in the sequence nos. A frame arriving after its successors
+ * was counted as lost, and is counted as reordered instead*/
+static void
+udp_wire_stats_update(interface_t *recv_intf, comm_wire_hdr_t *hdr){
+
+    intf_wire_stats_t *stats = &recv_intf->wire_stats;
+    int gap = (int)(hdr->seq - stats->rx_next_seq);
+    uint64_t now = comm_time_ns();
+    uint64_t latency = now > hdr->tx_time_ns ? now - hdr->tx_time_ns : 0;
+
+    stats->n_rx++;
+    if(gap >= 0){
+        stats->n_rx_lost += gap;
+        stats->rx_next_seq = hdr->seq + 1;
+    }
+    else{
+        stats->n_rx_reordered++;
+        if(stats->n_rx_lost)
+            stats->n_rx_lost--;
+    }
+
+    stats->latency_sum_ns += latency;
+    if(latency > stats->latency_max_ns)
+        stats->latency_max_ns = latency;
+}
+
+static unsigned long long udp_n_rx_bad_hdr = 0;
+
+/* pkt_buf carries the datagram : wire hdr followed by the frame*/
+void
+udp_pkt_receive(node_t *receving_node, pkt_buffer_t *pkt_buf){
+
+    comm_wire_hdr_t *hdr = (comm_wire_hdr_t *)pkt_buf->data;
+    interface_t *recv_intf;
+
+    if(pkt_buf->len < sizeof(comm_wire_hdr_t) ||
+        hdr->version != COMM_WIRE_HDR_VERSION){
+        __atomic_fetch_add(&udp_n_rx_bad_hdr, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    recv_intf = get_node_if_by_ifindex(receving_node, hdr->ifindex);
+
+    if(!recv_intf){
+        printf("Error : Pkt recvd on unknown ifindex %u on node %s\n",
+                    hdr->ifindex, receving_node->node_name);
+        return;
+    }
+
+    if(!(hdr->flags & COMM_WIRE_F_SELF))
+        udp_wire_stats_update(recv_intf, hdr);
+
+    pkt_buffer_pull(pkt_buf, sizeof(comm_wire_hdr_t));
+    pkt_receive(receving_node, recv_intf, pkt_buf);
+}
+
+/* Drain up to comm_rx_batch_size pkts queued on the node's socket with
+ * a single recvmmsg() and feed them one after another to the TCP/IP
+ * stack. Returns the no of pkts received*/
+static int
+udp_recv(comm_worker_t *worker, node_t *node){
+
+    int i, n_msgs;
+
+    n_msgs = recvmmsg(node->udp_sock_fd, worker->rx_msgs, comm_rx_batch_size,
+                      MSG_DONTWAIT, NULL);
+
+    if(n_msgs <= 0)
+        return 0;
+
+    comm_rx_stats_update(worker, n_msgs);
+
+    for(i = 0; i < n_msgs; i++){
+        pkt_buffer_set_data(&worker->rx_pkt_bufs[i],
+                worker->rx_iovecs[i].iov_base, worker->rx_msgs[i].msg_len);
+        udp_pkt_receive(node, &worker->rx_pkt_bufs[i]);
+    }
+    return n_msgs;
+}
+
+static void
+udp_close_link(link_t *link){
+
+    /*Interfaces share the socket of their node*/
+    link->intf1.tx_sock_fd = -1;
+    link->intf2.tx_sock_fd = -1;
+}
+
+static void
+udp_close_node(node_t *node){
+
+    if(node->udp_sock_fd){
+        close(node->udp_sock_fd);
+        node->udp_sock_fd = 0;
+    }
+}
+
+static void
+udp_dump_stats(graph_t *topo){
+
+    node_t *node;
+    glthread_t *curr;
+    unsigned int i;
+    intf_wire_stats_t *stats;
+    unsigned long long n_rx = 0, n_lost = 0, n_reordered = 0;
+    unsigned long long latency_sum = 0, latency_max = 0;
+
+    ITERATE_GLTHREAD_BEGIN(&topo->node_list, curr){
+
+        node = graph_glue_to_node(curr);
+        for(i = 0; i < node->n_intf; i++){
+            if(!node->intf[i]) break;
+            stats = &node->intf[i]->wire_stats;
+            n_rx += stats->n_rx;
+            n_lost += stats->n_rx_lost;
+            n_reordered += stats->n_rx_reordered;
+            latency_sum += stats->latency_sum_ns;
+            if(stats->latency_max_ns > latency_max)
+                latency_max = stats->latency_max_ns;
+        }
+    } ITERATE_GLTHREAD_END(&topo->node_list, curr);
+
+    printf("Links : Rx : %llu, lost : %llu, reordered : %llu, bad hdr : %llu\n",
+            n_rx, n_lost, n_reordered, udp_n_rx_bad_hdr);
+    printf("Links : one-way latency avg : %llu ns, max : %llu ns\n",
+            n_rx ? latency_sum / n_rx : 0, latency_max);
+}
+
+comm_transport_t udp_transport = {
+
+    .name = "udp",
+    .available = NULL,
+    .init_node = init_udp_socket,
+    .init_link = udp_init_link,
+    .send = udp_send,
+    .send_batch = udp_send_batch,
+    .send_to_self = udp_send_to_self,
+    .poll_add = udp_poll_add,
+    .recv = udp_recv,
+    .rx_ready = NULL,
+    .close_link = udp_close_link,
+    .close_node = udp_close_node,
+    .worker_init = NULL,
+    .worker_deinit = NULL,
+    .worker_poll = NULL,
+    .dump_stats = udp_dump_stats
+};
@@ -0,0 +1,200 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  comm_unix.c
+ *
+ *    Description:  This file implements the AF_UNIX transport : every link is a
+ *    datagram socketpair, each interface owns one end of the pair. The receiving
+ *    interface is implied by the socket the frame arrives on, so no wire hdr is
+ *    needed.
+ *
+ *        Version:  1.0
+ *        Created:  10/16/2026 04:26:50 PM
+ *       Revision:  1.0
+ *       Compiler:  gcc
+ *
+ *        This file is part of the NetworkGraph distribution (https://github.com/sachinites).
+ *        Copyright (c) 2017 Abhishek Sagar.
+ *        This program is free software: you can redistribute it and/or modify
+ *        it under the terms of the GNU General Public License as published by
+ *        the Free Software Foundation, version 3.
+ *
+ *        This program is distributed in the hope that it will be useful, but
+ *        WITHOUT ANY WARRANTY; without even the implied warranty of
+ *        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *        General Public License for more details.
+ *
+ *        You should have received a copy of the GNU General Public License
+ *        along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =====================================================================================
+ */
+
+#define _GNU_SOURCE /*for recvmmsg, sendmmsg*/
+#include <sys/socket.h>
+#include <memory.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h> // for close
+#include "comm_transport.h"
+
+static void
+unix_init_node(node_t *node){
+
+    /*Endpoints belong to the links*/
+}
+
+static void
+unix_init_link(link_t *link){
+
+    int sock_fds[2];
+
+    comm_raise_fd_limit();
+
+    link->intf1.tx_sock_fd = -1;
+    link->intf2.tx_sock_fd = -1;
+
+    if(socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, sock_fds) < 0){
+        printf("Error : socketpair creation failed for link %s(%s) - %s(%s), errno = %d\n",
+                link->intf1.att_node->node_name, link->intf1.if_name,
+                link->intf2.att_node->node_name, link->intf2.if_name, errno);
+        link->intf1.link_sock_fd = -1;
+        link->intf2.link_sock_fd = -1;
+        return;
+    }
+
+    link->intf1.link_sock_fd = sock_fds[0];
+    link->intf2.link_sock_fd = sock_fds[1];
+}
+
+static int
+unix_send(interface_t *interface, char *pkt, unsigned int pkt_size){
+
+    if(interface->link_sock_fd < 0)
+        return -1;
+
+    return send(interface->link_sock_fd, pkt, pkt_size, MSG_DONTWAIT);
+}
+
+/*Send up to MAX_RX_BATCH_SIZE frames with a single sendmmsg()*/
+static int
+unix_send_batch(interface_t *interface, char **pkts,
+                unsigned int *pkt_sizes, unsigned int n_pkts){
+
+    unsigned int i;
+    struct iovec iovecs[MAX_RX_BATCH_SIZE];
+    struct mmsghdr msgs[MAX_RX_BATCH_SIZE];
+
+    if(interface->link_sock_fd < 0)
+        return -1;
+
+    if(n_pkts > MAX_RX_BATCH_SIZE)
+        n_pkts = MAX_RX_BATCH_SIZE;
+
+    memset(msgs, 0, n_pkts * sizeof(struct mmsghdr));
+
+    for(i = 0; i < n_pkts; i++){
+        iovecs[i].iov_base = pkts[i];
+        iovecs[i].iov_len = pkt_sizes[i];
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    return sendmmsg(interface->link_sock_fd, msgs, n_pkts, MSG_DONTWAIT);
+}
+
+/* A socketpair end receives only what the other end sends, so frames
+ * to self are sent from the nbr's end of the link*/
+static int
+unix_send_to_self(interface_t *interface, char *pkt, unsigned int pkt_size){
+
+    return unix_send(get_nbr_interface(interface), pkt, pkt_size);
+}
+
+static void
+unix_poll_add(comm_worker_t *worker, node_t *node){
+
+    unsigned int i;
+    interface_t *intf;
+
+    for(i = 0; i < node->n_intf; i++){
+
+        intf = node->intf[i];
+        if(!intf) break;
+
+        if(intf->link_sock_fd >= 0)
+            comm_worker_watch_fd(worker, intf->link_sock_fd, node);
+    }
+}
+
+/* Drain up to comm_rx_batch_size frames queued on the sockets of all
+ * the interfaces of the node. Returns the no of pkts received*/
+static int
+unix_recv(comm_worker_t *worker, node_t *node){
+
+    int j, n_msgs;
+    unsigned int i, n_pkts = 0;
+    interface_t *intf;
+
+    for(i = 0; i < node->n_intf && n_pkts < comm_rx_batch_size; i++){
+
+        intf = node->intf[i];
+        if(!intf) break;
+
+        if(intf->link_sock_fd < 0)
+            continue;
+
+        n_msgs = recvmmsg(intf->link_sock_fd, worker->rx_msgs,
+                          comm_rx_batch_size - n_pkts, MSG_DONTWAIT, NULL);
+
+        if(n_msgs <= 0)
+            continue;
+
+        for(j = 0; j < n_msgs; j++){
+            pkt_buffer_set_data(&worker->rx_pkt_bufs[j],
+                    worker->rx_iovecs[j].iov_base, worker->rx_msgs[j].msg_len);
+            pkt_receive(node, intf, &worker->rx_pkt_bufs[j]);
+        }
+        n_pkts += n_msgs;
+    }
+
+    if(n_pkts)
+        comm_rx_stats_update(worker, n_pkts);
+    return n_pkts;
+}
+
+static void
+unix_close_link(link_t *link){
+
+    if(link->intf1.link_sock_fd >= 0)
+        close(link->intf1.link_sock_fd);
+    if(link->intf2.link_sock_fd >= 0)
+        close(link->intf2.link_sock_fd);
+    link->intf1.link_sock_fd = -1;
+    link->intf2.link_sock_fd = -1;
+}
+
+static void
+unix_close_node(node_t *node){
+
+}
+
+comm_transport_t unix_transport = {
+
+    .name = "unix",
+    .available = NULL,
+    .init_node = unix_init_node,
+    .init_link = unix_init_link,
+    .send = unix_send,
+    .send_batch = unix_send_batch,
+    .send_to_self = unix_send_to_self,
+    .poll_add = unix_poll_add,
+    .recv = unix_recv,
+    .rx_ready = NULL,
+    .close_link = unix_close_link,
+    .close_node = unix_close_node,
+    .worker_init = NULL,
+    .worker_deinit = NULL,
+    .worker_poll = NULL,
+    .dump_stats = NULL
+};
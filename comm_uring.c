@@ -0,0 +1,729 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  comm_uring.c
+ *
+ *    Description:  This file implements the io_uring transport : nodes own the same
+ *    UDP sockets as with the UDP transport, but every receiver thread keeps a multishot
+ *    receive posted on the sockets of its nodes and submits the frames it forwards in
+ *    batches, one io_uring_enter() per batch.
+ *
+ *        Version:  1.0
+ *        Created:  10/16/2026 06:02:41 PM
+ *       Revision:  1.0
+ *       Compiler:  gcc
+ *
+ *        This file is part of the NetworkGraph distribution (https://github.com/sachinites).
+ *        Copyright (c) 2017 Abhishek Sagar.
+ *        This program is free software: you can redistribute it and/or modify
+ *        it under the terms of the GNU General Public License as published by
+ *        the Free Software Foundation, version 3.
+ *
+ *        This program is distributed in the hope that it will be useful, but
+ *        WITHOUT ANY WARRANTY; without even the implied warranty of
+ *        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *        General Public License for more details.
+ *
+ *        You should have received a copy of the GNU General Public License
+ *        along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =====================================================================================
+ */
+
+#define _GNU_SOURCE
+#include <sys/socket.h>
+#include <memory.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h> // for close
+#include "comm_transport.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define URING_SUPPORTED
+#endif
+
+#ifdef URING_SUPPORTED
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+/* No liburing dependency, the rings are set up and driven with the raw
+ * syscalls. Every receiver thread owns one io_uring instance :
+ *
+ * Rx : a multishot recv is kept posted on the socket of every node of
+ * the thread. The kernel picks the receive buffers from a ring of
+ * buffers registered once by the thread (provided buffer ring), so the
+ * frames land in the same preallocated buffers over and over again, and
+ * a buffer goes back to the kernel as soon as the frame is processed.
+ *
+ * Tx : frames forwarded by the thread are queued as sendmsg requests
+ * from preallocated tx slots, and submitted together with the re-armed
+ * receives once all the completions at hand have been processed. Other
+ * threads (CLI, timers) transmit with sendto() as the UDP transport.
+ *
+ * If io_uring cannot be set up, the thread falls back to the epoll +
+ * recvmmsg() receive path of the UDP transport*/
+
+#define URING_SQ_ENTRIES    1024
+#define URING_CQ_ENTRIES    8192
+#define URING_RX_BUFFERS    4096    /*Must be power of 2*/
+#define URING_TX_SLOTS      2048
+#define URING_POLL_BUDGET   256     /*Completions processed per poll*/
+#define URING_BGID          0
+
+/*Low bits of the user_data of the requests tell the request type*/
+#define URING_UD_RECV       1ULL
+#define URING_UD_SEND       2ULL
+#define URING_UD_MASK       3ULL
+
+typedef struct uring_tx_slot_{
+
+    struct msghdr msg;
+    struct iovec iov[2];
+    comm_wire_hdr_t hdr;
+    struct uring_tx_slot_ *next;
+    char *buffer;       /*Frame being sent*/
+} uring_tx_slot_t;
+
+typedef struct uring_{
+
+    int ring_fd;
+    void *sq_ring_ptr;
+    size_t sq_ring_size;
+    void *cq_ring_ptr;
+    size_t cq_ring_size;
+
+    /*Submission queue*/
+    unsigned int *sq_khead;
+    unsigned int *sq_ktail;
+    unsigned int *sq_array;
+    unsigned int sq_mask;
+    unsigned int sq_entries;
+    unsigned int sqe_tail;          /*Includes SQEs not submitted yet*/
+    struct io_uring_sqe *sqes;
+
+    /*Completion queue*/
+    unsigned int *cq_khead;
+    unsigned int *cq_ktail;
+    unsigned int cq_mask;
+    struct io_uring_cqe *cqes;
+
+    /*Rx buffers provided to the kernel*/
+    struct io_uring_buf_ring *buf_ring;
+    unsigned int buffer_size;       /*Size of the rx buffers and tx slots*/
+    char *rx_buffers;
+    unsigned short buf_tail;
+    unsigned int n_armed;           /*Multishot receives posted*/
+    bool_t stopping;
+
+    /*Tx slots*/
+    uring_tx_slot_t *tx_slots;
+    char *tx_buffers;
+    uring_tx_slot_t *tx_free_list;
+    unsigned int n_tx_inflight;
+
+    /*Counters, folded into the global ones after every poll*/
+    unsigned long long n_tx_queued;
+    unsigned long long n_tx_sync;
+    unsigned long long n_submit_calls;
+    unsigned long long n_rearms;
+    unsigned long long n_rx_nobufs;
+} uring_t;
+
+static unsigned long long uring_n_tx_queued;
+static unsigned long long uring_n_tx_sync;
+static unsigned long long uring_n_submit_calls;
+static unsigned long long uring_n_rearms;
+static unsigned long long uring_n_rx_nobufs;
+
+static int
+sys_io_uring_setup(unsigned int entries, struct io_uring_params *params){
+
+    return syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int
+sys_io_uring_enter(int ring_fd, unsigned int to_submit,
+                   unsigned int min_complete, unsigned int flags){
+
+    return syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete,
+                   flags, NULL, 0);
+}
+
+static int
+sys_io_uring_register(int ring_fd, unsigned int opcode, void *arg,
+                      unsigned int nr_args){
+
+    return syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args);
+}
+
+static void
+uring_unmap(uring_t *ring){
+
+    if(ring->sqes)
+        munmap(ring->sqes, ring->sq_entries * sizeof(struct io_uring_sqe));
+    if(ring->cq_ring_ptr && ring->cq_ring_ptr != ring->sq_ring_ptr)
+        munmap(ring->cq_ring_ptr, ring->cq_ring_size);
+    if(ring->sq_ring_ptr)
+        munmap(ring->sq_ring_ptr, ring->sq_ring_size);
+    close(ring->ring_fd);
+}
+
+/*Create the io_uring instance and map its rings. Returns -1 on error*/
+static int
+uring_setup(uring_t *ring){
+
+    struct io_uring_params params;
+    char *sq_ptr, *cq_ptr;
+
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = URING_CQ_ENTRIES;
+
+    ring->ring_fd = sys_io_uring_setup(URING_SQ_ENTRIES, &params);
+    if(ring->ring_fd < 0)
+        return -1;
+
+    ring->sq_ring_size = params.sq_off.array +
+        params.sq_entries * sizeof(unsigned int);
+    ring->cq_ring_size = params.cq_off.cqes +
+        params.cq_entries * sizeof(struct io_uring_cqe);
+
+    if(params.features & IORING_FEAT_SINGLE_MMAP){
+        if(ring->cq_ring_size > ring->sq_ring_size)
+            ring->sq_ring_size = ring->cq_ring_size;
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    sq_ptr = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_SQ_RING);
+    if(sq_ptr == MAP_FAILED){
+        close(ring->ring_fd);
+        return -1;
+    }
+    ring->sq_ring_ptr = sq_ptr;
+
+    if(params.features & IORING_FEAT_SINGLE_MMAP){
+        cq_ptr = sq_ptr;
+    }
+    else{
+        cq_ptr = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_CQ_RING);
+        if(cq_ptr == MAP_FAILED){
+            uring_unmap(ring);
+            return -1;
+        }
+    }
+    ring->cq_ring_ptr = cq_ptr;
+
+    ring->sq_entries = params.sq_entries;
+    ring->sqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe),
+                      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->ring_fd, IORING_OFF_SQES);
+    if(ring->sqes == MAP_FAILED){
+        ring->sqes = NULL;
+        uring_unmap(ring);
+        return -1;
+    }
+
+    ring->sq_khead = (unsigned int *)(sq_ptr + params.sq_off.head);
+    ring->sq_ktail = (unsigned int *)(sq_ptr + params.sq_off.tail);
+    ring->sq_mask = *(unsigned int *)(sq_ptr + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned int *)(sq_ptr + params.sq_off.array);
+    ring->sqe_tail = *ring->sq_ktail;
+
+    ring->cq_khead = (unsigned int *)(cq_ptr + params.cq_off.head);
+    ring->cq_ktail = (unsigned int *)(cq_ptr + params.cq_off.tail);
+    ring->cq_mask = *(unsigned int *)(cq_ptr + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq_ptr + params.cq_off.cqes);
+    return 0;
+}
+
+/*Submit all the SQEs queued so far with a single syscall*/
+static void
+uring_submit(uring_t *ring){
+
+    unsigned int to_submit = ring->sqe_tail - *ring->sq_ktail;
+
+    if(!to_submit)
+        return;
+
+    __atomic_store_n(ring->sq_ktail, ring->sqe_tail, __ATOMIC_RELEASE);
+    ring->n_submit_calls++;
+
+    if(sys_io_uring_enter(ring->ring_fd, to_submit, 0, 0) < 0 &&
+        errno != EAGAIN && errno != EBUSY){
+        printf("Error : io_uring submission failed, errno = %d\n", errno);
+    }
+}
+
+static struct io_uring_sqe *
+uring_get_sqe(uring_t *ring){
+
+    unsigned int index;
+    struct io_uring_sqe *sqe;
+
+    if(ring->sqe_tail - __atomic_load_n(ring->sq_khead, __ATOMIC_ACQUIRE) >=
+            ring->sq_entries){
+        uring_submit(ring);
+        if(ring->sqe_tail - __atomic_load_n(ring->sq_khead, __ATOMIC_ACQUIRE) >=
+                ring->sq_entries)
+            return NULL;
+    }
+
+    index = ring->sqe_tail & ring->sq_mask;
+    ring->sq_array[index] = index;
+    ring->sqe_tail++;
+
+    sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    return sqe;
+}
+
+/*Hand the rx buffer back to the kernel, published by uring_buf_publish()*/
+static void
+uring_buf_add(uring_t *ring, unsigned short bid){
+
+    struct io_uring_buf *buf =
+        &ring->buf_ring->bufs[ring->buf_tail & (URING_RX_BUFFERS - 1)];
+
+    buf->addr = (unsigned long)(ring->rx_buffers + bid * ring->buffer_size +
+                                COMM_RX_DATA_OFFSET);
+    buf->len = ring->buffer_size - COMM_RX_DATA_OFFSET;
+    buf->bid = bid;
+    ring->buf_tail++;
+}
+
+static void
+uring_buf_publish(uring_t *ring){
+
+    __atomic_store_n(&ring->buf_ring->tail, ring->buf_tail, __ATOMIC_RELEASE);
+}
+
+static void
+uring_arm_recv(uring_t *ring, node_t *node){
+
+    struct io_uring_sqe *sqe = uring_get_sqe(ring);
+
+    if(!sqe){
+        printf("Error : No SQE to post receive on node %s\n", node->node_name);
+        return;
+    }
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = node->udp_sock_fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BGID;
+    sqe->user_data = (unsigned long long)(unsigned long)node | URING_UD_RECV;
+    ring->n_armed++;
+}
+
+static void
+uring_free(uring_t *ring){
+
+    free(ring->buf_ring);
+    free(ring->rx_buffers);
+    free(ring->tx_slots);
+    free(ring->tx_buffers);
+    free(ring);
+}
+
+static bool_t
+uring_available(){
+
+    static int available = -1;
+    uring_t ring;
+
+    if(available < 0){
+        memset(&ring, 0, sizeof(ring));
+        available = uring_setup(&ring) == 0;
+        if(available)
+            uring_unmap(&ring);
+    }
+    return available ? TRUE : FALSE;
+}
+
+static void
+uring_worker_init(comm_worker_t *worker){
+
+    unsigned int i;
+    struct io_uring_buf_reg reg;
+    uring_t *ring = calloc(1, sizeof(uring_t));
+
+    worker->transport_ctx = NULL;
+
+    if(!ring || uring_setup(ring) < 0){
+        printf("Info : io_uring setup failed for rx thread %u, errno = %d, "
+                "using udp rx path\n", worker->worker_id, errno);
+        free(ring);
+        return;
+    }
+
+    /*Buffers sized for the largest frame of the topology, as the rx
+     * buffers of the thread*/
+    ring->buffer_size = worker->rx_buffer_size;
+
+    if(posix_memalign((void **)&ring->buf_ring, 4096,
+                URING_RX_BUFFERS * sizeof(struct io_uring_buf)) ||
+        posix_memalign((void **)&ring->rx_buffers, 4096,
+                URING_RX_BUFFERS * ring->buffer_size)){
+        uring_unmap(ring);
+        uring_free(ring);
+        return;
+    }
+    memset(ring->buf_ring, 0, URING_RX_BUFFERS * sizeof(struct io_uring_buf));
+
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (unsigned long)ring->buf_ring;
+    reg.ring_entries = URING_RX_BUFFERS;
+    reg.bgid = URING_BGID;
+
+    if(sys_io_uring_register(ring->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0){
+        printf("Info : io_uring buffer ring registration failed for rx thread %u, "
+                "errno = %d, using udp rx path\n", worker->worker_id, errno);
+        uring_unmap(ring);
+        uring_free(ring);
+        return;
+    }
+
+    for(i = 0; i < URING_RX_BUFFERS; i++)
+        uring_buf_add(ring, i);
+    uring_buf_publish(ring);
+
+    ring->tx_slots = calloc(URING_TX_SLOTS, sizeof(uring_tx_slot_t));
+    ring->tx_buffers = malloc(URING_TX_SLOTS * ring->buffer_size);
+    for(i = 0; ring->tx_slots && ring->tx_buffers && i < URING_TX_SLOTS; i++){
+        ring->tx_slots[i].buffer = ring->tx_buffers + i * ring->buffer_size;
+        ring->tx_slots[i].next = ring->tx_free_list;
+        ring->tx_free_list = &ring->tx_slots[i];
+    }
+
+    comm_worker_watch_transport_fd(worker, ring->ring_fd);
+    worker->transport_ctx = ring;
+}
+
+static void
+uring_fold_stats(uring_t *ring){
+
+    __atomic_fetch_add(&uring_n_tx_queued, ring->n_tx_queued, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&uring_n_tx_sync, ring->n_tx_sync, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&uring_n_submit_calls, ring->n_submit_calls, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&uring_n_rearms, ring->n_rearms, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&uring_n_rx_nobufs, ring->n_rx_nobufs, __ATOMIC_RELAXED);
+    ring->n_tx_queued = ring->n_tx_sync = ring->n_submit_calls = 0;
+    ring->n_rearms = ring->n_rx_nobufs = 0;
+}
+
+/* Process up to 'budget' completions : feed the received frames to the
+ * TCP/IP stack, recycle their buffers, re-arm the receives the kernel
+ * terminated and release the tx slots of the frames sent*/
+static void
+uring_reap(comm_worker_t *worker, uring_t *ring, unsigned int budget){
+
+    unsigned int head = *ring->cq_khead;
+    unsigned int n_cqes = 0, n_pkts = 0;
+    struct io_uring_cqe cqe;
+    pkt_buffer_t pkt_buf;
+    uring_tx_slot_t *slot;
+    node_t *node;
+
+    while(n_cqes < budget &&
+          head != __atomic_load_n(ring->cq_ktail, __ATOMIC_ACQUIRE)){
+
+        cqe = ring->cqes[head & ring->cq_mask];
+        head++;
+        n_cqes++;
+
+        switch(cqe.user_data & URING_UD_MASK){
+
+            case URING_UD_RECV:
+                node = (node_t *)(unsigned long)(cqe.user_data & ~URING_UD_MASK);
+
+                if(cqe.flags & IORING_CQE_F_BUFFER){
+                    unsigned short bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+                    if(cqe.res > 0){
+                        char *buffer = ring->rx_buffers + bid * ring->buffer_size;
+                        pkt_buffer_init(&pkt_buf, buffer, ring->buffer_size);
+                        pkt_buffer_set_data(&pkt_buf,
+                                buffer + COMM_RX_DATA_OFFSET, cqe.res);
+                        udp_pkt_receive(node, &pkt_buf);
+                        n_pkts++;
+                    }
+                    uring_buf_add(ring, bid);
+                }
+
+                if(cqe.flags & IORING_CQE_F_MORE)
+                    break;
+
+                ring->n_armed--;
+
+                if(cqe.res == -EINVAL || cqe.res == -EOPNOTSUPP){
+                    /*Multishot recv not supported by the kernel*/
+                    if(!ring->stopping)
+                        comm_worker_watch_fd(worker, node->udp_sock_fd, node);
+                    break;
+                }
+
+                if(cqe.res == -ENOBUFS)
+                    ring->n_rx_nobufs++;
+
+                if(!ring->stopping){
+                    uring_arm_recv(ring, node);
+                    ring->n_rearms++;
+                }
+                break;
+
+            case URING_UD_SEND:
+                slot = (uring_tx_slot_t *)(unsigned long)(cqe.user_data & ~URING_UD_MASK);
+                slot->next = ring->tx_free_list;
+                ring->tx_free_list = slot;
+                ring->n_tx_inflight--;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    __atomic_store_n(ring->cq_khead, head, __ATOMIC_RELEASE);
+    uring_buf_publish(ring);
+
+    if(n_pkts)
+        comm_rx_stats_update(worker, n_pkts);
+}
+
+static void
+uring_worker_poll(comm_worker_t *worker){
+
+    uring_t *ring = worker->transport_ctx;
+
+    uring_reap(worker, ring, URING_POLL_BUDGET);
+    /*Frames forwarded while processing, and the re-armed receives*/
+    uring_submit(ring);
+    uring_fold_stats(ring);
+}
+
+/* Cancel the receives posted, and wait for all the requests in flight
+ * to complete before the buffers are released. Frames already received
+ * are still fed to the stack, by the calling thread*/
+static void
+uring_worker_deinit(comm_worker_t *worker){
+
+    struct io_uring_sqe *sqe;
+    uring_t *ring = worker->transport_ctx;
+    bool_t drained = TRUE;
+
+    if(!ring)
+        return;
+
+    ring->stopping = TRUE;
+
+    sqe = uring_get_sqe(ring);
+    if(sqe){
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_ALL | IORING_ASYNC_CANCEL_ANY;
+        sqe->user_data = 0;
+    }
+    uring_submit(ring);
+
+    while(ring->n_armed || ring->n_tx_inflight){
+
+        if(sys_io_uring_enter(ring->ring_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+            errno != EINTR){
+            drained = FALSE;
+            break;
+        }
+        uring_reap(worker, ring, ~0U);
+    }
+
+    uring_fold_stats(ring);
+    uring_unmap(ring);
+
+    /*Never hand memory the kernel may still write into back to malloc*/
+    if(drained)
+        uring_free(ring);
+    worker->transport_ctx = NULL;
+}
+
+static void
+uring_init_node(node_t *node){
+
+    udp_transport.init_node(node);
+}
+
+static void
+uring_init_link(link_t *link){
+
+    udp_transport.init_link(link);
+}
+
+/*Ring of the calling thread, if it is a receiver thread of this transport*/
+static uring_t *
+uring_self(){
+
+    comm_worker_t *worker = comm_current_worker();
+
+    if(!worker || worker->transport != &uring_transport)
+        return NULL;
+    return worker->transport_ctx;
+}
+
+static int
+uring_send(interface_t *interface, char *pkt, unsigned int pkt_size){
+
+    uring_tx_slot_t *slot;
+    struct io_uring_sqe *sqe;
+    uring_t *ring = uring_self();
+
+    if(interface->tx_sock_fd < 0)
+        return -1;
+
+    /*Frames bigger than the tx slots, until the thread is restarted
+     * for a new MTU, are sent right away*/
+    if(!ring || ring->stopping || !ring->tx_free_list ||
+        pkt_size > ring->buffer_size ||
+        !(sqe = uring_get_sqe(ring))){
+        if(ring) ring->n_tx_sync++;
+        return udp_transport.send(interface, pkt, pkt_size);
+    }
+
+    slot = ring->tx_free_list;
+    ring->tx_free_list = slot->next;
+    ring->n_tx_inflight++;
+
+    /*The send completes after the caller is done with the frame*/
+    pkt_buffer_copy(slot->buffer, pkt, pkt_size);
+    udp_prepare_msg(&slot->msg, slot->iov, &slot->hdr, interface,
+                    get_nbr_interface(interface), slot->buffer, pkt_size,
+                    &interface->nbr_addr);
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = interface->tx_sock_fd;
+    sqe->addr = (unsigned long)&slot->msg;
+    sqe->len = 1;
+    sqe->user_data = (unsigned long long)(unsigned long)slot | URING_UD_SEND;
+    ring->n_tx_queued++;
+    return sizeof(comm_wire_hdr_t) + pkt_size;
+}
+
+static int
+uring_send_batch(interface_t *interface, char **pkts,
+                 unsigned int *pkt_sizes, unsigned int n_pkts){
+
+    unsigned int i;
+    uring_t *ring = uring_self();
+
+    if(!ring)
+        return udp_transport.send_batch(interface, pkts, pkt_sizes, n_pkts);
+
+    for(i = 0; i < n_pkts; i++){
+        if(uring_send(interface, pkts[i], pkt_sizes[i]) < 0)
+            break;
+    }
+    return i;
+}
+
+static int
+uring_send_to_self(interface_t *interface, char *pkt, unsigned int pkt_size){
+
+    return udp_transport.send_to_self(interface, pkt, pkt_size);
+}
+
+static void
+uring_poll_add(comm_worker_t *worker, node_t *node){
+
+    uring_t *ring = worker->transport_ctx;
+
+    if(!ring){
+        udp_transport.poll_add(worker, node);
+        return;
+    }
+
+    if(!node->udp_sock_fd)
+        return;
+
+    uring_arm_recv(ring, node);
+    uring_submit(ring);
+}
+
+/*Receive path of the nodes served through epoll, see uring_reap()*/
+static int
+uring_recv(comm_worker_t *worker, node_t *node){
+
+    int n_pkts = udp_transport.recv(worker, node);
+    uring_t *ring = worker->transport_ctx;
+
+    if(ring){
+        uring_submit(ring);
+        uring_fold_stats(ring);
+    }
+    return n_pkts;
+}
+
+static void
+uring_close_link(link_t *link){
+
+    udp_transport.close_link(link);
+}
+
+static void
+uring_close_node(node_t *node){
+
+    udp_transport.close_node(node);
+}
+
+static void
+uring_dump_stats(graph_t *topo){
+
+    unsigned long long n_tx_queued = uring_n_tx_queued;
+    unsigned long long n_submit_calls = uring_n_submit_calls;
+
+    printf("io_uring : Tx queued : %llu, Tx sync (sendto) : %llu, "
+            "Submit calls : %llu (%.2f frames/call)\n",
+            n_tx_queued, uring_n_tx_sync, n_submit_calls,
+            n_submit_calls ? (double)n_tx_queued / n_submit_calls : 0);
+    printf("io_uring : Rx re-arms : %llu, Rx out of buffers : %llu\n",
+            uring_n_rearms, uring_n_rx_nobufs);
+    udp_transport.dump_stats(topo);
+}
+
+comm_transport_t uring_transport = {
+
+    .name = "uring",
+    .available = uring_available,
+    .init_node = uring_init_node,
+    .init_link = uring_init_link,
+    .send = uring_send,
+    .send_batch = uring_send_batch,
+    .send_to_self = uring_send_to_self,
+    .poll_add = uring_poll_add,
+    .recv = uring_recv,
+    .rx_ready = NULL,
+    .close_link = uring_close_link,
+    .close_node = uring_close_node,
+    .worker_init = uring_worker_init,
+    .worker_deinit = uring_worker_deinit,
+    .worker_poll = uring_worker_poll,
+    .dump_stats = uring_dump_stats
+};
+
+#else
+
+static bool_t
+uring_available(){
+
+    return FALSE;
+}
+
+/*Never selected, comm_set_transport() falls back to the UDP transport*/
+comm_transport_t uring_transport = {
+
+    .name = "uring",
+    .available = uring_available
+};
+
+#endif /* URING_SUPPORTED */
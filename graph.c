@@ -36,8 +36,39 @@
 #include <stdio.h>
 #include <memory.h>
 
+extern void
+init_graph_comm(graph_t *graph);
+
 extern void 
-init_udp_socket(node_t *node);
+init_node_comm(graph_t *graph, node_t *node);
+
+extern void
+init_link_comm(link_t *link);
+
+/* Plug the interface into the interface table of the node, growing
+ * the table if full, and assign it the next ifindex. Links are plugged
+ * in while the topology is built, before the receiver threads index
+ * the table. Node must have less than MAX_INTF_PER_NODE interfaces*/
+static void
+node_plug_interface(node_t *node, interface_t *interface){
+
+    unsigned int table_size;
+
+    assert(node->n_intf < MAX_INTF_PER_NODE);
+
+    if(node->n_intf == node->intf_table_size){
+        table_size = node->intf_table_size ?
+            node->intf_table_size * 2 : INTF_TABLE_INIT_SIZE;
+        if(table_size > MAX_INTF_PER_NODE)
+            table_size = MAX_INTF_PER_NODE;
+        node->intf = realloc(node->intf, table_size * sizeof(interface_t *));
+        assert(node->intf);
+        node->intf_table_size = table_size;
+    }
+
+    interface->ifindex = node->n_intf;
+    node->intf[node->n_intf++] = interface;
+}
 
 void
 insert_link_between_two_nodes(node_t *node1,
@@ -61,14 +92,18 @@ insert_link_between_two_nodes(node_t *node1,
     link->intf2.att_node = node2;
     link->cost = cost;
 
-    int empty_intf_slot;
+    if(node1->n_intf == MAX_INTF_PER_NODE ||
+        node2->n_intf == MAX_INTF_PER_NODE){
+        printf("Error : Link %s(%s) - %s(%s) not created, no of interfaces "
+                "exceeds %u\n", node1->node_name, from_if_name,
+                node2->node_name, to_if_name, MAX_INTF_PER_NODE);
+        free(link);
+        return;
+    }
 
     /*Plugin interface ends into Node*/
-    empty_intf_slot = get_node_intf_available_slot(node1);
-    node1->intf[empty_intf_slot] = &link->intf1;
-
-    empty_intf_slot = get_node_intf_available_slot(node2);
-    node2->intf[empty_intf_slot] = &link->intf2;
+    node_plug_interface(node1, &link->intf1);
+    node_plug_interface(node2, &link->intf2);
 
     init_intf_nw_prop(&link->intf1.intf_nw_props);
     init_intf_nw_prop(&link->intf2.intf_nw_props);
@@ -76,6 +111,43 @@ insert_link_between_two_nodes(node_t *node1,
     /*Now Assign Random generated Mac address to the Interfaces*/
     interface_assign_mac_address(&link->intf1);
     interface_assign_mac_address(&link->intf2);
+
+    /*Set up the TX/RX endpoints of both ends of the link*/
+    init_link_comm(link);
+}
+
+/* Plug an interface with no link, eg. a LAG, into the node. Like
+ * links, logical interfaces are created while the topology is built.
+ * Returns NULL if the node has an interface of the same name already*/
+interface_t *
+node_create_logical_interface(node_t *node, char *if_name){
+
+    interface_t *interface;
+
+    if(get_node_if_by_name(node, if_name)){
+        printf("Error : Node %s has interface %s already\n",
+                node->node_name, if_name);
+        return NULL;
+    }
+
+    if(node->n_intf == MAX_INTF_PER_NODE){
+        printf("Error : Interface %s(%s) not created, no of interfaces "
+                "exceeds %u\n", node->node_name, if_name, MAX_INTF_PER_NODE);
+        return NULL;
+    }
+
+    interface = calloc(1, sizeof(interface_t));
+    strncpy(interface->if_name, if_name, IF_NAME_SIZE);
+    interface->if_name[IF_NAME_SIZE - 1] = '\0';
+    interface->att_node = node;
+    /*Interface has no transport endpoints of its own*/
+    interface->tx_sock_fd = -1;
+    interface->link_sock_fd = -1;
+
+    node_plug_interface(node, interface);
+    init_intf_nw_prop(&interface->intf_nw_props);
+    interface_assign_mac_address(interface);
+    return interface;
 }
 
 graph_t *
@@ -86,9 +158,84 @@ create_new_graph(char *topology_name){
     graph->topology_name[31] = '\0';
 
     init_glthread(&graph->node_list);
+    init_graph_comm(graph);
     return graph;
 }
 
+/* FNV-1a hash of the node name, as much of it as create_graph_node()
+ * keeps*/
+static unsigned int
+node_name_hash(char *node_name){
+
+    unsigned int i, hash = 2166136261U;
+
+    for(i = 0; i < NODE_NAME_SIZE - 1 && node_name[i]; i++){
+        hash ^= (unsigned char)node_name[i];
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+static void
+node_name_hash_insert(node_t **buckets, unsigned int n_buckets,
+                      node_t *node){
+
+    unsigned int bucket = node_name_hash(node->node_name) & (n_buckets - 1);
+
+    node->name_hash_next = buckets[bucket];
+    buckets[bucket] = node;
+}
+
+/*Double the no of buckets of the node name index, rehash all the nodes*/
+static void
+node_name_hash_grow(graph_t *graph){
+
+    unsigned int i, n_buckets;
+    node_t **buckets, *node, *next;
+
+    n_buckets = graph->node_name_hash_size ?
+        graph->node_name_hash_size * 2 : NODE_NAME_HASH_INIT_SIZE;
+    buckets = calloc(n_buckets, sizeof(node_t *));
+    assert(buckets);
+
+    /*Walk the chains from the tail, so that the nodes of a bucket keep
+     * their order, newest first*/
+    for(i = 0; i < graph->node_name_hash_size; i++){
+        node_t *chain = NULL;
+        for(node = graph->node_name_hash[i]; node; node = next){
+            next = node->name_hash_next;
+            node->name_hash_next = chain;
+            chain = node;
+        }
+        for(node = chain; node; node = next){
+            next = node->name_hash_next;
+            node_name_hash_insert(buckets, n_buckets, node);
+        }
+    }
+
+    free(graph->node_name_hash);
+    graph->node_name_hash = buckets;
+    graph->node_name_hash_size = n_buckets;
+}
+
+node_t *
+get_node_by_node_name(graph_t *topo, char *node_name){
+
+    node_t *node;
+
+    if(!topo->node_name_hash_size)
+        return NULL;
+
+    node = topo->node_name_hash[node_name_hash(node_name) &
+                                (topo->node_name_hash_size - 1)];
+
+    for( ; node; node = node->name_hash_next){
+        if(strncmp(node->node_name, node_name, NODE_NAME_SIZE - 1) == 0)
+            return node;
+    }
+    return NULL;
+}
+
 node_t *
 create_graph_node(graph_t *graph, char *node_name){
 
@@ -96,11 +243,17 @@ create_graph_node(graph_t *graph, char *node_name){
     strncpy(node->node_name, node_name, NODE_NAME_SIZE);
     node->node_name[NODE_NAME_SIZE - 1] = '\0';
 
-    init_udp_socket(node);
+    init_node_comm(graph, node);
 
     init_node_nw_prop(&node->node_nw_prop);
     init_glthread(&node->graph_glue);
     glthread_add_next(&graph->node_list, &node->graph_glue);
+
+    if(graph->n_nodes == graph->node_name_hash_size)
+        node_name_hash_grow(graph);
+    node_name_hash_insert(graph->node_name_hash,
+            graph->node_name_hash_size, node);
+    graph->n_nodes++;
     return node;
 }
 
@@ -124,7 +277,7 @@ void dump_node(node_t *node){
     interface_t *intf;
 
     printf("Node Name = %s : \n", node->node_name);
-    for( ; i < MAX_INTF_PER_NODE; i++){
+    for( ; i < node->n_intf; i++){
         
         intf = node->intf[i];
         if(!intf) break;
@@ -135,6 +288,13 @@ void dump_node(node_t *node){
 void dump_interface(interface_t *interface){
 
    link_t *link = interface->link;
+
+   if(!link){
+       printf("Interface Name = %s\n\tLocal Node : %s, no link\n",
+               interface->if_name, interface->att_node->node_name);
+       return;
+   }
+
    node_t *nbr_node = get_nbr_node(interface);
 
    printf("Interface Name = %s\n\tNbr Node %s, Local Node : %s, cost = %u\n", 
@@ -38,25 +38,56 @@
 #define __GRAPH__
 
 #include <assert.h>
+#include <netinet/in.h> /*for struct sockaddr_in*/
 #include "gluethread/glthread.h"
 #include "net.h"
 
 
 #define NODE_NAME_SIZE   16
+#define NODE_NAME_HASH_INIT_SIZE    64
 #define IF_NAME_SIZE     16
-#define MAX_INTF_PER_NODE   10
+/* Interface table of a node starts with INTF_TABLE_INIT_SIZE slots
+ * and doubles as links are plugged in, up to MAX_INTF_PER_NODE, so
+ * that ifindexes fit in the wire hdr*/
+#define INTF_TABLE_INIT_SIZE    8
+#define MAX_INTF_PER_NODE       4096
 
 /*Forward Declarations*/
 typedef struct node_ node_t;
 typedef struct link_ link_t;
 
 
+/* Frames received on an interface over the udp transports, from the
+ * sequence no and send time of their wire hdr, see comm_wire_hdr_t*/
+typedef struct intf_wire_stats_{
+
+    unsigned int rx_next_seq;
+    unsigned long long n_rx;
+    unsigned long long n_rx_lost;
+    unsigned long long n_rx_reordered;
+    unsigned long long latency_sum_ns;
+    unsigned long long latency_max_ns;
+} intf_wire_stats_t;
+
 typedef struct interface_ {
 
     char if_name[IF_NAME_SIZE];
+    unsigned int ifindex;   /*Slot of the interface in att_node->intf[]*/
     struct node_ *att_node;
     struct link_ *link;
     intf_nw_props_t intf_nw_props;
+    /* Long lived socket and pre-resolved address of the nbr node,
+     * set up once at link creation time so that sending a frame
+     * out of this interface costs only a single sendto()*/
+    int tx_sock_fd;
+    struct sockaddr_in nbr_addr;
+    /*AF_UNIX transport : this end of the socketpair of the link*/
+    int link_sock_fd;
+    /*In-process transport : frames arriving on this interface*/
+    struct shm_ring_ *rx_ring;
+    /*Sequence no of the next frame sent out of this interface*/
+    unsigned int tx_seq;
+    intf_wire_stats_t wire_stats;
 } interface_t;
 
 struct link_ {
@@ -69,18 +100,42 @@ struct link_ {
 struct node_ {
 
     char node_name[NODE_NAME_SIZE];
-    interface_t *intf[MAX_INTF_PER_NODE];
+    /* Interface table, indexed by ifindex. Interfaces are never
+     * unplugged, so ifindexes are stable for the life of the node*/
+    interface_t **intf;
+    unsigned int n_intf;
+    unsigned int intf_table_size;
     glthread_t graph_glue;
     unsigned int udp_port_number;
     int udp_sock_fd;
+    /*Queued in receiver thread's list while the socket is not drained*/
+    glthread_t rx_pending_glue;
+    /*Transport of the topology, and receiver thread this node is
+     * sharded to*/
+    struct comm_transport_ *transport;
+    struct comm_worker_ *rx_worker;
+    /*Set while node is scheduled on rx_worker by other threads*/
+    int rx_scheduled;
+    struct node_ *rx_ready_next;
+    /*Next node in the same bucket of the graph's node name index*/
+    struct node_ *name_hash_next;
     node_nw_prop_t node_nw_prop;
 };
 GLTHREAD_TO_STRUCT(graph_glue_to_node, node_t, graph_glue);
+GLTHREAD_TO_STRUCT(rx_pending_glue_to_node, node_t, rx_pending_glue);
 
 typedef struct graph_{
 
     char topology_name[32];
     glthread_t node_list; 
+    /*Transport carrying the frames between the nodes*/
+    struct comm_transport_ *transport;
+    /* Index of the nodes by name, buckets are chained through
+     * node->name_hash_next. No of buckets is a power of 2, doubled
+     * when the nodes outnumber the buckets*/
+    node_t **node_name_hash;
+    unsigned int node_name_hash_size;
+    unsigned int n_nodes;
 } graph_t;
 
 node_t *
@@ -89,6 +144,9 @@ create_graph_node(graph_t *graph, char *node_name);
 graph_t *
 create_new_graph(char *topology_name);
 
+interface_t *
+node_create_logical_interface(node_t *node, char *if_name);
+
 void
 insert_link_between_two_nodes(node_t *node1, 
                              node_t *node2,
@@ -110,27 +168,37 @@ get_nbr_node(interface_t *interface){
         return link->intf1.att_node;
 }
 
-static inline int
-get_node_intf_available_slot(node_t *node){
+/*Interface on the other end of the link*/
+static inline interface_t *
+get_nbr_interface(interface_t *interface){
 
-    int i ;
-    for( i = 0 ; i < MAX_INTF_PER_NODE; i++){
-        if(node->intf[i])
-            continue;
-        return i;
-    }
-    return -1;
+    assert(interface->link);
+
+    link_t *link = interface->link;
+    if(&link->intf1 == interface)
+        return &link->intf2;
+    else
+        return &link->intf1;
 }
 
+static inline interface_t *
+get_node_if_by_ifindex(node_t *node, unsigned int ifindex){
+
+    if(ifindex >= node->n_intf)
+        return NULL;
+    return node->intf[ifindex];
+}
+
+/* Meant for the config path only : the tables of the stack refer to
+ * the interfaces by handle, never by name*/
 static inline interface_t *
 get_node_if_by_name(node_t *node, char *if_name){
 
-    int i ;
+    unsigned int i ;
     interface_t *intf;
 
-    for( i = 0 ; i < MAX_INTF_PER_NODE; i++){
+    for( i = 0 ; i < node->n_intf; i++){
         intf = node->intf[i];
-        if(!intf) return NULL;
         if(strncmp(intf->if_name, if_name, IF_NAME_SIZE) == 0){
             return intf;
         }
@@ -138,20 +206,9 @@ get_node_if_by_name(node_t *node, char *if_name){
     return NULL;
 }
 
-static inline node_t *
-get_node_by_node_name(graph_t *topo, char *node_name){
-
-    node_t *node;
-    glthread_t *curr;    
-
-    ITERATE_GLTHREAD_BEGIN(&topo->node_list, curr){
-
-        node = graph_glue_to_node(curr);
-        if(strncmp(node->node_name, node_name, strlen(node_name)) == 0)
-            return node;
-    } ITERATE_GLTHREAD_END(&topo->node_list, curr);
-    return NULL;
-}
+/*Node of the topology named exactly 'node_name', NULL if none*/
+node_t *
+get_node_by_node_name(graph_t *topo, char *node_name);
 
 /*Display Routines*/
 void dump_graph(graph_t *graph);
@@ -31,10 +31,13 @@
  */
 
 #include "graph.h"
+#include "comm.h"
 #include <memory.h>
 #include "utils.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <pthread.h>
+#include "WheelTimer/WheelTimer.h"
 
 /*Just some Random number generator*/
 static unsigned int
@@ -70,6 +73,9 @@ interface_assign_mac_address(interface_t *interface){
 
 typedef struct l3_route_ l3_route_t;
 
+extern void
+dump_lag(interface_t *lag_intf);
+
 extern void
 rt_table_add_direct_route(rt_table_t *rt_table, char *ip_addr, char mask); 
 
@@ -92,11 +98,20 @@ bool_t node_set_intf_ip_address(node_t *node, char *local_if,
     interface_t *interface = get_node_if_by_name(node, local_if);
     if(!interface) assert(0);
 
+    if(IF_LAG_PARENT(interface)){
+        printf("Error : Interface %s is a member of %s\n",
+                interface->if_name, IF_LAG_PARENT(interface)->if_name);
+        return FALSE;
+    }
+
     strncpy(IF_IP(interface), ip_addr, 16);
     IF_IP(interface)[15] = '\0';
     interface->intf_nw_props.mask = mask; 
     interface->intf_nw_props.is_ipadd_config = TRUE;
     rt_table_add_direct_route(NODE_RT_TABLE(node), ip_addr, mask);
+    /*Interface in L3 mode floods no frames*/
+    l2_switch_rebuild_flood_lists(node);
+    stp_intf_state_changed(interface);
     return TRUE;
 }
 
@@ -105,6 +120,60 @@ bool_t node_unset_intf_ip_address(node_t *node, char *local_if){
     return TRUE;
 }
 
+/* Frames are dropped when sent out of or received on an interface
+ * with a payload bigger than the MTU of the interface. Receive buffers
+ * of the running receiver threads are resized to fit the frames of the
+ * new MTU*/
+bool_t interface_set_mtu(interface_t *interface, unsigned int mtu){
+
+    if(mtu < IF_MIN_MTU || mtu > IF_MAX_MTU){
+        printf("Error : MTU must be in range [%u-%u]\n", IF_MIN_MTU, IF_MAX_MTU);
+        return FALSE;
+    }
+
+    IF_MTU(interface) = mtu;
+    comm_intf_mtu_changed(interface);
+    return TRUE;
+}
+
+/*State of the link of the interface changed, at either end*/
+static void
+interface_link_state_changed(interface_t *interface){
+
+    /*Flows of the member fail over to the other members of its LAG*/
+    if(IF_LAG_PARENT(interface))
+        lag_member_state_changed(interface);
+    else
+        stp_intf_state_changed(interface);
+}
+
+/* Interface which is shut sends and receives no frames, the link is
+ * down for the nbr too. LAG which is shut is down with all its members*/
+void interface_set_admin_state(interface_t *interface, bool_t up){
+
+    if(IF_IS_UP(interface) == up)
+        return;
+
+    IF_IS_UP(interface) = up;
+
+    if(IF_LAG(interface)){
+        lag_admin_state_changed(interface);
+        return;
+    }
+
+    interface_link_state_changed(interface);
+    if(interface->link)
+        interface_link_state_changed(get_nbr_interface(interface));
+}
+
+bool_t node_set_intf_mtu(node_t *node, char *local_if, unsigned int mtu){
+
+    interface_t *interface = get_node_if_by_name(node, local_if);
+    if(!interface) assert(0);
+
+    return interface_set_mtu(interface, mtu);
+}
+
 void dump_node_nw_props(node_t *node){
 
     printf("\nNode Name = %s, udp_port_no = %u\n", node->node_name, node->udp_port_number);
@@ -119,7 +188,26 @@ void dump_intf_props(interface_t *interface){
 
     dump_interface(interface);
 
-    if(interface->intf_nw_props.is_ipadd_config){
+    printf("\t ifindex = %u, MTU = %u%s\n", interface->ifindex, IF_MTU(interface),
+            IF_IS_UP(interface) ? "" : ", shutdown");
+
+    if(IF_LAG(interface))
+        dump_lag(interface);
+
+    intf_wire_stats_t *wire_stats = &interface->wire_stats;
+    if(wire_stats->n_rx){
+        printf("\t Rx frames = %llu, lost = %llu, reordered = %llu, "
+                "latency avg = %llu ns, max = %llu ns\n",
+                wire_stats->n_rx, wire_stats->n_rx_lost,
+                wire_stats->n_rx_reordered,
+                wire_stats->latency_sum_ns / wire_stats->n_rx,
+                wire_stats->latency_max_ns);
+    }
+
+    if(IF_LAG_PARENT(interface)){
+        printf("\t member of %s\n", IF_LAG_PARENT(interface)->if_name);
+    }
+    else if(interface->intf_nw_props.is_ipadd_config){
         printf("\t IP Addr = %s/%u", IF_IP(interface), interface->intf_nw_props.mask);
         printf("\t MAC : %u:%u:%u:%u:%u:%u\n", 
                 IF_MAC(interface)[0], IF_MAC(interface)[1],
@@ -129,10 +217,15 @@ void dump_intf_props(interface_t *interface){
     else{
          printf("\t l2 mode = %s", intf_l2_mode_str(IF_L2_MODE(interface)));
          printf("\t vlan membership : ");
-         int i = 0;
-         for(; i < MAX_VLAN_MEMBERSHIP; i++){
-            if(interface->intf_nw_props.vlans[i]){
-                printf("%u  ", interface->intf_nw_props.vlans[i]);
+         if(IF_L2_MODE(interface) == ACCESS && IF_ACCESS_VLAN(interface)){
+            printf("%u  ", IF_ACCESS_VLAN(interface));
+         }
+         else if(IF_L2_MODE(interface) == TRUNK){
+            unsigned int vlan_id = VLAN_ID_MIN;
+            for(; vlan_id <= VLAN_ID_MAX; vlan_id++){
+                if(IF_IS_VLAN_SET(interface, vlan_id)){
+                    printf("%u  ", vlan_id);
+                }
             }
          }
          printf("\n");
@@ -152,7 +245,7 @@ void dump_nw_graph(graph_t *graph){
 
         node = graph_glue_to_node(curr);
         dump_node_nw_props(node);
-        for( i = 0; i < MAX_INTF_PER_NODE; i++){
+        for( i = 0; i < node->n_intf; i++){
             interface = node->intf[i];
             if(!interface) break;
             dump_intf_props(interface);
@@ -175,7 +268,7 @@ node_get_matching_subnet_interface(node_t *node, char *ip_addr){
     char intf_subnet[16];
     char subnet2[16];
 
-    for( ; i < MAX_INTF_PER_NODE; i++){
+    for( ; i < node->n_intf; i++){
     
         intf = node->intf[i];
         if(!intf) return NULL;
@@ -207,7 +300,7 @@ get_access_intf_operating_vlan_id(interface_t *interface){
         assert(0);
     }
 
-    return interface->intf_nw_props.vlans[0];
+    return IF_ACCESS_VLAN(interface);
 }
 
 
@@ -220,52 +313,26 @@ is_trunk_interface_vlan_enabled(interface_t *interface,
         assert(0);
     }
 
-    unsigned int i = 0;
-
-    for( ; i < MAX_VLAN_MEMBERSHIP; i++){
+    if(vlan_id > VLAN_ID_MAX)
+        return FALSE;
 
-        if(interface->intf_nw_props.vlans[i] == vlan_id)
-            return TRUE;
-    }
-    return FALSE;
+    return IF_IS_VLAN_SET(interface, vlan_id);
 }
 
-/*When pkt moves from top to down in TCP/IP stack, we would need
-  room in the pkt buffer to attach more new headers. Below function
-  simply shifts the pkt content present in the start of the pkt buffer
-  towards right so that new room is created*/
-char *
-pkt_buffer_shift_right(char *pkt, unsigned int pkt_size, 
-                       unsigned int total_buffer_size){
 
-    char *temp = NULL;
-    bool_t need_temp_memory = FALSE;
+static wheel_timer_t *nw_timer;
+static pthread_once_t nw_timer_once = PTHREAD_ONCE_INIT;
 
-    if(pkt_size * 2 > total_buffer_size){
-        need_temp_memory = TRUE;
-    }
-    
-    if(need_temp_memory){
-        temp = calloc(1, pkt_size);
-        memcpy(temp, pkt, pkt_size);
-        memset(pkt, 0, total_buffer_size);
-        memcpy(pkt + (total_buffer_size - pkt_size), temp, pkt_size);
-        free(temp);
-        return pkt + (total_buffer_size - pkt_size);
-    }
-    
-    memcpy(pkt + (total_buffer_size - pkt_size), pkt, pkt_size);
-    memset(pkt, 0, pkt_size);
-    return pkt + (total_buffer_size - pkt_size);
+static void
+nw_timer_init(){
+
+    nw_timer = init_wheel_timer(NW_TIMER_WHEEL_SIZE, NW_TIMER_TICK_SEC);
+    start_wheel_timer(nw_timer);
 }
 
-bool_t 
-pkt_buffer_check_additional_hdr_space(unsigned int pkt_size, 
-                           unsigned int total_buffer_size,
-                           unsigned int additional_space_requested){
+wheel_timer_t *
+nw_get_timer(){
 
-    if(total_buffer_size - pkt_size > additional_space_requested)
-        return TRUE;
-    return FALSE;
+    pthread_once(&nw_timer_once, nw_timer_init);
+    return nw_timer;
 }
-
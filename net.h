@@ -55,6 +55,11 @@ typedef struct mac_add_ {
 typedef struct arp_table_ arp_table_t;
 typedef struct mac_table_ mac_table_t;
 typedef struct rt_table_ rt_table_t;
+typedef struct l2_flood_table_ l2_flood_table_t;
+typedef struct stp_bridge_ stp_bridge_t;
+typedef struct stp_port_ stp_port_t;
+typedef struct lag_ lag_t;
+typedef struct arp_suppr_table_ arp_suppr_table_t;
 
 typedef struct node_nw_prop_{
 
@@ -66,6 +71,9 @@ typedef struct node_nw_prop_{
     arp_table_t *arp_table;
     mac_table_t *mac_table;     
     rt_table_t *rt_table;
+    l2_flood_table_t *flood_table;  /*NULL until an interface is in L2 mode*/
+    stp_bridge_t *stp_bridge;       /*NULL until an interface is in L2 mode*/
+    arp_suppr_table_t *arp_suppr_table; /*NULL until ARP suppression is enabled*/
     /*L3 properties*/ 
     bool_t is_lb_addr_config;
     ip_add_t lb_addr; /*loopback address of node*/
@@ -75,6 +83,12 @@ typedef struct node_nw_prop_{
 extern void init_arp_table(arp_table_t **arp_table);
 extern void init_mac_table(mac_table_t **mac_table);
 extern void init_rt_table(rt_table_t **rt_table);
+extern void l2_switch_rebuild_flood_lists(node_t *node);
+extern void stp_intf_state_changed(interface_t *interface);
+extern void lag_member_state_changed(interface_t *interface);
+extern void lag_admin_state_changed(interface_t *interface);
+extern interface_t *lag_select_member(interface_t *interface,
+                                      char *pkt, unsigned int pkt_size);
 
 static inline void
 init_node_nw_prop(node_nw_prop_t *node_nw_prop) {
@@ -85,6 +99,9 @@ init_node_nw_prop(node_nw_prop_t *node_nw_prop) {
     init_arp_table(&(node_nw_prop->arp_table));
     init_mac_table(&(node_nw_prop->mac_table));
     init_rt_table(&(node_nw_prop->rt_table));
+    node_nw_prop->flood_table = NULL;
+    node_nw_prop->stp_bridge = NULL;
+    node_nw_prop->arp_suppr_table = NULL;
 }
 
 typedef enum{
@@ -107,15 +124,37 @@ intf_l2_mode_str(intf_l2_mode_t intf_l2_mode){
     }
 }
 
-#define MAX_VLAN_MEMBERSHIP 10
+/*802.1Q vlan ids are 12 bits, 0 and 4095 are reserved*/
+#define VLAN_ID_MIN         1
+#define VLAN_ID_MAX         4094
+#define VLAN_BITMAP_WORDS   (4096 / 64)
+
+#define MAC_TABLE_DEF_AGING_TIME    300     /*sec*/
+#define MAC_TABLE_MAX_AGING_TIME    1000000 /*sec*/
+
+#define STP_DEF_BRIDGE_PRIORITY     32768
+
+#define IF_DEFAULT_MTU      1500
+#define IF_MIN_MTU          64
+#define IF_MAX_MTU          9000    /*Jumbo frames*/
+
+/* Largest frame sent out of an interface with the MTU : ethernet hdr
+ * with 802.1Q hdr (18 bytes), payload of MTU bytes and FCS (4 bytes)*/
+#define ETH_MAX_FRAME_SIZE(mtu) ((mtu) + 22)
 
 typedef struct intf_nw_props_ {
 
     /*L2 properties*/
     mac_add_t mac_add;              /*Mac are hard burnt in interface NIC*/
     intf_l2_mode_t  intf_l2_mode;   /*if IP-address is configured on this interface, then this should be set to UNKNOWN*/
-    unsigned int vlans[MAX_VLAN_MEMBERSHIP];    /*If the interface is operating in Trunk mode, it can be a member of these many vlans*/
+    unsigned int access_vlan;       /*Vlan of the interface operating in Access mode, 0 if none*/
+    uint64_t vlan_bitmap[VLAN_BITMAP_WORDS];   /*Vlans of the interface operating in Trunk mode, one bit per vlan id*/
     bool_t is_ipadd_config_backup;
+    unsigned int mtu;               /*Largest ethernet payload sent or received*/
+    bool_t is_up;                   /*Admin state, FALSE if shut down*/
+    stp_port_t *stp_port;           /*Spanning tree state of the interface in L2 mode*/
+    lag_t *lag;                     /*Set on LAG interfaces only*/
+    interface_t *lag_parent;        /*LAG the interface is a member of, NULL if none*/
 
     /*L3 properties*/
     bool_t is_ipadd_config; 
@@ -131,7 +170,13 @@ init_intf_nw_prop(intf_nw_props_t *intf_nw_props) {
     memset(intf_nw_props->mac_add.mac , 0 , 
         sizeof(intf_nw_props->mac_add.mac));
     intf_nw_props->intf_l2_mode = L2_MODE_UNKNOWN;
-    memset(intf_nw_props->vlans, 0, sizeof(intf_nw_props->vlans));
+    intf_nw_props->access_vlan = 0;
+    memset(intf_nw_props->vlan_bitmap, 0, sizeof(intf_nw_props->vlan_bitmap));
+    intf_nw_props->mtu = IF_DEFAULT_MTU;
+    intf_nw_props->is_up = TRUE;
+    intf_nw_props->stp_port = NULL;
+    intf_nw_props->lag = NULL;
+    intf_nw_props->lag_parent = NULL;
 
     /*L3 properties*/
     intf_nw_props->is_ipadd_config = FALSE;
@@ -151,15 +196,38 @@ interface_assign_mac_address(interface_t *interface);
 #define NODE_ARP_TABLE(node_ptr)    (node_ptr->node_nw_prop.arp_table)
 #define NODE_MAC_TABLE(node_ptr)    (node_ptr->node_nw_prop.mac_table)
 #define NODE_RT_TABLE(node_ptr)     (node_ptr->node_nw_prop.rt_table)
+#define NODE_FLOOD_TABLE(node_ptr)  (node_ptr->node_nw_prop.flood_table)
+#define NODE_STP_BRIDGE(node_ptr)   (node_ptr->node_nw_prop.stp_bridge)
+#define NODE_ARP_SUPPR_TABLE(node_ptr)  (node_ptr->node_nw_prop.arp_suppr_table)
 #define NODE_FLAGS(node_ptr)        (node_ptr->node_nw_prop.flags)
 #define IF_L2_MODE(intf_ptr)    (intf_ptr->intf_nw_props.intf_l2_mode)
+#define IF_MTU(intf_ptr)        (intf_ptr->intf_nw_props.mtu)
+#define IF_IS_UP(intf_ptr)      (intf_ptr->intf_nw_props.is_up)
+#define IF_STP_PORT(intf_ptr)   (intf_ptr->intf_nw_props.stp_port)
+#define IF_LAG(intf_ptr)        (intf_ptr->intf_nw_props.lag)
+#define IF_LAG_PARENT(intf_ptr) (intf_ptr->intf_nw_props.lag_parent)
 #define IS_INTF_L3_MODE(intf_ptr)   (intf_ptr->intf_nw_props.is_ipadd_config == TRUE)
+#define IF_ACCESS_VLAN(intf_ptr)    (intf_ptr->intf_nw_props.access_vlan)
+
+/*Trunk vlan membership, vlan_id must be in range [0-4095]*/
+#define IF_VLAN_WORD(intf_ptr, vlan_id) \
+    ((intf_ptr)->intf_nw_props.vlan_bitmap[(vlan_id) >> 6])
+#define VLAN_BIT(vlan_id)   (1ULL << ((vlan_id) & 63))
+#define IF_SET_VLAN(intf_ptr, vlan_id)  \
+    (IF_VLAN_WORD(intf_ptr, vlan_id) |= VLAN_BIT(vlan_id))
+#define IF_UNSET_VLAN(intf_ptr, vlan_id)    \
+    (IF_VLAN_WORD(intf_ptr, vlan_id) &= ~VLAN_BIT(vlan_id))
+#define IF_IS_VLAN_SET(intf_ptr, vlan_id)   \
+    ((IF_VLAN_WORD(intf_ptr, vlan_id) & VLAN_BIT(vlan_id)) != 0)
 
 
 /*APIs to set Network Node properties*/
 bool_t node_set_loopback_address(node_t *node, char *ip_addr);
 bool_t node_set_intf_ip_address(node_t *node, char *local_if, char *ip_addr, char mask);
 bool_t node_unset_intf_ip_address(node_t *node, char *local_if);
+bool_t node_set_intf_mtu(node_t *node, char *local_if, unsigned int mtu);
+bool_t interface_set_mtu(interface_t *interface, unsigned int mtu);
+void interface_set_admin_state(interface_t *interface, bool_t up);
 
 
 /*Dumping Functions to dump network information
@@ -182,13 +250,14 @@ get_access_intf_operating_vlan_id(interface_t *interface);
 bool_t
 is_trunk_interface_vlan_enabled(interface_t *interface, unsigned int vlan_id);  
 
-char *
-pkt_buffer_shift_right(char *pkt, unsigned int pkt_size,
-                               unsigned int total_buffer_size);
+/* Wheel timer driving the protocol timers of all the nodes (MAC aging
+ * etc), started on first use. Time intervals are in sec*/
+#define NW_TIMER_TICK_SEC       1
+#define NW_TIMER_WHEEL_SIZE     60
 
-bool_t
-pkt_buffer_check_additional_hdr_space(unsigned int pkt_size,
-        unsigned int total_buffer_size,
-        unsigned int additional_space_requested);
+typedef struct _wheel_timer_t wheel_timer_t;
+
+wheel_timer_t *
+nw_get_timer();
 
 #endif /* __NET__ */
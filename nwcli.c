@@ -31,6 +31,8 @@
  */
 
 #include "graph.h"
+#include "comm.h"
+#include "pkt_buffer.h"
 #include <stdio.h>
 #include "CommandParser/libcli.h"
 #include "CommandParser/cmdtlv.h"
@@ -72,12 +74,36 @@ validate_vlan_id(char *vlan_value){
         printf("Error : Invalid Vlan Value\n");
         return VALIDATION_FAILED;
     }
-    if(vlan >= 1 && vlan <= 4095)
+    if(vlan >= VLAN_ID_MIN && vlan <= VLAN_ID_MAX)
         return VALIDATION_SUCCESS;
 
     return VALIDATION_FAILED;
 }
 
+static int
+validate_mtu_value(char *mtu_value){
+
+    unsigned int mtu = atoi(mtu_value);
+
+    if(mtu >= IF_MIN_MTU && mtu <= IF_MAX_MTU)
+        return VALIDATION_SUCCESS;
+
+    printf("Error : MTU must be in range [%u-%u]\n", IF_MIN_MTU, IF_MAX_MTU);
+    return VALIDATION_FAILED;
+}
+
+static int
+validate_lag_hash_value(char *lag_hash_value){
+
+    if(strcmp(lag_hash_value, "l2") == 0 ||
+        strcmp(lag_hash_value, "l3") == 0 ||
+        strcmp(lag_hash_value, "l4") == 0)
+        return VALIDATION_SUCCESS;
+
+    printf("Error : LAG hash must be one of l2|l3|l4\n");
+    return VALIDATION_FAILED;
+}
+
 int
 validate_l2_mode_value(char *l2_mode_value){
 
@@ -87,6 +113,26 @@ validate_l2_mode_value(char *l2_mode_value){
     return VALIDATION_FAILED;
 }
 
+int
+validate_rx_batch_size(char *batch_size_str){
+
+    unsigned int batch_size = atoi(batch_size_str);
+    if(batch_size >= 1 && batch_size <= MAX_RX_BATCH_SIZE)
+        return VALIDATION_SUCCESS;
+    printf("Error : Invalid Batch Size, Allowed range [1-%u]\n", MAX_RX_BATCH_SIZE);
+    return VALIDATION_FAILED;
+}
+
+int
+validate_rx_threads(char *n_threads_str){
+
+    unsigned int n_threads = atoi(n_threads_str);
+    if(n_threads >= 1 && n_threads <= MAX_RX_THREADS)
+        return VALIDATION_SUCCESS;
+    printf("Error : Invalid no of threads, Allowed range [1-%u]\n", MAX_RX_THREADS);
+    return VALIDATION_FAILED;
+}
+
 int
 validate_mask_value(char *mask_str){
 
@@ -120,6 +166,79 @@ show_nw_topology_handler(param_t *param, ser_buff_t *tlv_buf, op_mode enable_or_
 }
 
 
+/*Communication Layer Commands*/
+static int
+show_comm_handler(param_t *param, ser_buff_t *tlv_buf, op_mode enable_or_disable){
+
+    int CMDCODE = -1;
+    CMDCODE = EXTRACT_CMD_CODE(tlv_buf);
+
+    switch(CMDCODE){
+
+        case CMDCODE_SHOW_COMM_STATS:
+            dump_comm_stats();
+            break;
+        case CMDCODE_SHOW_COMM_PKT_BUFFERS:
+            dump_pkt_buffer_pool_stats();
+            break;
+        default:
+            ;
+    }
+    return 0;
+}
+
+static int
+comm_config_handler(param_t *param, ser_buff_t *tlv_buf, op_mode enable_or_disable){
+
+    int CMDCODE = -1;
+    unsigned int batch_size = DEFAULT_RX_BATCH_SIZE;
+    unsigned int n_threads = DEFAULT_RX_THREADS;
+    tlv_struct_t *tlv = NULL;
+
+    CMDCODE = EXTRACT_CMD_CODE(tlv_buf);
+
+    TLV_LOOP_BEGIN(tlv_buf, tlv){
+
+        if(strncmp(tlv->leaf_id, "batch-size", strlen("batch-size")) ==0)
+            batch_size = atoi(tlv->value);
+        else if(strncmp(tlv->leaf_id, "n-threads", strlen("n-threads")) ==0)
+            n_threads = atoi(tlv->value);
+        else
+            assert(0);
+    } TLV_LOOP_END;
+
+    switch(CMDCODE){
+        case CMDCODE_CONF_COMM_RX_BATCH:
+            switch(enable_or_disable){
+                case CONFIG_ENABLE:
+                    comm_set_rx_batch_size(batch_size);
+                    break;
+                case CONFIG_DISABLE:
+                    comm_set_rx_batch_size(DEFAULT_RX_BATCH_SIZE);
+                    break;
+                default:
+                    ;
+            }
+            break;
+        case CMDCODE_CONF_COMM_RX_THREADS:
+            switch(enable_or_disable){
+                case CONFIG_ENABLE:
+                    comm_set_rx_threads(n_threads);
+                    break;
+                case CONFIG_DISABLE:
+                    comm_set_rx_threads(DEFAULT_RX_THREADS);
+                    break;
+                default:
+                    ;
+            }
+            break;
+        default:
+            ;
+    }
+    return 0;
+}
+
+
 /*Layer 2 Commands*/
 
 typedef struct arp_table_ arp_table_t;
@@ -169,6 +288,52 @@ show_mac_handler(param_t *param, ser_buff_t *tlv_buf,
     return 0;
 }
 
+extern void
+dump_stp_bridge(node_t *node);
+
+static int
+show_stp_handler(param_t *param, ser_buff_t *tlv_buf,
+                    op_mode enable_or_disable){
+
+    node_t *node;
+    char *node_name;
+    tlv_struct_t *tlv = NULL;
+    
+    TLV_LOOP_BEGIN(tlv_buf, tlv){
+
+        if(strncmp(tlv->leaf_id, "node-name", strlen("node-name")) ==0)
+            node_name = tlv->value;
+
+    }TLV_LOOP_END;
+
+    node = get_node_by_node_name(topo, node_name);
+    dump_stp_bridge(node);
+    return 0;
+}
+
+extern void
+dump_arp_suppr_table(node_t *node);
+
+static int
+show_arp_suppr_handler(param_t *param, ser_buff_t *tlv_buf,
+                    op_mode enable_or_disable){
+
+    node_t *node;
+    char *node_name;
+    tlv_struct_t *tlv = NULL;
+    
+    TLV_LOOP_BEGIN(tlv_buf, tlv){
+
+        if(strncmp(tlv->leaf_id, "node-name", strlen("node-name")) ==0)
+            node_name = tlv->value;
+
+    }TLV_LOOP_END;
+
+    node = get_node_by_node_name(topo, node_name);
+    dump_arp_suppr_table(node);
+    return 0;
+}
+
 
 
 extern void
@@ -275,7 +440,7 @@ delete_rt_table_entry(rt_table_t *rt_table,
 extern void
 rt_table_add_route(rt_table_t *rt_table,
         char *dst, char mask,
-        char *gw, char *oif);
+        char *gw, interface_t *oif);
 
 static int
 l3_config_handler(param_t *param, ser_buff_t *tlv_buf, op_mode enable_or_disable){
@@ -321,7 +486,7 @@ l3_config_handler(param_t *param, ser_buff_t *tlv_buf, op_mode enable_or_disable
             switch(enable_or_disable){
                 case CONFIG_ENABLE:
                 {
-                    interface_t *intf;
+                    interface_t *intf = NULL;
                     if(intf_name){
                         intf = get_node_if_by_name(node, intf_name);
                         if(!intf){
@@ -333,7 +498,7 @@ l3_config_handler(param_t *param, ser_buff_t *tlv_buf, op_mode enable_or_disable
                             return -1;
                         }
                     }
-                    rt_table_add_route(NODE_RT_TABLE(node), dest, mask, gwip, intf_name);
+                    rt_table_add_route(NODE_RT_TABLE(node), dest, mask, gwip, intf);
                 }
                 break;
                 case CONFIG_DISABLE:
@@ -350,6 +515,86 @@ l3_config_handler(param_t *param, ser_buff_t *tlv_buf, op_mode enable_or_disable
 }
 
 
+/*L2 switch Commands*/
+extern bool_t
+mac_table_set_aging_time(mac_table_t *mac_table, unsigned int aging_time);
+extern bool_t
+stp_set_bridge_priority(node_t *node, unsigned int priority);
+extern void
+l2_switch_set_arp_suppression(node_t *node, bool_t enable);
+
+static int
+l2_config_handler(param_t *param, ser_buff_t *tlv_buf, op_mode enable_or_disable){
+
+    node_t *node = NULL;
+    char *node_name = NULL;
+    unsigned int aging_time = 0;
+    unsigned int priority = 0;
+    int CMDCODE = -1;
+    tlv_struct_t *tlv = NULL;
+
+    CMDCODE = EXTRACT_CMD_CODE(tlv_buf);
+
+    TLV_LOOP_BEGIN(tlv_buf, tlv){
+
+        if     (strncmp(tlv->leaf_id, "node-name", strlen("node-name")) ==0)
+            node_name = tlv->value;
+        else if(strncmp(tlv->leaf_id, "aging-time", strlen("aging-time")) ==0)
+            aging_time = atoi(tlv->value);
+        else if(strncmp(tlv->leaf_id, "priority", strlen("priority")) ==0)
+            priority = atoi(tlv->value);
+        else
+            assert(0);
+    }TLV_LOOP_END;
+
+    node = get_node_by_node_name(topo, node_name);
+
+    switch(CMDCODE){
+        case CMDCODE_CONF_NODE_MAC_AGING:
+            switch(enable_or_disable){
+                case CONFIG_ENABLE:
+                    if(!mac_table_set_aging_time(NODE_MAC_TABLE(node), aging_time))
+                        return -1;
+                    break;
+                case CONFIG_DISABLE:
+                    mac_table_set_aging_time(NODE_MAC_TABLE(node),
+                            MAC_TABLE_DEF_AGING_TIME);
+                    break;
+                default:
+                    ;
+            }
+            break;
+        case CMDCODE_CONF_NODE_STP_PRIORITY:
+            switch(enable_or_disable){
+                case CONFIG_ENABLE:
+                    if(!stp_set_bridge_priority(node, priority))
+                        return -1;
+                    break;
+                case CONFIG_DISABLE:
+                    stp_set_bridge_priority(node, STP_DEF_BRIDGE_PRIORITY);
+                    break;
+                default:
+                    ;
+            }
+            break;
+        case CMDCODE_CONF_NODE_ARP_SUPPR:
+            switch(enable_or_disable){
+                case CONFIG_ENABLE:
+                    l2_switch_set_arp_suppression(node, TRUE);
+                    break;
+                case CONFIG_DISABLE:
+                    l2_switch_set_arp_suppression(node, FALSE);
+                    break;
+                default:
+                    ;
+            }
+            break;
+        default:
+            break;
+    }
+    return 0;
+}
+
 /*Layer 4 Commands*/
 
 
@@ -377,6 +622,11 @@ interface_unset_vlan(node_t *node,
                       interface_t *interface,
                       unsigned int vlan);
 
+extern void
+interface_set_lag_hash(interface_t *interface, char *lag_hash_option);
+extern bool_t
+lag_add_member(interface_t *lag_intf, interface_t *interface);
+
 static int
 intf_config_handler(param_t *param, ser_buff_t *tlv_buf, 
                     op_mode enable_or_disable){
@@ -384,7 +634,11 @@ intf_config_handler(param_t *param, ser_buff_t *tlv_buf,
    char *node_name;
    char *intf_name;
    unsigned int vlan_id;
+   unsigned int mtu;
    char *l2_mode_option;
+   char *lag_hash_option;
+   char *lag_name;
+   interface_t *lag_intf;
    int CMDCODE;
    tlv_struct_t *tlv = NULL;
    node_t *node;
@@ -402,6 +656,12 @@ intf_config_handler(param_t *param, ser_buff_t *tlv_buf,
             vlan_id = atoi(tlv->value);
         else if(strncmp(tlv->leaf_id, "l2-mode-val", strlen("l2-mode-val")) == 0)
             l2_mode_option = tlv->value;
+        else if(strncmp(tlv->leaf_id, "mtu", strlen("mtu")) == 0)
+            mtu = atoi(tlv->value);
+        else if(strncmp(tlv->leaf_id, "lag-hash-val", strlen("lag-hash-val")) == 0)
+            lag_hash_option = tlv->value;
+        else if(strncmp(tlv->leaf_id, "lag-name", strlen("lag-name")) == 0)
+            lag_name = tlv->value;
         else
             assert(0);
     } TLV_LOOP_END;
@@ -438,6 +698,59 @@ intf_config_handler(param_t *param, ser_buff_t *tlv_buf,
                     ;
             }
             break;
+        case CMDCODE_INTF_CONFIG_MTU:
+            switch(enable_or_disable){
+                case CONFIG_ENABLE:
+                    interface_set_mtu(interface, mtu);
+                    break;
+                case CONFIG_DISABLE:
+                    interface_set_mtu(interface, IF_DEFAULT_MTU);
+                    break;
+                default:
+                    ;
+            }
+            break;
+        case CMDCODE_INTF_CONFIG_SHUTDOWN:
+            switch(enable_or_disable){
+                case CONFIG_ENABLE:
+                    interface_set_admin_state(interface, FALSE);
+                    break;
+                case CONFIG_DISABLE:
+                    interface_set_admin_state(interface, TRUE);
+                    break;
+                default:
+                    ;
+            }
+            break;
+        case CMDCODE_INTF_CONFIG_LAG_HASH:
+            switch(enable_or_disable){
+                case CONFIG_ENABLE:
+                    interface_set_lag_hash(interface, lag_hash_option);
+                    break;
+                case CONFIG_DISABLE:
+                    interface_set_lag_hash(interface, "l3");
+                    break;
+                default:
+                    ;
+            }
+            break;
+        case CMDCODE_INTF_CONFIG_LAG:
+            switch(enable_or_disable){
+                case CONFIG_ENABLE:
+                    lag_intf = get_node_if_by_name(node, lag_name);
+                    if(!lag_intf){
+                        printf("Error : Interface %s do not exist\n", lag_name);
+                        return -1;
+                    }
+                    lag_add_member(lag_intf, interface);
+                    break;
+                case CONFIG_DISABLE:
+                    printf("Error : Members are never removed from a LAG\n");
+                    break;
+                default:
+                    ;
+            }
+            break;
          default:
             ;    
     }
@@ -490,6 +803,20 @@ nw_init_cli(){
                     libcli_register_param(&node_name, &mac);
                     set_param_cmd_code(&mac, CMDCODE_SHOW_NODE_MAC_TABLE);
                  }
+                 {
+                    /*show node <node-name> stp*/
+                    static param_t stp;
+                    init_param(&stp, CMD, "stp", show_stp_handler, 0, INVALID, 0, "Dump Spanning Tree state");
+                    libcli_register_param(&node_name, &stp);
+                    set_param_cmd_code(&stp, CMDCODE_SHOW_NODE_STP);
+                 }
+                 {
+                    /*show node <node-name> proxy-arp*/
+                    static param_t proxy_arp;
+                    init_param(&proxy_arp, CMD, "proxy-arp", show_arp_suppr_handler, 0, INVALID, 0, "Dump ARP suppression cache");
+                    libcli_register_param(&node_name, &proxy_arp);
+                    set_param_cmd_code(&proxy_arp, CMDCODE_SHOW_NODE_ARP_SUPPR);
+                 }
                  {
                     /*show node <node-name> rt*/
                     static param_t rt;
@@ -499,6 +826,26 @@ nw_init_cli(){
                  }
              }
          } 
+         {
+            /*show comm*/
+            static param_t comm;
+            init_param(&comm, CMD, "comm", 0, 0, INVALID, 0, "Communication Layer");
+            libcli_register_param(show, &comm);
+            {
+                /*show comm statistics*/
+                static param_t statistics;
+                init_param(&statistics, CMD, "statistics", show_comm_handler, 0, INVALID, 0, "Dump Rx Statistics");
+                libcli_register_param(&comm, &statistics);
+                set_param_cmd_code(&statistics, CMDCODE_SHOW_COMM_STATS);
+            }
+            {
+                /*show comm pkt-buffers*/
+                static param_t pkt_buffers;
+                init_param(&pkt_buffers, CMD, "pkt-buffers", show_comm_handler, 0, INVALID, 0, "Dump Pkt Buffer Pool");
+                libcli_register_param(&comm, &pkt_buffers);
+                set_param_cmd_code(&pkt_buffers, CMDCODE_SHOW_COMM_PKT_BUFFERS);
+            }
+         }
     }
     
     {
@@ -594,11 +941,57 @@ nw_init_cli(){
                     {
                         /*config node <node-name> interface <if-name> vlan <vlan-id>*/
                          static param_t vlan_id;
-                         init_param(&vlan_id, LEAF, 0, intf_config_handler, validate_vlan_id, INT, "vlan-id", "vlan id(1-4096)");
+                         init_param(&vlan_id, LEAF, 0, intf_config_handler, validate_vlan_id, INT, "vlan-id", "vlan id(1-4094)");
                          libcli_register_param(&vlan, &vlan_id);
                          set_param_cmd_code(&vlan_id, CMDCODE_INTF_CONFIG_VLAN);
                     }   
                 }    
+                {
+                    /*config node <node-name> interface <if-name> mtu*/
+                    static param_t mtu;
+                    init_param(&mtu, CMD, "mtu", 0, 0, INVALID, 0, "\"mtu\" keyword");
+                    libcli_register_param(&if_name, &mtu);
+                    {
+                        /*config node <node-name> interface <if-name> mtu <mtu>*/
+                         static param_t mtu_val;
+                         init_param(&mtu_val, LEAF, 0, intf_config_handler, validate_mtu_value, INT, "mtu", "mtu(64-9000)");
+                         libcli_register_param(&mtu, &mtu_val);
+                         set_param_cmd_code(&mtu_val, CMDCODE_INTF_CONFIG_MTU);
+                    }
+                }
+                {
+                    /*config node <node-name> interface <if-name> shutdown*/
+                    static param_t shutdown;
+                    init_param(&shutdown, CMD, "shutdown", intf_config_handler, 0, INVALID, 0, "Shut down the interface");
+                    libcli_register_param(&if_name, &shutdown);
+                    set_param_cmd_code(&shutdown, CMDCODE_INTF_CONFIG_SHUTDOWN);
+                }
+                {
+                    /*config node <node-name> interface <if-name> lag-hash*/
+                    static param_t lag_hash;
+                    init_param(&lag_hash, CMD, "lag-hash", 0, 0, INVALID, 0, "\"lag-hash\" keyword");
+                    libcli_register_param(&if_name, &lag_hash);
+                    {
+                        /*config node <node-name> interface <if-name> lag-hash <l2|l3|l4>*/
+                        static param_t lag_hash_val;
+                        init_param(&lag_hash_val, LEAF, 0, intf_config_handler, validate_lag_hash_value, STRING, "lag-hash-val", "l2|l3|l4");
+                        libcli_register_param(&lag_hash, &lag_hash_val);
+                        set_param_cmd_code(&lag_hash_val, CMDCODE_INTF_CONFIG_LAG_HASH);
+                    }
+                }
+                {
+                    /*config node <node-name> interface <if-name> channel-group*/
+                    static param_t channel_group;
+                    init_param(&channel_group, CMD, "channel-group", 0, 0, INVALID, 0, "\"channel-group\" keyword");
+                    libcli_register_param(&if_name, &channel_group);
+                    {
+                        /*config node <node-name> interface <if-name> channel-group <lag-name>*/
+                        static param_t lag_name;
+                        init_param(&lag_name, LEAF, 0, intf_config_handler, 0, STRING, "lag-name", "LAG the interface is bundled into");
+                        libcli_register_param(&channel_group, &lag_name);
+                        set_param_cmd_code(&lag_name, CMDCODE_INTF_CONFIG_LAG);
+                    }
+                }
             }
             
         }
@@ -635,9 +1028,82 @@ nw_init_cli(){
                 }
             }    
         }    
+        {
+            /*config node <node-name> mac-aging*/
+            static param_t mac_aging;
+            init_param(&mac_aging, CMD, "mac-aging", 0, 0, INVALID, 0, "MAC table aging");
+            libcli_register_param(&node_name, &mac_aging);
+            {
+                /*config node <node-name> mac-aging <aging-time>*/
+                static param_t aging_time;
+                init_param(&aging_time, LEAF, 0, l2_config_handler, 0, INT, "aging-time", "Aging time in sec, 0 to disable");
+                libcli_register_param(&mac_aging, &aging_time);
+                set_param_cmd_code(&aging_time, CMDCODE_CONF_NODE_MAC_AGING);
+            }
+        }
+        {
+            /*config node <node-name> stp*/
+            static param_t stp;
+            init_param(&stp, CMD, "stp", 0, 0, INVALID, 0, "Spanning Tree");
+            libcli_register_param(&node_name, &stp);
+            {
+                /*config node <node-name> stp priority*/
+                static param_t priority;
+                init_param(&priority, CMD, "priority", 0, 0, INVALID, 0, "\"priority\" keyword");
+                libcli_register_param(&stp, &priority);
+                {
+                    /*config node <node-name> stp priority <priority>*/
+                    static param_t priority_val;
+                    init_param(&priority_val, LEAF, 0, l2_config_handler, 0, INT, "priority", "Bridge priority(0-61440), in steps of 4096");
+                    libcli_register_param(&priority, &priority_val);
+                    set_param_cmd_code(&priority_val, CMDCODE_CONF_NODE_STP_PRIORITY);
+                }
+            }
+        }
+        {
+            /*config node <node-name> proxy-arp*/
+            static param_t proxy_arp;
+            init_param(&proxy_arp, CMD, "proxy-arp", l2_config_handler, 0, INVALID, 0, "ARP suppression, switch answers ARP requests from its cache");
+            libcli_register_param(&node_name, &proxy_arp);
+            set_param_cmd_code(&proxy_arp, CMDCODE_CONF_NODE_ARP_SUPPR);
+        }
         support_cmd_negation(&node_name);
       }
     }
+
+    /*config comm*/
+    {
+      static param_t comm;
+      init_param(&comm, CMD, "comm", 0, 0, INVALID, 0, "Communication Layer");
+      libcli_register_param(config, &comm);
+      {
+        /*config comm rx-batch-size*/
+        static param_t rx_batch_size;
+        init_param(&rx_batch_size, CMD, "rx-batch-size", 0, 0, INVALID, 0, "Pkts drained per socket per wakeup");
+        libcli_register_param(&comm, &rx_batch_size);
+        {
+            /*config comm rx-batch-size <batch-size>*/
+            static param_t batch_size;
+            init_param(&batch_size, LEAF, 0, comm_config_handler, validate_rx_batch_size, INT, "batch-size", "Batch Size");
+            libcli_register_param(&rx_batch_size, &batch_size);
+            set_param_cmd_code(&batch_size, CMDCODE_CONF_COMM_RX_BATCH);
+        }
+      }
+      {
+        /*config comm rx-threads*/
+        static param_t rx_threads;
+        init_param(&rx_threads, CMD, "rx-threads", 0, 0, INVALID, 0, "No of receiver threads nodes are sharded across");
+        libcli_register_param(&comm, &rx_threads);
+        {
+            /*config comm rx-threads <n-threads>*/
+            static param_t n_threads;
+            init_param(&n_threads, LEAF, 0, comm_config_handler, validate_rx_threads, INT, "n-threads", "No of threads");
+            libcli_register_param(&rx_threads, &n_threads);
+            set_param_cmd_code(&n_threads, CMDCODE_CONF_COMM_RX_THREADS);
+        }
+      }
+      support_cmd_negation(&comm);
+    }
     support_cmd_negation(config);
     /*Do not Add any param here*/
 }
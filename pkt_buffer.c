@@ -0,0 +1,398 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  pkt_buffer.c
+ *
+ *    Description:  This file implements the allocation of packet buffers
+ *
+ *        Version:  1.0
+ *        Created:  10/16/2026 07:12:25 PM
+ *       Revision:  1.0
+ *       Compiler:  gcc
+ *
+ *        This file is part of the NetworkGraph distribution (https://github.com/sachinites).
+ *        Copyright (c) 2017 Abhishek Sagar.
+ *        This program is free software: you can redistribute it and/or modify
+ *        it under the terms of the GNU General Public License as published by
+ *        the Free Software Foundation, version 3.
+ *
+ *        This program is distributed in the hope that it will be useful, but
+ *        WITHOUT ANY WARRANTY; without even the implied warranty of
+ *        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *        General Public License for more details.
+ *
+ *        You should have received a copy of the GNU General Public License
+ *        along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =====================================================================================
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "pkt_buffer.h"
+#include "net.h"
+#include "gluethread/glthread.h"
+
+unsigned long long pkt_buffer_bytes_copied = 0;
+
+/*Largest frame must fit in the largest buffer, after the headroom*/
+_Static_assert(PKT_BUFFER_HEADROOM + ETH_MAX_FRAME_SIZE(IF_MAX_MTU) <=
+               MAX_JUMBO_PACKET_BUFFER_SIZE, "Jumbo buffer too small");
+
+/* Packet buffers come in PKT_BUFFER_N_CLASSES sizes, every size class
+ * is a pool of its own. Buffers are carved out of slabs and never given
+ * back to the system. Every buffer is one cache aligned element : the
+ * descriptor on its own cache line, followed by the memory of the
+ * buffer. Free buffers are kept in the shared pool of the class, and
+ * every thread keeps a small cache of free buffers of every class in
+ * front of it, so that alloc/free on the data path take no lock. A
+ * thread moves buffers between its cache and the shared pool in
+ * batches of PKT_BUFFER_CACHE_BATCH*/
+#define PKT_BUFFER_CACHE_SIZE   64
+#define PKT_BUFFER_CACHE_BATCH  (PKT_BUFFER_CACHE_SIZE / 2)
+
+typedef struct pkt_buffer_elem_{
+
+    pkt_buffer_t pkt_buf;
+    struct pkt_buffer_elem_ *next;      /*Next free buffer in the pool*/
+    unsigned int class;
+    /*Memory of the buffer follows, on the next cache line*/
+} __attribute__((aligned(64))) pkt_buffer_elem_t;
+
+typedef struct pkt_buffer_cache_{
+
+    struct {
+        pkt_buffer_elem_t *free[PKT_BUFFER_CACHE_SIZE];
+        unsigned int n_free;
+        /*Written by the owner thread only*/
+        unsigned long long n_allocs;
+        unsigned long long n_frees;
+    } class[PKT_BUFFER_N_CLASSES];
+    glthread_t cache_glue;
+} pkt_buffer_cache_t;
+GLTHREAD_TO_STRUCT(cache_glue_to_pkt_buffer_cache, pkt_buffer_cache_t, cache_glue);
+
+typedef struct pkt_buffer_pool_{
+
+    unsigned int buffer_size;
+    unsigned int slab_size;             /*Buffers carved at a time*/
+    unsigned int max_buffers;
+    pkt_buffer_elem_t *free_list;
+    unsigned int n_free;
+    unsigned int n_buffers;             /*Buffers carved so far*/
+    unsigned int hwm;                   /*Max buffers out of the pool*/
+    unsigned long long n_alloc_fails;
+    /*Counters of the threads which have exited*/
+    unsigned long long n_allocs;
+    unsigned long long n_frees;
+} pkt_buffer_pool_t;
+
+/*All the pools are protected by the one lock*/
+static pthread_mutex_t pkt_buffer_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static glthread_t pkt_buffer_cache_list;
+
+static pkt_buffer_pool_t pkt_buffer_pools[PKT_BUFFER_N_CLASSES] = {
+    {
+        .buffer_size = MAX_PACKET_BUFFER_SIZE,
+        .slab_size = 256,
+        .max_buffers = PKT_BUFFER_POOL_MAX_BUFFERS,
+    },
+    {
+        .buffer_size = MAX_JUMBO_PACKET_BUFFER_SIZE,
+        .slab_size = 64,
+        .max_buffers = PKT_BUFFER_POOL_MAX_JUMBO_BUFFERS,
+    },
+};
+
+static pthread_once_t pkt_buffer_once = PTHREAD_ONCE_INIT;
+static pthread_key_t pkt_buffer_cache_key;
+static __thread pkt_buffer_cache_t *pkt_buffer_cache = NULL;
+
+static unsigned int
+pkt_buffer_class_for(unsigned int pkt_size){
+
+    unsigned int class;
+
+    for(class = 0; class < PKT_BUFFER_N_CLASSES - 1; class++){
+        if(PKT_BUFFER_HEADROOM + pkt_size <= pkt_buffer_pools[class].buffer_size)
+            break;
+    }
+    return class;
+}
+
+unsigned int
+pkt_buffer_size_for(unsigned int pkt_size){
+
+    return pkt_buffer_pools[pkt_buffer_class_for(pkt_size)].buffer_size;
+}
+
+/*Pool lock must be held*/
+static bool_t
+pkt_buffer_pool_grow(pkt_buffer_pool_t *pool, unsigned int class){
+
+    unsigned int i;
+    char *slab = NULL;
+    pkt_buffer_elem_t *elem;
+    unsigned int elem_size = sizeof(pkt_buffer_elem_t) + pool->buffer_size;
+
+    if(pool->n_buffers + pool->slab_size > pool->max_buffers)
+        return FALSE;
+
+    if(posix_memalign((void **)&slab, 64, pool->slab_size * elem_size))
+        return FALSE;
+
+    for(i = 0; i < pool->slab_size; i++){
+        elem = (pkt_buffer_elem_t *)(slab + i * elem_size);
+        elem->class = class;
+        elem->next = pool->free_list;
+        pool->free_list = elem;
+    }
+    pool->n_free += pool->slab_size;
+    pool->n_buffers += pool->slab_size;
+    return TRUE;
+}
+
+/*Move up to 'n' buffers of the class from the shared pool into the cache*/
+static void
+pkt_buffer_cache_refill(pkt_buffer_cache_t *cache, unsigned int class,
+                        unsigned int n){
+
+    pkt_buffer_elem_t *elem;
+    pkt_buffer_pool_t *pool = &pkt_buffer_pools[class];
+
+    pthread_mutex_lock(&pkt_buffer_pool_lock);
+
+    while(n--){
+        if(!pool->free_list && !pkt_buffer_pool_grow(pool, class))
+            break;
+        elem = pool->free_list;
+        pool->free_list = elem->next;
+        pool->n_free--;
+        cache->class[class].free[cache->class[class].n_free++] = elem;
+    }
+
+    if(pool->n_buffers - pool->n_free > pool->hwm)
+        pool->hwm = pool->n_buffers - pool->n_free;
+
+    pthread_mutex_unlock(&pkt_buffer_pool_lock);
+}
+
+/*Give 'n' buffers of the class in the cache back to the shared pool*/
+static void
+pkt_buffer_cache_flush(pkt_buffer_cache_t *cache, unsigned int class,
+                       unsigned int n){
+
+    pkt_buffer_elem_t *elem;
+    pkt_buffer_pool_t *pool = &pkt_buffer_pools[class];
+
+    pthread_mutex_lock(&pkt_buffer_pool_lock);
+
+    while(n-- && cache->class[class].n_free){
+        elem = cache->class[class].free[--cache->class[class].n_free];
+        elem->next = pool->free_list;
+        pool->free_list = elem;
+        pool->n_free++;
+    }
+
+    pthread_mutex_unlock(&pkt_buffer_pool_lock);
+}
+
+/*Thread exit, buffers of its cache go back to the pools*/
+static void
+pkt_buffer_cache_destroy(void *arg){
+
+    unsigned int class;
+    pkt_buffer_cache_t *cache = arg;
+
+    for(class = 0; class < PKT_BUFFER_N_CLASSES; class++)
+        pkt_buffer_cache_flush(cache, class, PKT_BUFFER_CACHE_SIZE);
+
+    pthread_mutex_lock(&pkt_buffer_pool_lock);
+    for(class = 0; class < PKT_BUFFER_N_CLASSES; class++){
+        pkt_buffer_pools[class].n_allocs += cache->class[class].n_allocs;
+        pkt_buffer_pools[class].n_frees += cache->class[class].n_frees;
+    }
+    remove_glthread(&cache->cache_glue);
+    pthread_mutex_unlock(&pkt_buffer_pool_lock);
+
+    free(cache);
+}
+
+static void
+pkt_buffer_pool_init(){
+
+    init_glthread(&pkt_buffer_cache_list);
+    pthread_key_create(&pkt_buffer_cache_key, pkt_buffer_cache_destroy);
+}
+
+static pkt_buffer_cache_t *
+pkt_buffer_get_cache(){
+
+    pkt_buffer_cache_t *cache = pkt_buffer_cache;
+
+    if(cache)
+        return cache;
+
+    pthread_once(&pkt_buffer_once, pkt_buffer_pool_init);
+
+    cache = calloc(1, sizeof(pkt_buffer_cache_t));
+    if(!cache)
+        return NULL;
+
+    init_glthread(&cache->cache_glue);
+    pthread_mutex_lock(&pkt_buffer_pool_lock);
+    glthread_add_next(&pkt_buffer_cache_list, &cache->cache_glue);
+    pthread_mutex_unlock(&pkt_buffer_pool_lock);
+
+    pthread_setspecific(pkt_buffer_cache_key, cache);
+    pkt_buffer_cache = cache;
+    return cache;
+}
+
+pkt_buffer_t *
+pkt_buffer_alloc(unsigned int pkt_size){
+
+    pkt_buffer_elem_t *elem;
+    unsigned int class = pkt_buffer_class_for(pkt_size);
+    pkt_buffer_cache_t *cache = pkt_buffer_get_cache();
+
+    if(!cache || PKT_BUFFER_HEADROOM + pkt_size > pkt_buffer_pools[class].buffer_size)
+        goto fail;
+
+    if(!cache->class[class].n_free){
+        pkt_buffer_cache_refill(cache, class, PKT_BUFFER_CACHE_BATCH);
+        if(!cache->class[class].n_free)
+            goto fail;
+    }
+
+    elem = cache->class[class].free[--cache->class[class].n_free];
+    cache->class[class].n_allocs++;
+    pkt_buffer_init(&elem->pkt_buf, (char *)(elem + 1),
+                    pkt_buffer_pools[class].buffer_size);
+    return &elem->pkt_buf;
+
+    fail:
+    __atomic_fetch_add(&pkt_buffer_pools[class].n_alloc_fails, 1, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+void
+pkt_buffer_free(pkt_buffer_t *pkt_buf){
+
+    pkt_buffer_cache_t *cache;
+    pkt_buffer_elem_t *elem = (pkt_buffer_elem_t *)pkt_buf;
+    unsigned int class;
+
+    if(!pkt_buf) return;
+
+    if(__atomic_sub_fetch(&pkt_buf->refcnt, 1, __ATOMIC_ACQ_REL))
+        return;
+
+    class = elem->class;
+    cache = pkt_buffer_get_cache();
+    if(!cache){
+        /*Cannot happen unless out of memory, hand it to the pool directly*/
+        pthread_mutex_lock(&pkt_buffer_pool_lock);
+        elem->next = pkt_buffer_pools[class].free_list;
+        pkt_buffer_pools[class].free_list = elem;
+        pkt_buffer_pools[class].n_free++;
+        pkt_buffer_pools[class].n_frees++;
+        pthread_mutex_unlock(&pkt_buffer_pool_lock);
+        return;
+    }
+
+    if(cache->class[class].n_free == PKT_BUFFER_CACHE_SIZE)
+        pkt_buffer_cache_flush(cache, class, PKT_BUFFER_CACHE_BATCH);
+
+    cache->class[class].free[cache->class[class].n_free++] = elem;
+    cache->class[class].n_frees++;
+}
+
+pkt_buffer_t *
+pkt_buffer_unshare(pkt_buffer_t *pkt_buf){
+
+    pkt_buffer_t *pkt_copy;
+
+    if(!pkt_buffer_shared(pkt_buf))
+        return pkt_buf;
+
+    /*Buffer of the same size, the pkt goes at the same offset*/
+    pkt_copy = pkt_buffer_alloc(pkt_buf->size - PKT_BUFFER_HEADROOM);
+    if(!pkt_copy)
+        return NULL;
+
+    pkt_copy->data = pkt_copy->head + pkt_buffer_headroom(pkt_buf);
+    pkt_buffer_copy(pkt_buffer_put(pkt_copy, pkt_buf->len),
+                    pkt_buf->data, pkt_buf->len);
+    return pkt_copy;
+}
+
+void
+pkt_buffer_pool_get_stats(pkt_buffer_pool_stats_t stats[PKT_BUFFER_N_CLASSES]){
+
+    glthread_t *curr;
+    pkt_buffer_cache_t *cache;
+    pkt_buffer_pool_t *pool;
+    unsigned int class;
+
+    memset(stats, 0, PKT_BUFFER_N_CLASSES * sizeof(pkt_buffer_pool_stats_t));
+
+    pthread_once(&pkt_buffer_once, pkt_buffer_pool_init);
+    pthread_mutex_lock(&pkt_buffer_pool_lock);
+
+    for(class = 0; class < PKT_BUFFER_N_CLASSES; class++){
+        pool = &pkt_buffer_pools[class];
+        stats[class].buffer_size = pool->buffer_size;
+        stats[class].n_buffers = pool->n_buffers;
+        stats[class].max_buffers = pool->max_buffers;
+        stats[class].n_free = pool->n_free;
+        stats[class].hwm = pool->hwm;
+        stats[class].n_allocs = pool->n_allocs;
+        stats[class].n_frees = pool->n_frees;
+        stats[class].n_alloc_fails = __atomic_load_n(&pool->n_alloc_fails,
+                                                     __ATOMIC_RELAXED);
+    }
+
+    /*Counters of running threads are read without their owner's
+     * consent, good enough for display*/
+    ITERATE_GLTHREAD_BEGIN(&pkt_buffer_cache_list, curr){
+
+        cache = cache_glue_to_pkt_buffer_cache(curr);
+        for(class = 0; class < PKT_BUFFER_N_CLASSES; class++){
+            stats[class].n_cached += cache->class[class].n_free;
+            stats[class].n_allocs += cache->class[class].n_allocs;
+            stats[class].n_frees += cache->class[class].n_frees;
+            stats[class].n_threads++;
+        }
+    } ITERATE_GLTHREAD_END(&pkt_buffer_cache_list, curr);
+
+    pthread_mutex_unlock(&pkt_buffer_pool_lock);
+
+    for(class = 0; class < PKT_BUFFER_N_CLASSES; class++){
+        stats[class].n_in_use = stats[class].n_buffers - stats[class].n_free -
+                                stats[class].n_cached;
+    }
+}
+
+void
+dump_pkt_buffer_pool_stats(){
+
+    unsigned int class;
+    pkt_buffer_pool_stats_t stats[PKT_BUFFER_N_CLASSES];
+
+    pkt_buffer_pool_get_stats(stats);
+
+    for(class = 0; class < PKT_BUFFER_N_CLASSES; class++){
+        printf("Pkt buffer pool : buffer size : %u, buffers : %u (max %u)\n",
+                stats[class].buffer_size, stats[class].n_buffers,
+                stats[class].max_buffers);
+        printf("\tIn use : %u, Free in pool : %u, Cached by %u threads : %u\n",
+                stats[class].n_in_use, stats[class].n_free,
+                stats[class].n_threads, stats[class].n_cached);
+        printf("\tHigh water mark : %u\n", stats[class].hwm);
+        printf("\tAllocs : %llu, Frees : %llu, Alloc failures : %llu\n",
+                stats[class].n_allocs, stats[class].n_frees,
+                stats[class].n_alloc_fails);
+    }
+}
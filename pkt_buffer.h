@@ -0,0 +1,211 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  pkt_buffer.h
+ *
+ *    Description:  This file defines the packet buffer : the memory a packet lives in
+ *    while it travels through the TCP/IP stack, with room reserved in front of the
+ *    packet so that lower layers can prepend their hdrs without moving the packet
+ *
+ *        Version:  1.0
+ *        Created:  10/16/2026 07:12:25 PM
+ *       Revision:  1.0
+ *       Compiler:  gcc
+ *
+ *        This file is part of the NetworkGraph distribution (https://github.com/sachinites).
+ *        Copyright (c) 2017 Abhishek Sagar.
+ *        This program is free software: you can redistribute it and/or modify
+ *        it under the terms of the GNU General Public License as published by
+ *        the Free Software Foundation, version 3.
+ *
+ *        This program is distributed in the hope that it will be useful, but
+ *        WITHOUT ANY WARRANTY; without even the implied warranty of
+ *        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *        General Public License for more details.
+ *
+ *        You should have received a copy of the GNU General Public License
+ *        along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =====================================================================================
+ */
+
+#ifndef __PKT_BUFFER__
+#define __PKT_BUFFER__
+
+#include <assert.h>
+#include <memory.h>
+#include "comm.h"
+#include "utils.h"
+
+/* Room left in front of the pkt when a buffer is filled, enough for
+ * the hdrs the stack may prepend (ethernet, 802.1Q, IP, IP in IP) and
+ * for the wire hdr transports receive in front of the frame*/
+#define PKT_BUFFER_HEADROOM     128
+
+/*Largest pkt a buffer can carry*/
+#define PKT_BUFFER_MAX_PKT_SIZE (MAX_JUMBO_PACKET_BUFFER_SIZE - PKT_BUFFER_HEADROOM)
+
+/*
+ *  head          data              data + len          head + size
+ *   |  headroom   |       pkt          |     tailroom      |
+ */
+struct pkt_buffer_{
+
+    char *head;         /*Start of the memory of the buffer*/
+    char *data;         /*Start of the pkt*/
+    unsigned int len;   /*Size of the pkt*/
+    unsigned int size;  /*Size of the memory of the buffer*/
+    unsigned int refcnt;/*Owners of the buffer, see pkt_buffer_get()*/
+};
+
+/*Bytes of pkt data copied by the stack and the transports so far*/
+extern unsigned long long pkt_buffer_bytes_copied;
+
+/* Size classes of the buffers : MAX_PACKET_BUFFER_SIZE and
+ * MAX_JUMBO_PACKET_BUFFER_SIZE, and the most buffers of each class
+ * the pool may hold*/
+#define PKT_BUFFER_N_CLASSES                2
+#define PKT_BUFFER_POOL_MAX_BUFFERS         65536
+#define PKT_BUFFER_POOL_MAX_JUMBO_BUFFERS   8192
+
+typedef struct pkt_buffer_pool_stats_{
+
+    unsigned int buffer_size;
+    unsigned int n_buffers;     /*Buffers carved out of the system*/
+    unsigned int max_buffers;
+    unsigned int n_in_use;
+    unsigned int n_free;        /*Free in the shared pool*/
+    unsigned int n_cached;      /*Free in per-thread caches*/
+    unsigned int n_threads;
+    unsigned int hwm;           /*Most buffers ever out of the shared pool*/
+    unsigned long long n_allocs;
+    unsigned long long n_frees;
+    unsigned long long n_alloc_fails;
+} pkt_buffer_pool_stats_t;
+
+/* Allocate an empty buffer with room for a pkt of 'pkt_size' bytes
+ * after the headroom, from the pool of the smallest size class that
+ * fits. Returns NULL if the pool is exhausted*/
+pkt_buffer_t *
+pkt_buffer_alloc(unsigned int pkt_size);
+
+/*Size of the buffers pkt_buffer_alloc(pkt_size) allocates*/
+unsigned int
+pkt_buffer_size_for(unsigned int pkt_size);
+
+/* Drop a reference to the buffer, the buffer goes back to the pool
+ * with its last reference. Any thread may free any buffer*/
+void
+pkt_buffer_free(pkt_buffer_t *pkt_buf);
+
+/* Returns a buffer the caller may modify : 'pkt_buf' itself if the
+ * caller is its only owner, else a private copy of the pkt with the
+ * same headroom. The caller's reference to 'pkt_buf' is not dropped,
+ * a copy must be freed by the caller once done*/
+pkt_buffer_t *
+pkt_buffer_unshare(pkt_buffer_t *pkt_buf);
+
+void
+pkt_buffer_pool_get_stats(pkt_buffer_pool_stats_t stats[PKT_BUFFER_N_CLASSES]);
+
+void
+dump_pkt_buffer_pool_stats();
+
+/*Set up an empty buffer on the memory provided by the caller*/
+static inline void
+pkt_buffer_init(pkt_buffer_t *pkt_buf, char *head, unsigned int size){
+
+    pkt_buf->head = head;
+    pkt_buf->size = size;
+    pkt_buf->data = head + PKT_BUFFER_HEADROOM;
+    pkt_buf->len = 0;
+    pkt_buf->refcnt = 1;
+}
+
+/* Take one more reference to the buffer, eg. to share the pkt among
+ * all the interfaces it is flooded out of. A buffer with more than
+ * one owner is read only, see pkt_buffer_unshare()*/
+static inline pkt_buffer_t *
+pkt_buffer_get(pkt_buffer_t *pkt_buf){
+
+    __atomic_fetch_add(&pkt_buf->refcnt, 1, __ATOMIC_RELAXED);
+    return pkt_buf;
+}
+
+static inline bool_t
+pkt_buffer_shared(pkt_buffer_t *pkt_buf){
+
+    return __atomic_load_n(&pkt_buf->refcnt, __ATOMIC_ACQUIRE) > 1;
+}
+
+static inline unsigned int
+pkt_buffer_headroom(pkt_buffer_t *pkt_buf){
+
+    return pkt_buf->data - pkt_buf->head;
+}
+
+static inline unsigned int
+pkt_buffer_tailroom(pkt_buffer_t *pkt_buf){
+
+    return pkt_buf->size - pkt_buffer_headroom(pkt_buf) - pkt_buf->len;
+}
+
+/*pkt was placed in the buffer by somebody else, eg. the kernel*/
+static inline void
+pkt_buffer_set_data(pkt_buffer_t *pkt_buf, char *data, unsigned int len){
+
+    assert(data >= pkt_buf->head &&
+           data + len <= pkt_buf->head + pkt_buf->size);
+    pkt_buf->data = data;
+    pkt_buf->len = len;
+}
+
+/*Prepend 'size' bytes of hdr to the pkt, returns the new start of pkt*/
+static inline char *
+pkt_buffer_push(pkt_buffer_t *pkt_buf, unsigned int size){
+
+    assert(pkt_buffer_headroom(pkt_buf) >= size);
+    pkt_buf->data -= size;
+    pkt_buf->len += size;
+    return pkt_buf->data;
+}
+
+/*Strip 'size' bytes of hdr off the pkt, returns the new start of pkt*/
+static inline char *
+pkt_buffer_pull(pkt_buffer_t *pkt_buf, unsigned int size){
+
+    assert(pkt_buf->len >= size);
+    pkt_buf->data += size;
+    pkt_buf->len -= size;
+    return pkt_buf->data;
+}
+
+/*Append 'size' bytes to the pkt, returns the start of the bytes appended*/
+static inline char *
+pkt_buffer_put(pkt_buffer_t *pkt_buf, unsigned int size){
+
+    char *tail = pkt_buf->data + pkt_buf->len;
+
+    assert(pkt_buffer_tailroom(pkt_buf) >= size);
+    pkt_buf->len += size;
+    return tail;
+}
+
+/*Cut the pkt down to 'len' bytes*/
+static inline void
+pkt_buffer_trim(pkt_buffer_t *pkt_buf, unsigned int len){
+
+    if(len < pkt_buf->len)
+        pkt_buf->len = len;
+}
+
+/* Every copy of pkt data must go through this fn, so that the copies
+ * left on the data path can be accounted for*/
+static inline void
+pkt_buffer_copy(char *dst, char *src, unsigned int size){
+
+    memcpy(dst, src, size);
+    __atomic_fetch_add(&pkt_buffer_bytes_copied, size, __ATOMIC_RELAXED);
+}
+
+#endif /* __PKT_BUFFER__ */
@@ -9,7 +9,7 @@
 /* Usage : Suppose you want to send the IP traffic from
  * Node S to node D, then set the below constants as follows */
 #define SRC_NODE_UDP_PORT_NO    40000       /*UDP port no of node S, use 'show topology' cmd to know the udp port numbers*/
-#define INGRESS_INTF_NAME       "eth7"      /*Specify Any existing interface of the node S.*/ 
+#define INGRESS_INTF_IFINDEX    0           /*Specify Any existing interface of the node S, use 'show topology' cmd to know the ifindexes*/
 #define DEST_IP_ADDR            "122.1.1.2" /*Destination IP Address of the Remote node D of the topology*/
 
 
@@ -78,10 +78,16 @@ main(int argc, char **argv){
 #endif
 
     memset(send_buffer, 0, MAX_PACKET_BUFFER_SIZE);
-    strncpy(send_buffer, INGRESS_INTF_NAME, IF_NAME_SIZE);
+
+    /*Frames injected from outside the topology are out of any link's
+     * sequence, like frames a node sends to self*/
+    comm_wire_hdr_t *wire_hdr = (comm_wire_hdr_t *)send_buffer;
+    wire_hdr->version = COMM_WIRE_HDR_VERSION;
+    wire_hdr->flags = COMM_WIRE_F_SELF;
+    wire_hdr->ifindex = INGRESS_INTF_IFINDEX;
 
     /*Prepare ethernet hdr*/
-    ethernet_hdr_t *eth_hdr = (ethernet_hdr_t *)(send_buffer + IF_NAME_SIZE);
+    ethernet_hdr_t *eth_hdr = (ethernet_hdr_t *)(wire_hdr + 1);
     /*Dont bother about MAC addresses, just fill them with broadcast mac*/
     layer2_fill_with_broadcast_mac(eth_hdr->src_mac.mac);
     layer2_fill_with_broadcast_mac(eth_hdr->dst_mac.mac);
@@ -97,7 +103,7 @@ main(int argc, char **argv){
 
     uint32_t total_data_size = ETH_HDR_SIZE_EXCL_PAYLOAD + 
                                20 +
-                               IF_NAME_SIZE;
+                               sizeof(comm_wire_hdr_t);
     int rc = 0 ;
     while(1){
         rc = _send_pkt_out(udp_sock_fd, send_buffer, 
@@ -35,7 +35,9 @@
 
 #include "graph.h"
 #include <stdio.h>
+#include <string.h>
 #include "CommandParser/libcli.h"
+#include "comm.h"
 
 extern graph_t *build_first_topo();
 extern graph_t *build_simple_l2_switch_topo();
@@ -44,6 +46,7 @@ extern graph_t *build_linear_topo();
 extern graph_t *build_dualswitch_topo();
 extern graph_t *linear_3_node_topo();
 extern graph_t *L2_loop_topo();
+extern graph_t *build_lag_topo();
 extern void nw_init_cli();
 
 graph_t *topo = NULL;
@@ -51,6 +54,13 @@ graph_t *topo = NULL;
 int 
 main(int argc, char **argv){
 
+    /*Usage : ./test.exe [-t <udp|unix|shm|uring>], transport is fixed before
+     * the topology is built*/
+    if(argc > 2 && strcmp(argv[1], "-t") == 0){
+        if(comm_set_transport(argv[2]) < 0)
+            return -1;
+    }
+
     nw_init_cli();
 	show_help_handler(0, 0, MODE_UNKNOWN);
     topo = build_square_topo();
@@ -460,3 +460,52 @@ L2_loop_topo(){
     network_start_pkt_receiver_thread(topo);
     return topo;
 }
+
+graph_t *
+build_lag_topo(){
+
+#if 0
+                         lag0 : eth0/1, eth0/2, eth0/3, eth0/4
+    +----------+                                              +----------+                          +----------+
+    |          |lag0                                      lag0|          |eth0/5              eth0/6|          |
+    |    R1    +==============================================+   L2SW   +--------------------------+    R2    |
+    |122.1.1.1 |10.1.1.1/24                             AC,V10|          |AC,V10         10.1.1.2/24|122.1.1.2 |
+    +----------+                                              +----------+                          +----------+
+#endif
+
+    graph_t *topo = create_new_graph("LAG Topo");
+    node_t *R1 = create_graph_node(topo, "R1");
+    node_t *R2 = create_graph_node(topo, "R2");
+    node_t *L2SW = create_graph_node(topo, "L2SW");
+
+    node_set_loopback_address(R1, "122.1.1.1");
+    node_set_loopback_address(R2, "122.1.1.2");
+
+    insert_link_between_two_nodes(R1, L2SW, "eth0/1", "eth0/1", 1);
+    insert_link_between_two_nodes(R1, L2SW, "eth0/2", "eth0/2", 1);
+    insert_link_between_two_nodes(R1, L2SW, "eth0/3", "eth0/3", 1);
+    insert_link_between_two_nodes(R1, L2SW, "eth0/4", "eth0/4", 1);
+    insert_link_between_two_nodes(L2SW, R2, "eth0/5", "eth0/6", 1);
+
+    node_create_lag(R1, "lag0");
+    node_create_lag(L2SW, "lag0");
+    node_add_lag_member(R1, "lag0", "eth0/1");
+    node_add_lag_member(R1, "lag0", "eth0/2");
+    node_add_lag_member(R1, "lag0", "eth0/3");
+    node_add_lag_member(R1, "lag0", "eth0/4");
+    node_add_lag_member(L2SW, "lag0", "eth0/1");
+    node_add_lag_member(L2SW, "lag0", "eth0/2");
+    node_add_lag_member(L2SW, "lag0", "eth0/3");
+    node_add_lag_member(L2SW, "lag0", "eth0/4");
+
+    node_set_intf_ip_address(R1, "lag0", "10.1.1.1", 24);
+    node_set_intf_ip_address(R2, "eth0/6", "10.1.1.2", 24);
+
+    node_set_intf_l2_mode(L2SW, "lag0", ACCESS);
+    node_set_intf_vlan_membsership(L2SW, "lag0", 10);
+    node_set_intf_l2_mode(L2SW, "eth0/5", ACCESS);
+    node_set_intf_vlan_membsership(L2SW, "eth0/5", 10);
+
+    network_start_pkt_receiver_thread(topo);
+    return topo;
+}